@@ -0,0 +1,124 @@
+#include <lib/charge_session/charge_session.h>
+#include <stdio.h>
+#include <string.h>
+
+void charge_session_begin(
+    ChargeSession* session,
+    uint32_t tick,
+    uint8_t gauge,
+    uint16_t limit_ma,
+    float idle_current_a) {
+    memset(session, 0, sizeof(ChargeSession));
+    const float idle_ma = -idle_current_a * 1000.0f;
+    session->idle_ma = idle_ma <= 0 ? 0 : (idle_ma >= UINT16_MAX ? UINT16_MAX : idle_ma);
+    session->start_tick = tick;
+    session->last_tick = tick;
+    session->gauge_start = gauge;
+    session->gauge_end = gauge;
+    session->limit_ma = limit_ma;
+}
+
+static uint16_t charge_session_tail_ma(const ChargeSession* session) {
+    uint32_t tail_ma = 0;
+    for(uint8_t i = 0; i < session->count; i++) {
+        tail_ma += session->ring[i].load_ma;
+    }
+    return session->count ? tail_ma / session->count : 0;
+}
+
+static ChargeDraw charge_session_judge(const ChargeSession* session, uint16_t tail_ma) {
+    if(session->cut || session->over_run >= CHARGE_SESSION_OVER_SAMPLES) {
+        return ChargeDrawOver;
+    } else if(tail_ma < CHARGE_SESSION_IDLE_MA) {
+        return ChargeDrawIdle;
+    } else if(tail_ma < session->limit_ma / 2) {
+        return ChargeDrawLow;
+    }
+    return ChargeDrawOk;
+}
+
+void charge_session_add(
+    ChargeSession* session,
+    uint32_t tick,
+    float current_a,
+    float voltage_v,
+    uint8_t gauge) {
+    // Same power on both sides of the boost, less what it loses
+    const float battery_ma = -current_a * 1000.0f - session->idle_ma;
+    const float load_ma = battery_ma * voltage_v * 1000.0f / CHARGE_SESSION_OTG_MV *
+                          CHARGE_SESSION_BOOST_EFFICIENCY_PERCENT / 100;
+    const uint16_t load = load_ma <= 0 ? 0 : (load_ma >= UINT16_MAX ? UINT16_MAX : load_ma);
+    const uint16_t voltage = voltage_v > 0 ? voltage_v * 1000.0f : 0;
+    // Each reading stands for the interval since the previous one
+    const uint32_t dt_ms = tick - session->last_tick;
+    session->last_tick = tick;
+    session->charge_ma_ms += (uint64_t)load * dt_ms;
+    session->energy_mw_ms += (uint64_t)load * CHARGE_SESSION_OTG_MV / 1000 * dt_ms;
+    session->voltage_sum_mv += voltage;
+    session->samples++;
+    if(load > session->peak_ma) session->peak_ma = load;
+    session->gauge_end = gauge;
+
+    ChargeSample* sample = &session->ring[session->head];
+    sample->tick = tick;
+    sample->load_ma = load;
+    sample->voltage_mv = voltage;
+    session->head = (session->head + 1) % CHARGE_SESSION_SAMPLES;
+    if(session->count < CHARGE_SESSION_SAMPLES) session->count++;
+
+    session->over_run = load > session->limit_ma ? session->over_run + 1 : 0;
+    const uint16_t tail_ma = charge_session_tail_ma(session);
+    if(tail_ma > session->best_tail_ma) session->best_tail_ma = tail_ma;
+}
+
+ChargeDraw charge_session_draw(const ChargeSession* session) {
+    return charge_session_judge(session, charge_session_tail_ma(session));
+}
+
+const char* charge_session_draw_name(ChargeDraw draw) {
+    switch(draw) {
+    case ChargeDrawIdle:
+        return "idle";
+    case ChargeDrawLow:
+        return "low";
+    case ChargeDrawOk:
+        return "ok";
+    case ChargeDrawOver:
+        return "over";
+    }
+    return "unknown";
+}
+
+size_t charge_session_format(
+    const ChargeSession* session,
+    const char* identity,
+    char* out,
+    size_t size) {
+    const uint32_t tail_ma = charge_session_tail_ma(session);
+    const uint32_t avg_mv =
+        session->samples ? (uint32_t)(session->voltage_sum_mv / session->samples) : 0;
+    // 3600000 ms per hour, printed with one decimal
+    const uint32_t ma_h10 = (uint32_t)(session->charge_ma_ms / 360000);
+    const uint32_t mw_h10 = (uint32_t)(session->energy_mw_ms / 360000);
+    int len = snprintf(
+        out,
+        size,
+        "%s,%lu,%lu.%lu,%lu.%lu,%u,%lu,%lu,%u,%u,%lu,%u,%s,%u",
+        identity,
+        (unsigned long)((session->last_tick - session->start_tick) / 1000),
+        (unsigned long)(ma_h10 / 10),
+        (unsigned long)(ma_h10 % 10),
+        (unsigned long)(mw_h10 / 10),
+        (unsigned long)(mw_h10 % 10),
+        session->peak_ma,
+        (unsigned long)tail_ma,
+        (unsigned long)avg_mv,
+        session->gauge_start,
+        session->gauge_end,
+        (unsigned long)session->samples,
+        session->limit_ma,
+        charge_session_draw_name(charge_session_judge(session, session->best_tail_ma)),
+        session->idle_ma);
+    if(len < 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Recent samples, the tail current is averaged over these
+#define CHARGE_SESSION_SAMPLES 16
+#define CHARGE_SESSION_LOG_NAME "charge_log.csv"
+#define CHARGE_SESSION_LOG_HEADER                                                          \
+    "date,identity,duration_s,mAh,mWh,peak_mA,tail_mA,avg_mV,gauge_start,gauge_end,samples," \
+    "limit_mA,draw,idle_mA"
+#define CHARGE_SESSION_LIMIT_DEFAULT_MA 1000
+// Boost limit of the Flipper charger IC in OTG mode, no profile may allow more
+#define CHARGE_SESSION_LIMIT_MAX_MA 1400
+// What the boost puts out and how much of the battery power makes it there, from the charger
+// IC datasheet at around 1 A
+#define CHARGE_SESSION_OTG_MV 5000
+#define CHARGE_SESSION_BOOST_EFFICIENCY_PERCENT 90
+// Below this the phone is not charging at all
+#define CHARGE_SESSION_IDLE_MA 50
+// Samples in a row above the limit before 5V is cut, brief inrush is fine
+#define CHARGE_SESSION_OVER_SAMPLES 3
+
+typedef enum {
+    ChargeDrawIdle,
+    // Less than half the limit, the phone did not take what the identity offers
+    ChargeDrawLow,
+    ChargeDrawOk,
+    // Above the limit for CHARGE_SESSION_OVER_SAMPLES samples, 5V has to go off
+    ChargeDrawOver,
+} ChargeDraw;
+
+typedef struct {
+    uint32_t tick;
+    uint16_t load_ma;
+    uint16_t voltage_mv;
+} ChargeSample;
+
+/* Energy delivered to the phone during one charging mode session. The gauge only sees the
+ * battery side at around 3.7 V, including the Flipper's own draw. That draw, measured before
+ * OTG went on, is taken off and the rest carried over the boost to 5 V. Currents, charge, energy
+ * and the limit are all on the 5 V side, what the phone gets. avg_mV is the battery voltage. */
+typedef struct {
+    ChargeSample ring[CHARGE_SESSION_SAMPLES];
+    uint8_t head;
+    uint8_t count;
+
+    uint32_t start_tick;
+    uint32_t last_tick;
+    uint32_t samples;
+    // mA*ms and mW*ms, a 64 bit sum does not wrap within any realistic session
+    uint64_t charge_ma_ms;
+    uint64_t energy_mw_ms;
+    uint64_t voltage_sum_mv;
+    uint16_t peak_ma;
+    uint8_t gauge_start;
+    uint8_t gauge_end;
+
+    uint16_t limit_ma;
+    // Battery discharge of the Flipper alone, before OTG was on
+    uint16_t idle_ma;
+    // Highest tail current of the session, the log judges the negotiation by it
+    uint16_t best_tail_ma;
+    uint8_t over_run;
+    // Set by the owner once it turned 5V off for drawing too much
+    bool cut;
+} ChargeSession;
+
+/* idle_current_a is the gauge reading taken before OTG was turned on */
+void charge_session_begin(
+    ChargeSession* session,
+    uint32_t tick,
+    uint8_t gauge,
+    uint16_t limit_ma,
+    float idle_current_a);
+
+/* Gauge readings as reported by PowerInfo, negative current means the battery is discharging.
+ * Converted to the current the phone draws at 5 V. */
+void charge_session_add(
+    ChargeSession* session,
+    uint32_t tick,
+    float current_a,
+    float voltage_v,
+    uint8_t gauge);
+
+/* Judged by the tail current, so it follows the phone as it charges */
+ChargeDraw charge_session_draw(const ChargeSession* session);
+
+const char* charge_session_draw_name(ChargeDraw draw);
+
+/* One CSV line matching CHARGE_SESSION_LOG_HEADER, without the date column and newline */
+size_t charge_session_format(
+    const ChargeSession* session,
+    const char* identity,
+    char* out,
+    size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,138 @@
+#include <lib/config/yuricable_config.h>
+#include <storage/storage.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    size_t offset;
+} YuriCableTimingField;
+
+#define TIMING_FIELD(field) {#field, offsetof(SDQTimings, field)}
+
+static const YuriCableTimingField timing_fields[] = {
+    TIMING_FIELD(BREAK_meaningful_min),
+    TIMING_FIELD(BREAK_meaningful_max),
+    TIMING_FIELD(BREAK_meaningful),
+    TIMING_FIELD(BREAK_recovery),
+    TIMING_FIELD(WAKE_meaningful_min),
+    TIMING_FIELD(WAKE_meaningful_max),
+    TIMING_FIELD(WAKE_meaningful),
+    TIMING_FIELD(WAKE_recovery),
+    TIMING_FIELD(ZERO_meaningful_min),
+    TIMING_FIELD(ZERO_meaningful_max),
+    TIMING_FIELD(ZERO_meaningful),
+    TIMING_FIELD(ZERO_recovery),
+    TIMING_FIELD(ONE_meaningful_min),
+    TIMING_FIELD(ONE_meaningful_max),
+    TIMING_FIELD(ONE_meaningful),
+    TIMING_FIELD(ONE_recovery),
+    TIMING_FIELD(ZERO_STOP_recovery),
+    TIMING_FIELD(ONE_STOP_recovery),
+};
+
+static uint8_t yuricable_config_crc(const YuriCableConfig* config) {
+    crc_t crc = crc_init();
+    crc = crc_update(crc, config, offsetof(YuriCableConfig, crc));
+    return crc_finalize(crc);
+}
+
+void yuricable_config_defaults(YuriCableConfig* config) {
+    memset(config, 0, sizeof(YuriCableConfig));
+    config->magic = YURICABLE_CONFIG_MAGIC;
+    config->version = YURICABLE_CONFIG_VERSION;
+    config->size = sizeof(YuriCableConfig);
+    config->bridge.vcp_ch = 1;
+    config->bridge.uart_ch = 0;
+    config->bridge.baudrate_mode = 0;
+    config->bridge.baudrate = 115200;
+    config->timings = sdq_timings;
+    config->default_mode = SDQDeviceCommand_NONE;
+    config->led_enabled = 1;
+    config->bridge_policy = YuriCableBridgeOnDemand;
+    config->auto_rearm = 0;
+    config->unplug_quiet_ms = PRODUCTION_UNPLUG_QUIET_MS;
+    config->low_power = 0;
+    config->charge_identity = SDQChargeIdentityCable;
+    config->charge_limit_ma = CHARGE_SESSION_LIMIT_DEFAULT_MA;
+}
+
+static bool yuricable_config_read(Storage* storage, const char* path, YuriCableConfig* config) {
+    File* file = storage_file_alloc(storage);
+    bool result = false;
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        result = storage_file_read(file, config, sizeof(YuriCableConfig)) ==
+                     sizeof(YuriCableConfig) &&
+                 config->magic == YURICABLE_CONFIG_MAGIC &&
+                 config->version == YURICABLE_CONFIG_VERSION &&
+                 config->size == sizeof(YuriCableConfig) &&
+                 config->crc == yuricable_config_crc(config);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    return result;
+}
+
+bool yuricable_config_load(YuriCableConfig* config) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    // The temporary file is only left over when a save was cut short before the rename
+    bool result = yuricable_config_read(storage, YURICABLE_CONFIG_PATH, config) ||
+                  yuricable_config_read(storage, YURICABLE_CONFIG_TMP_PATH, config);
+    furi_record_close(RECORD_STORAGE);
+    if(!result) {
+        yuricable_config_defaults(config);
+    }
+    return result;
+}
+
+bool yuricable_config_save(YuriCableConfig* config) {
+    config->magic = YURICABLE_CONFIG_MAGIC;
+    config->version = YURICABLE_CONFIG_VERSION;
+    config->size = sizeof(YuriCableConfig);
+    config->crc = yuricable_config_crc(config);
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool result =
+        storage_file_open(file, YURICABLE_CONFIG_TMP_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+        storage_file_write(file, config, sizeof(YuriCableConfig)) == sizeof(YuriCableConfig) &&
+        storage_file_sync(file);
+    storage_file_close(file);
+    storage_file_free(file);
+    if(result) {
+        storage_common_remove(storage, YURICABLE_CONFIG_PATH);
+        result = storage_common_rename(
+                     storage, YURICABLE_CONFIG_TMP_PATH, YURICABLE_CONFIG_PATH) == FSE_OK;
+    }
+    if(!result) {
+        FURI_LOG_E("YuriConfig", "Failed to save config");
+    }
+    furi_record_close(RECORD_STORAGE);
+    return result;
+}
+
+bool yuricable_config_set_timing(SDQTimings* timings, const char* name, uint32_t value_us) {
+    for(size_t i = 0; i < COUNT_OF(timing_fields); i++) {
+        if(strcmp(timing_fields[i].name, name) == 0) {
+            *(uint32_t*)((uint8_t*)timings + timing_fields[i].offset) = value_us;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t yuricable_config_describe_timings(const SDQTimings* timings, char* out, size_t size) {
+    size_t len = 0;
+    for(size_t i = 0; i < COUNT_OF(timing_fields) && len < size; i++) {
+        int n = snprintf(
+            out + len,
+            size - len,
+            "%s%s %lu",
+            i ? "\r\n" : "",
+            timing_fields[i].name,
+            *(const uint32_t*)((const uint8_t*)timings + timing_fields[i].offset));
+        if(n < 0) break;
+        len += n;
+    }
+    return len < size ? len : size - 1;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lib/sdq/sdq_device.h>
+#include <lib/production/production.h>
+#include <lib/charge_session/charge_session.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define YURICABLE_CONFIG_PATH STORAGE_APP_DATA_PATH_PREFIX "/yuricable.cfg"
+#define YURICABLE_CONFIG_TMP_PATH STORAGE_APP_DATA_PATH_PREFIX "/yuricable.cfg.tmp"
+#define YURICABLE_CONFIG_MAGIC 0x47464359 // "YCFG"
+#define YURICABLE_CONFIG_VERSION 4
+
+typedef enum {
+    // Started by the DCSD scene and stopped again when it is left
+    YuriCableBridgeOnDemand,
+    // Started on first use, then kept until the app exits
+    YuriCableBridgeKeepWarm,
+    // Started with the app
+    YuriCableBridgeAlways,
+} YuriCableBridgePolicy;
+
+/* Stored on SD exactly as it is in memory, so loading is a single read straight into the
+ * struct. A file written by a build with another layout fails the version or size check and
+ * the defaults are used instead. */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    UsbUartConfig bridge;
+    SDQTimings timings;
+    uint8_t default_mode;
+    uint8_t led_enabled;
+    uint8_t bridge_policy;
+    // Production mode: arm the engine again for the next phone once one is unplugged
+    uint8_t auto_rearm;
+    uint16_t unplug_quiet_ms;
+    // Let the core stop while waiting for a phone, see sdq_device_set_low_power
+    uint8_t low_power;
+    // 5V Charging: SDQChargeIdentity shown to the phone and the draw that cuts 5V
+    uint8_t charge_identity;
+    uint16_t charge_limit_ma;
+    // crc8 over everything before it
+    uint8_t crc;
+} YuriCableConfig;
+
+void yuricable_config_defaults(YuriCableConfig* config);
+
+/* False if the file is missing or invalid, config holds the defaults then */
+bool yuricable_config_load(YuriCableConfig* config);
+
+/* Written to a temporary file first and renamed over the old one, a power cut leaves either
+ * the old or the new config behind */
+bool yuricable_config_save(YuriCableConfig* config);
+
+/* Name based access to the SDQTimings fields for tuning from the command port */
+bool yuricable_config_set_timing(SDQTimings* timings, const char* name, uint32_t value_us);
+size_t yuricable_config_describe_timings(const SDQTimings* timings, char* out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
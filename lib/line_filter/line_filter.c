@@ -0,0 +1,173 @@
+#include <lib/line_filter/line_filter.h>
+#include <stdio.h>
+#include <string.h>
+
+void line_filter_init(LineFilter* filter) {
+    memset(filter, 0, sizeof(LineFilter));
+}
+
+void line_filter_clear(LineFilter* filter) {
+    filter->count = 0;
+    filter->include_mask = 0;
+    filter->exclude_mask = 0;
+    filter->hits = 0;
+    filter->rate = 0;
+    filter->limited_pending = 0;
+    filter->line_len = 0;
+    filter->state = LineFilterStateCollect;
+}
+
+bool line_filter_add(LineFilter* filter, const char* pattern, bool exclude) {
+    if(pattern[0] == 0 || filter->count >= LINE_FILTER_PATTERNS) return false;
+    const uint8_t slot = filter->count++;
+    strncpy(filter->patterns[slot], pattern, STREAM_MATCH_MAX_LEN);
+    filter->patterns[slot][STREAM_MATCH_MAX_LEN] = 0;
+    stream_match_init(&filter->match[slot], filter->patterns[slot]);
+    if(exclude) {
+        filter->exclude_mask |= (1 << slot);
+    } else {
+        filter->include_mask |= (1 << slot);
+    }
+    return true;
+}
+
+void line_filter_set_rate(LineFilter* filter, uint32_t lines_per_s) {
+    if(lines_per_s > LINE_FILTER_RATE_MAX) lines_per_s = LINE_FILTER_RATE_MAX;
+    filter->rate = lines_per_s;
+    filter->tokens = lines_per_s * 1000;
+    filter->limited_pending = 0;
+}
+
+bool line_filter_active(const LineFilter* filter) {
+    return filter->count > 0 || filter->rate > 0;
+}
+
+static bool line_filter_take_token(LineFilter* filter, uint32_t tick) {
+    if(filter->rate == 0) return true;
+    const uint32_t capacity = filter->rate * 1000;
+    const uint32_t elapsed = tick - filter->refill_tick;
+    filter->refill_tick = tick;
+    if(elapsed >= 1000 || filter->tokens + elapsed * filter->rate >= capacity) {
+        filter->tokens = capacity;
+    } else {
+        filter->tokens += elapsed * filter->rate;
+    }
+    if(filter->tokens < 1000) return false;
+    filter->tokens -= 1000;
+    return true;
+}
+
+static void line_filter_decide(
+    LineFilter* filter,
+    uint32_t tick,
+    LineFilterOutput output,
+    void* context) {
+    const bool included = filter->include_mask == 0 || (filter->hits & filter->include_mask);
+    if(!included || (filter->hits & filter->exclude_mask)) {
+        filter->state = LineFilterStateDrop;
+        filter->filtered++;
+    } else if(!line_filter_take_token(filter, tick)) {
+        filter->state = LineFilterStateDrop;
+        filter->limited++;
+        filter->limited_pending++;
+    } else {
+        filter->state = LineFilterStatePass;
+        filter->passed++;
+        if(filter->limited_pending) {
+            char note[40];
+            int len = snprintf(
+                note,
+                sizeof(note),
+                "[%lu lines rate limited]\r\n",
+                (unsigned long)filter->limited_pending);
+            output((uint8_t*)note, len, context);
+            filter->limited_pending = 0;
+        }
+        output(filter->line, filter->line_len, context);
+    }
+    filter->line_len = 0;
+}
+
+static void line_filter_line_end(LineFilter* filter) {
+    for(uint8_t i = 0; i < filter->count; i++) {
+        stream_match_reset(&filter->match[i]);
+    }
+    filter->hits = 0;
+    filter->line_len = 0;
+    filter->state = LineFilterStateCollect;
+}
+
+void line_filter_feed(
+    LineFilter* filter,
+    const uint8_t* data,
+    size_t len,
+    uint32_t tick,
+    LineFilterOutput output,
+    void* context) {
+    filter->line_tick = tick;
+    size_t pass_from = 0;
+    for(size_t i = 0; i < len; i++) {
+        const uint8_t byte = data[i];
+        if(filter->state == LineFilterStateCollect) {
+            for(uint8_t p = 0; p < filter->count; p++) {
+                if(stream_match_feed(&filter->match[p], byte)) filter->hits |= (1 << p);
+            }
+            filter->line[filter->line_len++] = byte;
+            if(filter->hits & filter->exclude_mask) {
+                // Known to be dropped, no need to keep collecting it
+                line_filter_decide(filter, tick, output, context);
+            } else if(byte != '\n' && filter->line_len == LINE_FILTER_LINE_MAX) {
+                line_filter_decide(filter, tick, output, context);
+            }
+            pass_from = i + 1;
+        }
+        if(byte == '\n') {
+            if(filter->state == LineFilterStateCollect) {
+                line_filter_decide(filter, tick, output, context);
+            } else if(filter->state == LineFilterStatePass && i + 1 > pass_from) {
+                output(data + pass_from, i + 1 - pass_from, context);
+            }
+            line_filter_line_end(filter);
+            pass_from = i + 1;
+        }
+    }
+    if(filter->state == LineFilterStatePass && len > pass_from) {
+        output(data + pass_from, len - pass_from, context);
+    }
+}
+
+uint32_t line_filter_poll(
+    LineFilter* filter,
+    uint32_t tick,
+    uint32_t idle_ms,
+    LineFilterOutput output,
+    void* context) {
+    if(filter->state != LineFilterStateCollect || filter->line_len == 0) return UINT32_MAX;
+    const uint32_t idle = tick - filter->line_tick;
+    if(idle < idle_ms) return idle_ms - idle;
+    line_filter_decide(filter, tick, output, context);
+    return UINT32_MAX;
+}
+
+size_t line_filter_describe(const LineFilter* filter, char* out, size_t size) {
+    size_t written = 0;
+    for(uint8_t i = 0; i < filter->count && written < size; i++) {
+        written += snprintf(
+            out + written,
+            size - written,
+            "%c%s\r\n",
+            (filter->exclude_mask & (1 << i)) ? '-' : '+',
+            filter->patterns[i]);
+    }
+    if(written < size) {
+        written += snprintf(
+            out + written,
+            size - written,
+            "rate %lu/s\r\npassed %lu filtered %lu limited %lu",
+            (unsigned long)filter->rate,
+            (unsigned long)filter->passed,
+            (unsigned long)filter->filtered,
+            (unsigned long)filter->limited);
+    }
+    return written < size ? written : size - 1;
+}
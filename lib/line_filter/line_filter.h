@@ -0,0 +1,89 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lib/stream_match/stream_match.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LINE_FILTER_PATTERNS 8
+// Longer lines are decided on what was seen up to here, the rest follows that decision
+#define LINE_FILTER_LINE_MAX 256
+// Above what a UART can carry, and low enough that a full bucket plus a refill fits 32 bits
+#define LINE_FILTER_RATE_MAX 1000000
+
+typedef void (*LineFilterOutput)(const uint8_t* data, size_t len, void* context);
+
+typedef enum {
+    LineFilterStateCollect,
+    LineFilterStatePass,
+    LineFilterStateDrop,
+} LineFilterState;
+
+/* Filters a byte stream line by line. A line passes when it contains one of the include
+ * patterns (or there are none), none of the exclude patterns, and the line rate limit has room
+ * for it. Patterns are matched incrementally while the line is collected, so every byte is
+ * looked at once, and an exclude hit drops the rest of the line without buffering it. */
+typedef struct {
+    char patterns[LINE_FILTER_PATTERNS][STREAM_MATCH_MAX_LEN + 1];
+    StreamMatch match[LINE_FILTER_PATTERNS];
+    uint8_t count;
+    uint8_t include_mask;
+    uint8_t exclude_mask;
+    uint8_t hits;
+
+    // Token bucket in 1/1000 lines, holds at most one second worth of lines
+    uint32_t rate;
+    uint32_t tokens;
+    uint32_t refill_tick;
+
+    uint32_t passed;
+    uint32_t filtered;
+    uint32_t limited;
+    uint32_t limited_pending;
+
+    LineFilterState state;
+    uint32_t line_tick;
+    size_t line_len;
+    uint8_t line[LINE_FILTER_LINE_MAX];
+} LineFilter;
+
+void line_filter_init(LineFilter* filter);
+
+/* Remove all patterns and the rate limit */
+void line_filter_clear(LineFilter* filter);
+
+/* False if the pattern is empty or all slots are taken */
+bool line_filter_add(LineFilter* filter, const char* pattern, bool exclude);
+
+/* Lines per second, 0 disables the limit, larger than LINE_FILTER_RATE_MAX is clamped */
+void line_filter_set_rate(LineFilter* filter, uint32_t lines_per_s);
+
+/* True when the filter can drop anything, an idle filter should be bypassed */
+bool line_filter_active(const LineFilter* filter);
+
+void line_filter_feed(
+    LineFilter* filter,
+    const uint8_t* data,
+    size_t len,
+    uint32_t tick,
+    LineFilterOutput output,
+    void* context);
+
+/* Decide a line that has been waiting for its end longer than `idle_ms`, so prompts without a
+ * newline still show up. Returns the ms until the pending line is due, FuriWaitForever style
+ * UINT32_MAX when nothing is pending. */
+uint32_t line_filter_poll(
+    LineFilter* filter,
+    uint32_t tick,
+    uint32_t idle_ms,
+    LineFilterOutput output,
+    void* context);
+
+size_t line_filter_describe(const LineFilter* filter, char* out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+#include <lib/low_power/low_power.h>
+#include <stdio.h>
+#include <string.h>
+
+void low_power_begin(LowPowerStats* stats, uint32_t now, uint32_t wakes) {
+    memset(stats, 0, sizeof(LowPowerStats));
+    stats->wakes_seen = wakes;
+    stats->doze_tick = now;
+}
+
+LowPowerAction low_power_update(LowPowerStats* stats, const LowPowerInput* input) {
+    if(input->wakes != stats->wakes_seen) {
+        // Only the newest wake is measured when the worker was too slow to see each one
+        stats->wakes += input->wakes - stats->wakes_seen;
+        stats->wakes_seen = input->wakes;
+        if(input->wake_late) {
+            stats->late++;
+        } else {
+            stats->latency_count++;
+            stats->latency_last_us = input->wake_latency_us;
+            stats->latency_sum_us += input->wake_latency_us;
+            if(input->wake_latency_us > stats->latency_max_us) {
+                stats->latency_max_us = input->wake_latency_us;
+            }
+        }
+        stats->idle_ms = input->wake_tick - stats->doze_tick;
+        return LowPowerActionWoke;
+    }
+    if(input->awake && !input->connected &&
+       input->now - input->last_edge_tick >= LOW_POWER_AWAKE_HOLD_MS) {
+        stats->doze_tick = input->now;
+        return LowPowerActionDoze;
+    }
+    return LowPowerActionNone;
+}
+
+void low_power_set_idle_current(LowPowerStats* stats, int32_t current_ma) {
+    stats->idle_ma = current_ma;
+    stats->idle_valid = true;
+}
+
+size_t low_power_format(const LowPowerStats* stats, char* out, size_t size) {
+    int len = snprintf(
+        out,
+        size,
+        "wakes %lu late %lu, latency last %lu avg %lu max %lu us",
+        stats->wakes,
+        stats->late,
+        stats->latency_last_us,
+        stats->latency_count ? (uint32_t)(stats->latency_sum_us / stats->latency_count) : 0UL,
+        stats->latency_max_us);
+    if(len >= 0 && (size_t)len < size && stats->idle_valid) {
+        int idle = snprintf(
+            out + len,
+            size - len,
+            "\r\nidle %ld mA over %lu ms",
+            (long)stats->idle_ma,
+            stats->idle_ms);
+        len = idle < 0 ? idle : len + idle;
+    }
+    if(len < 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
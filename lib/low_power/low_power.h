@@ -0,0 +1,64 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Each doze makes the next session pay the wake latency, so the hold bridges the pauses between
+ * the sessions of one plug. Guessing an unplug too early only costs one slow wake, which is why
+ * this is shorter than the production unplug window. */
+#define LOW_POWER_AWAKE_HOLD_MS 2000
+
+/* What the SDQ engine looks like right now. Wakes count the edges that ended a low-power wait,
+ * the latency and late flag belong to the most recent one. */
+typedef struct {
+    uint32_t now;
+    bool awake;
+    bool connected;
+    uint32_t wakes;
+    uint32_t wake_tick;
+    uint32_t wake_latency_us;
+    bool wake_late;
+    uint32_t last_edge_tick;
+} LowPowerInput;
+
+typedef enum {
+    LowPowerActionNone,
+    // The engine woke up since the last look, the idle period just ended
+    LowPowerActionWoke,
+    // The ID pin has been quiet long enough, let the core stop again
+    LowPowerActionDoze,
+} LowPowerAction;
+
+/* Wake and idle figures of the low-power wait since it was switched on */
+typedef struct {
+    uint32_t wakes_seen;
+    uint32_t doze_tick;
+
+    uint32_t wakes;
+    // The BREAK was already over when the handler ran, that phone needs a second poll
+    uint32_t late;
+    uint32_t latency_count;
+    uint32_t latency_last_us;
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;
+    // Fuel gauge average current read on the last wake, it covers the idle period before it
+    uint32_t idle_ms;
+    int32_t idle_ma;
+    bool idle_valid;
+} LowPowerStats;
+
+void low_power_begin(LowPowerStats* stats, uint32_t now, uint32_t wakes);
+
+LowPowerAction low_power_update(LowPowerStats* stats, const LowPowerInput* input);
+
+void low_power_set_idle_current(LowPowerStats* stats, int32_t current_ma);
+
+size_t low_power_format(const LowPowerStats* stats, char* out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,143 @@
+#include <lib/power_view/power_view.h>
+#include <furi.h>
+#include <gui/elements.h>
+#include <stdio.h>
+
+#define POWER_VIEW_GRAPH_X 0
+#define POWER_VIEW_GRAPH_Y 24
+#define POWER_VIEW_GRAPH_W (POWER_VIEW_SAMPLES + 2)
+#define POWER_VIEW_GRAPH_H 40
+// Keep idle noise from filling the whole graph height
+#define POWER_VIEW_SCALE_MIN_MA 100
+
+struct PowerView {
+    View* view;
+};
+
+typedef struct {
+    const char* title;
+    const char* status;
+    // Load current is what the phone pulls from the battery through OTG, clamped at 0
+    uint16_t load_ma[POWER_VIEW_SAMPLES];
+    uint16_t voltage_mv[POWER_VIEW_SAMPLES];
+    uint8_t head;
+    uint8_t count;
+} PowerViewModel;
+
+static uint16_t power_view_peak(const PowerViewModel* model) {
+    uint16_t peak = POWER_VIEW_SCALE_MIN_MA;
+    for(uint8_t i = 0; i < model->count; i++) {
+        if(model->load_ma[i] > peak) peak = model->load_ma[i];
+    }
+    return peak;
+}
+
+static void power_view_draw_callback(Canvas* canvas, void* _model) {
+    PowerViewModel* model = _model;
+    char line[32];
+    canvas_clear(canvas);
+    canvas_set_color(canvas, ColorBlack);
+    canvas_set_font(canvas, FontPrimary);
+    if(model->title) {
+        canvas_draw_str(canvas, 0, 10, model->title);
+    }
+    if(model->status) {
+        canvas_draw_str_aligned(canvas, 127, 10, AlignRight, AlignBottom, model->status);
+    }
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_frame(
+        canvas, POWER_VIEW_GRAPH_X, POWER_VIEW_GRAPH_Y, POWER_VIEW_GRAPH_W, POWER_VIEW_GRAPH_H);
+    if(model->count == 0) {
+        canvas_draw_str(canvas, 0, 21, "Connect an iPhone now!");
+        return;
+    }
+
+    const uint8_t last = (model->head + POWER_VIEW_SAMPLES - 1) % POWER_VIEW_SAMPLES;
+    const uint16_t peak = power_view_peak(model);
+    snprintf(
+        line,
+        sizeof(line),
+        "%umA %u.%02uV",
+        model->load_ma[last],
+        model->voltage_mv[last] / 1000,
+        (model->voltage_mv[last] % 1000) / 10);
+    canvas_draw_str(canvas, 0, 21, line);
+    snprintf(line, sizeof(line), "max %u", peak);
+    canvas_draw_str_aligned(canvas, 127, 21, AlignRight, AlignBottom, line);
+
+    // Newest sample on the right edge, older ones scroll off to the left
+    const uint8_t inner_h = POWER_VIEW_GRAPH_H - 2;
+    const uint8_t base_y = POWER_VIEW_GRAPH_Y + POWER_VIEW_GRAPH_H - 2;
+    const uint8_t first = (model->head + POWER_VIEW_SAMPLES - model->count) % POWER_VIEW_SAMPLES;
+    uint8_t x = POWER_VIEW_GRAPH_X + 1 + (POWER_VIEW_SAMPLES - model->count);
+    for(uint8_t i = 0; i < model->count; i++, x++) {
+        const uint16_t load = model->load_ma[(first + i) % POWER_VIEW_SAMPLES];
+        const uint8_t h = (uint32_t)load * (inner_h - 1) / peak;
+        canvas_draw_line(canvas, x, base_y, x, base_y - h);
+    }
+}
+
+PowerView* power_view_alloc(void) {
+    PowerView* power_view = malloc(sizeof(PowerView));
+    power_view->view = view_alloc();
+    view_allocate_model(power_view->view, ViewModelTypeLocking, sizeof(PowerViewModel));
+    view_set_context(power_view->view, power_view);
+    view_set_draw_callback(power_view->view, power_view_draw_callback);
+    with_view_model(
+        power_view->view,
+        PowerViewModel * model,
+        {
+            model->title = NULL;
+            model->status = NULL;
+        },
+        false);
+    return power_view;
+}
+
+void power_view_free(PowerView* power_view) {
+    furi_assert(power_view);
+    view_free(power_view->view);
+    free(power_view);
+}
+
+View* power_view_get_view(PowerView* power_view) {
+    furi_assert(power_view);
+    return power_view->view;
+}
+
+void power_view_reset(PowerView* power_view, const char* title) {
+    furi_assert(power_view);
+    with_view_model(
+        power_view->view,
+        PowerViewModel * model,
+        {
+            model->title = title;
+            model->status = NULL;
+            model->head = 0;
+            model->count = 0;
+        },
+        true);
+}
+
+void power_view_set_status(PowerView* power_view, const char* status) {
+    furi_assert(power_view);
+    with_view_model(
+        power_view->view, PowerViewModel * model, { model->status = status; }, true);
+}
+
+void power_view_add_sample(PowerView* power_view, float current_a, float voltage_v) {
+    furi_assert(power_view);
+    const float load_ma = -current_a * 1000.0f;
+    const uint16_t load = load_ma <= 0 ? 0 : (load_ma >= UINT16_MAX ? UINT16_MAX : load_ma);
+    const uint16_t voltage = voltage_v > 0 ? voltage_v * 1000.0f : 0;
+    with_view_model(
+        power_view->view,
+        PowerViewModel * model,
+        {
+            model->load_ma[model->head] = load;
+            model->voltage_mv[model->head] = voltage;
+            model->head = (model->head + 1) % POWER_VIEW_SAMPLES;
+            if(model->count < POWER_VIEW_SAMPLES) model->count++;
+        },
+        true);
+}
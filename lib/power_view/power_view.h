@@ -0,0 +1,30 @@
+#pragma once
+#include <gui/view.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One sample per pixel column inside the graph frame
+#define POWER_VIEW_SAMPLES 126
+
+typedef struct PowerView PowerView;
+
+/* Charging mode telemetry. The model keeps a fixed ring of load current and voltage samples,
+ * the draw callback renders only from that ring and never allocates. */
+PowerView* power_view_alloc(void);
+void power_view_free(PowerView* power_view);
+View* power_view_get_view(PowerView* power_view);
+
+/* Title must outlive the view, it is not copied. Clears the sample history. */
+void power_view_reset(PowerView* power_view, const char* title);
+
+/* Short verdict drawn next to the title, NULL hides it. Not copied either. */
+void power_view_set_status(PowerView* power_view, const char* status);
+
+/* Gauge readings as reported by PowerInfo, negative current means the battery is discharging */
+void power_view_add_sample(PowerView* power_view, float current_a, float voltage_v);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,88 @@
+#include <lib/production/production.h>
+#include <stdio.h>
+#include <string.h>
+
+void production_begin(ProductionRun* run, uint32_t quiet_ms) {
+    memset(run, 0, sizeof(ProductionRun));
+    run->quiet_ms = quiet_ms ? quiet_ms : PRODUCTION_UNPLUG_QUIET_MS;
+}
+
+void production_arm(ProductionRun* run, uint32_t sessions) {
+    run->phase = ProductionPhaseArmed;
+    run->sessions_armed = sessions;
+}
+
+static void production_finish(ProductionRun* run, uint32_t unplug_tick) {
+    run->unplug_tick = unplug_tick;
+    run->phones++;
+    if(run->outcome == ProductionOutcomeDone) {
+        run->passed++;
+        run->work_ms_sum += run->done_tick - run->plug_tick;
+    }
+}
+
+ProductionAction production_update(ProductionRun* run, const ProductionInput* input) {
+    switch(run->phase) {
+    case ProductionPhaseArmed:
+        // Contact bounce while plugging in never makes it through the BREAK check, a session
+        // means a phone
+        if(input->sessions == run->sessions_armed) {
+            return ProductionActionNone;
+        }
+        run->phase = ProductionPhaseWorking;
+        run->plug_tick = input->last_edge_tick;
+        // fall through
+    case ProductionPhaseWorking:
+        if(input->executed) {
+            run->outcome = ProductionOutcomeDone;
+            run->done_tick = input->now;
+            run->phase = ProductionPhaseLeaving;
+            return ProductionActionWatch;
+        }
+        if(input->now - input->last_edge_tick >= run->quiet_ms) {
+            run->outcome = ProductionOutcomeUnplugged;
+            run->done_tick = input->last_edge_tick;
+            production_finish(run, input->last_edge_tick);
+            return ProductionActionRearm;
+        }
+        if(input->now - run->plug_tick >= PRODUCTION_TIMEOUT_MS) {
+            run->outcome = ProductionOutcomeTimeout;
+            run->done_tick = input->now;
+            run->phase = ProductionPhaseLeaving;
+            return ProductionActionWatch;
+        }
+        return ProductionActionNone;
+    case ProductionPhaseLeaving:
+        if(input->now - input->last_edge_tick >= run->quiet_ms) {
+            production_finish(run, input->last_edge_tick);
+            return ProductionActionRearm;
+        }
+        return ProductionActionNone;
+    }
+    return ProductionActionNone;
+}
+
+size_t production_format(const ProductionRun* run, const char* mode, char* out, size_t size) {
+    int len = snprintf(
+        out,
+        size,
+        "%s,%s,%lu,%lu",
+        mode,
+        production_outcome_name(run->outcome),
+        (unsigned long)(run->done_tick - run->plug_tick),
+        (unsigned long)(run->unplug_tick - run->plug_tick));
+    if(len < 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+const char* production_outcome_name(ProductionOutcome outcome) {
+    switch(outcome) {
+    case ProductionOutcomeDone:
+        return "done";
+    case ProductionOutcomeUnplugged:
+        return "unplugged";
+    case ProductionOutcomeTimeout:
+        return "timeout";
+    }
+    return "unknown";
+}
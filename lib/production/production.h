@@ -0,0 +1,79 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRODUCTION_LOG_NAME "production_log.csv"
+#define PRODUCTION_LOG_HEADER "date,mode,outcome,work_ms,total_ms"
+// Tristar polls far more often than this while a phone is plugged in
+#define PRODUCTION_UNPLUG_QUIET_MS 3000
+// A phone that is not done by then is logged as a timeout and has to be replugged
+#define PRODUCTION_TIMEOUT_MS 60000
+
+typedef enum {
+    // Engine listening, no phone yet
+    ProductionPhaseArmed,
+    // A phone opened an SDQ session, the command is not through yet
+    ProductionPhaseWorking,
+    // Outcome known, waiting for the phone to be unplugged
+    ProductionPhaseLeaving,
+} ProductionPhase;
+
+typedef enum {
+    ProductionOutcomeDone,
+    ProductionOutcomeUnplugged,
+    ProductionOutcomeTimeout,
+} ProductionOutcome;
+
+typedef enum {
+    ProductionActionNone,
+    // Stop the engine and only watch the ID pin for the unplug
+    ProductionActionWatch,
+    // The phone is gone and its record is ready, arm the engine for the next one
+    ProductionActionRearm,
+} ProductionAction;
+
+/* What the SDQ engine looks like right now. Sessions count valid BREAKs, the edge tick is the
+ * last falling edge seen on the ID pin in either engine or watch mode. */
+typedef struct {
+    uint32_t now;
+    uint32_t sessions;
+    uint32_t last_edge_tick;
+    bool executed;
+} ProductionInput;
+
+/* Auto rearm bookkeeping for one bench run, one record per phone */
+typedef struct {
+    ProductionPhase phase;
+    ProductionOutcome outcome;
+    uint32_t quiet_ms;
+    uint32_t sessions_armed;
+    uint32_t plug_tick;
+    uint32_t done_tick;
+    uint32_t unplug_tick;
+
+    uint32_t phones;
+    uint32_t passed;
+    uint64_t work_ms_sum;
+} ProductionRun;
+
+void production_begin(ProductionRun* run, uint32_t quiet_ms);
+
+/* Start waiting for the next phone, sessions is the engine count at the time */
+void production_arm(ProductionRun* run, uint32_t sessions);
+
+ProductionAction production_update(ProductionRun* run, const ProductionInput* input);
+
+/* One CSV line of the phone that just left, matching PRODUCTION_LOG_HEADER without the date
+ * column and newline */
+size_t production_format(const ProductionRun* run, const char* mode, char* out, size_t size);
+
+const char* production_outcome_name(ProductionOutcome outcome);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,167 @@
+#include <lib/profile/sdq_profile.h>
+#include <lib/config/yuricable_config.h>
+#include <lib/text_file/text_file.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    size_t offset;
+    size_t size;
+} SDQProfileResponseField;
+
+#define RESPONSE_FIELD(field) \
+    {#field, offsetof(TRISTART_RESPONSES, field), sizeof(((TRISTART_RESPONSES*)0)->field)}
+
+static const SDQProfileResponseField response_fields[] = {
+    RESPONSE_FIELD(DFU),
+    RESPONSE_FIELD(RESET_DEVICE),
+    RESPONSE_FIELD(USB_UART_JTAG),
+    RESPONSE_FIELD(USB_SPAM_JTAG),
+    RESPONSE_FIELD(USB_UART),
+    RESPONSE_FIELD(USB_A_CHARGING_CABLE),
+    RESPONSE_FIELD(POWER_ANSWER),
+    RESPONSE_FIELD(SN),
+    RESPONSE_FIELD(KEYSET),
+    RESPONSE_FIELD(UNKNOWN_76_ANSWER),
+};
+
+// Space separated hex bytes, all of them have to fit
+static size_t sdq_profile_parse_hex(const char* str, uint8_t* out, size_t size) {
+    size_t len = 0;
+    char* end;
+    while(*str) {
+        unsigned long byte = strtoul(str, &end, 16);
+        if(end == str || byte > 0xFF || len == size) return 0;
+        out[len++] = byte;
+        str = end;
+        while(*str == ' ') str++;
+    }
+    return len;
+}
+
+// Decimal only, a value strtoul cannot read in full is rejected rather than taken as 0
+static bool sdq_profile_parse_number(const char* str, uint32_t max, uint32_t* out) {
+    char* end;
+    const unsigned long value = strtoul(str, &end, 10);
+    if(end == str || *end != 0 || str[0] == '-' || value > max) return false;
+    *out = value;
+    return true;
+}
+
+static void sdq_profile_init(SDQProfile* profile, const char* name) {
+    memset(profile, 0, sizeof(SDQProfile));
+    strncpy(profile->name, name, SDQ_PROFILE_NAME_LEN - 1);
+    uint32_t* timings = (uint32_t*)&profile->timings;
+    for(size_t i = 0; i < sizeof(SDQTimings) / sizeof(uint32_t); i++) {
+        timings[i] = SDQ_PROFILE_TIMING_UNSET;
+    }
+    profile->responses = responses;
+    profile->power_delay_us = SDQ_POWER_DELAY_US;
+    profile->charging_delay_us = SDQ_CHARGING_DELAY_US;
+}
+
+static bool sdq_profile_set(SDQProfile* profile, const char* name, const char* value) {
+    if(strcmp(name, "key") == 0) {
+        uint8_t key[2];
+        if(sdq_profile_parse_hex(value, key, sizeof(key)) != sizeof(key)) return false;
+        profile->key = (key[0] << 8) | key[1];
+        return true;
+    }
+    uint32_t number;
+    uint16_t* delay = NULL;
+    if(strcmp(name, "power_delay") == 0) delay = &profile->power_delay_us;
+    if(strcmp(name, "charging_delay") == 0) delay = &profile->charging_delay_us;
+    if(delay) {
+        if(!sdq_profile_parse_number(value, UINT16_MAX, &number)) return false;
+        *delay = number;
+        return true;
+    }
+    for(size_t i = 0; i < COUNT_OF(response_fields); i++) {
+        if(strcmp(response_fields[i].name, name) == 0) {
+            // The engine always sends the whole frame, so a short or broken line keeps the old one
+            uint8_t frame[sizeof(TRISTART_RESPONSES)];
+            const size_t size = response_fields[i].size;
+            if(sdq_profile_parse_hex(value, frame, size) != size) return false;
+            memcpy((uint8_t*)&profile->responses + response_fields[i].offset, frame, size);
+            return true;
+        }
+    }
+    return sdq_profile_parse_number(value, SDQ_PROFILE_TIMING_UNSET - 1, &number) &&
+           yuricable_config_set_timing(&profile->timings, name, number);
+}
+
+static int sdq_profile_compare(const void* a, const void* b) {
+    return (int)((const SDQProfile*)a)->key - (int)((const SDQProfile*)b)->key;
+}
+
+bool sdq_profile_table_parse(SDQProfileTable* table, char* text) {
+    table->count = 0;
+    SDQProfile* profile = NULL;
+    bool has_key = false;
+    for(char* line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        line = text_file_trim(line);
+        if(line[0] == 0 || line[0] == '#') continue;
+        if(line[0] == '[') {
+            // A profile without key can never be selected, its slot is reused
+            if(profile && has_key) table->count++;
+            profile = NULL;
+            has_key = false;
+            if(table->count == SDQ_PROFILE_MAX) break;
+            char* end = strchr(line, ']');
+            if(!end) continue;
+            *end = 0;
+            profile = &table->profiles[table->count];
+            sdq_profile_init(profile, line + 1);
+            continue;
+        }
+        char* value = strchr(line, '=');
+        if(!profile || !value) continue;
+        *value++ = 0;
+        char* name = text_file_trim(line);
+        value = text_file_trim(value);
+        if(!sdq_profile_set(profile, name, value)) {
+            FURI_LOG_W("SDQProfile", "%s: bad entry %s", profile->name, name);
+        } else if(strcmp(name, "key") == 0) {
+            has_key = true;
+        }
+    }
+    if(profile && has_key) table->count++;
+    qsort(table->profiles, table->count, sizeof(SDQProfile), sdq_profile_compare);
+    return table->count > 0;
+}
+
+SDQProfileTable* sdq_profile_table_load(const char* path) {
+    char* text = text_file_read(path, SDQ_PROFILE_FILE_MAX);
+    SDQProfileTable* table = NULL;
+    if(text) {
+        table = malloc(sizeof(SDQProfileTable));
+        if(!sdq_profile_table_parse(table, text)) {
+            free(table);
+            table = NULL;
+        }
+        free(text);
+    }
+    return table;
+}
+
+void sdq_profile_table_free(SDQProfileTable* table) {
+    free(table);
+}
+
+const SDQProfile* sdq_profile_lookup(const SDQProfileTable* table, uint16_t key) {
+    if(!table) return NULL;
+    uint8_t lo = 0;
+    uint8_t hi = table->count;
+    while(lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        if(table->profiles[mid].key == key) return &table->profiles[mid];
+        if(table->profiles[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
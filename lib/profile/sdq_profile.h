@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lib/sdq/sdq_device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SDQ_PROFILE_PATH STORAGE_APP_DATA_PATH_PREFIX "/profiles.txt"
+#define SDQ_PROFILE_MAX 8
+#define SDQ_PROFILE_NAME_LEN 16
+// The whole file is read at once, profiles are small
+#define SDQ_PROFILE_FILE_MAX 4096
+// Marks a timing the profile leaves as configured
+#define SDQ_PROFILE_TIMING_UNSET UINT32_MAX
+
+/* What one phone model needs different from the defaults. Selected by the two argument bytes
+ * of the Tristar 0x76 request, which is among the first frames of every session. */
+struct SDQProfile {
+    char name[SDQ_PROFILE_NAME_LEN];
+    uint16_t key;
+    SDQTimings timings;
+    TRISTART_RESPONSES responses;
+    uint16_t power_delay_us;
+    uint16_t charging_delay_us;
+};
+
+/* Sorted by key, so the lookup from the SDQ interrupt is a binary search */
+struct SDQProfileTable {
+    uint8_t count;
+    SDQProfile profiles[SDQ_PROFILE_MAX];
+};
+
+/* Compiles the profile file into a table, NULL if there is no file or no valid profile in it.
+ *
+ * [XS]
+ * key = 01 02
+ * ZERO_recovery = 4
+ * UNKNOWN_76_ANSWER = 77 02 01 02 80 60 01 39 3a 44 3e c9
+ * power_delay = 30
+ *
+ * Timing and response names are the SDQTimings and TRISTART_RESPONSES fields. */
+SDQProfileTable* sdq_profile_table_load(const char* path);
+void sdq_profile_table_free(SDQProfileTable* table);
+
+/* Parses a whole file image, text is modified in place */
+bool sdq_profile_table_parse(SDQProfileTable* table, char* text);
+
+const SDQProfile* sdq_profile_lookup(const SDQProfileTable* table, uint16_t key);
+
+#ifdef __cplusplus
+}
+#endif
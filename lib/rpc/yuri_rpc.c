@@ -0,0 +1,73 @@
+#include <lib/rpc/yuri_rpc.h>
+#include <string.h>
+
+void yuri_rpc_parser_reset(YuriRpcParser* parser) {
+    parser->pos = 0;
+}
+
+bool yuri_rpc_parser_feed(YuriRpcParser* parser, uint8_t byte) {
+    if(parser->pos == 0) {
+        if(byte == YURI_RPC_SOF) {
+            parser->header[0] = byte;
+            parser->pos = 1;
+            parser->crc = crc_init();
+        }
+        return false;
+    }
+    if(parser->pos < YURI_RPC_HEADER_SIZE) {
+        parser->header[parser->pos++] = byte;
+        parser->crc = crc_update(parser->crc, &byte, 1);
+        if(parser->pos == YURI_RPC_HEADER_SIZE) {
+            YuriRpcFrame* frame = &parser->frame;
+            frame->seq = parser->header[1];
+            frame->cmd = parser->header[2];
+            frame->flags = parser->header[3];
+            frame->status = parser->header[4];
+            frame->len = parser->header[5] | (parser->header[6] << 8);
+            if(frame->len > YURI_RPC_MAX_PAYLOAD) {
+                parser->pos = 0;
+            }
+        }
+        return false;
+    }
+    YuriRpcFrame* frame = &parser->frame;
+    const size_t offset = parser->pos - YURI_RPC_HEADER_SIZE;
+    if(offset < frame->len) {
+        frame->payload[offset] = byte;
+        parser->crc = crc_update(parser->crc, &byte, 1);
+        parser->pos++;
+        return false;
+    }
+    parser->pos = 0;
+    if(crc_finalize(parser->crc) != byte) {
+        parser->crc_errors++;
+        return false;
+    }
+    return true;
+}
+
+size_t yuri_rpc_encode(
+    uint8_t* out,
+    size_t out_size,
+    uint8_t seq,
+    uint8_t cmd,
+    uint8_t flags,
+    uint8_t status,
+    const uint8_t* payload,
+    size_t len) {
+    if(len > YURI_RPC_MAX_PAYLOAD || out_size < YURI_RPC_HEADER_SIZE + len + 1) {
+        return 0;
+    }
+    out[0] = YURI_RPC_SOF;
+    out[1] = seq;
+    out[2] = cmd;
+    out[3] = flags;
+    out[4] = status;
+    out[5] = len & 0xFF;
+    out[6] = (len >> 8) & 0xFF;
+    if(len) memcpy(out + YURI_RPC_HEADER_SIZE, payload, len);
+    crc_t crc = crc_init();
+    crc = crc_update(crc, out + 1, YURI_RPC_HEADER_SIZE - 1 + len);
+    out[YURI_RPC_HEADER_SIZE + len] = crc_finalize(crc);
+    return YURI_RPC_HEADER_SIZE + len + 1;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lib/crc/crc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frame layout, multi-byte fields little endian:
+ *   SOF | seq | cmd | flags | status | len(2) | payload[len] | crc8(seq..payload)
+ * Requests carry status 0, responses echo seq and cmd with YuriRpcFlagResponse set. A streamed
+ * response is a run of frames with YuriRpcFlagMore set, closed by one without it. */
+#define YURI_RPC_SOF         0xA5
+#define YURI_RPC_HEADER_SIZE 7
+#define YURI_RPC_MAX_PAYLOAD 248
+#define YURI_RPC_FRAME_MAX   (YURI_RPC_HEADER_SIZE + YURI_RPC_MAX_PAYLOAD + 1)
+
+typedef enum {
+    YuriRpcCommandHello = 0x00,
+    YuriRpcCommandPing = 0x01,
+    YuriRpcCommandStart = 0x02,
+    YuriRpcCommandStop = 0x03,
+    YuriRpcCommandMode = 0x04,
+    YuriRpcCommandStatus = 0x05,
+    YuriRpcCommandStats = 0x06,
+    // Payload: optional u32 offset, optional u8 UART (0 main, 1 second)
+    YuriRpcCommandLog = 0x07,
+    YuriRpcCommandExit = 0x08,
+} YuriRpcCommand;
+
+typedef enum {
+    YuriRpcFlagMore = (1 << 0),
+    YuriRpcFlagResponse = (1 << 7),
+} YuriRpcFlags;
+
+typedef enum {
+    YuriRpcStatusOk = 0,
+    YuriRpcStatusUnknownCommand,
+    YuriRpcStatusInvalidArgument,
+    YuriRpcStatusBusy,
+    YuriRpcStatusError,
+} YuriRpcStatus;
+
+typedef struct {
+    uint8_t seq;
+    uint8_t cmd;
+    uint8_t flags;
+    uint8_t status;
+    uint16_t len;
+    uint8_t payload[YURI_RPC_MAX_PAYLOAD];
+} YuriRpcFrame;
+
+typedef struct {
+    YuriRpcFrame frame;
+    uint8_t header[YURI_RPC_HEADER_SIZE];
+    size_t pos;
+    crc_t crc;
+    uint32_t crc_errors;
+} YuriRpcParser;
+
+void yuri_rpc_parser_reset(YuriRpcParser* parser);
+
+/* Feed one byte, returns true when parser->frame holds a complete, CRC-checked frame */
+bool yuri_rpc_parser_feed(YuriRpcParser* parser, uint8_t byte);
+
+/* Encode a frame into out, returns the frame size or 0 if it does not fit */
+size_t yuri_rpc_encode(
+    uint8_t* out,
+    size_t out_size,
+    uint8_t seq,
+    uint8_t cmd,
+    uint8_t flags,
+    uint8_t status,
+    const uint8_t* payload,
+    size_t len);
+
+static inline void yuri_rpc_put_u32(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+}
+
+static inline uint32_t yuri_rpc_get_u32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,315 @@
+#include <lib/script/yuri_script.h>
+#include <lib/text_file/text_file.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char name[YURI_SCRIPT_LABEL_LEN];
+    uint16_t target;
+} YuriScriptLabel;
+
+// Jumps are resolved once every label is known, a label may come after its use
+typedef struct {
+    YuriScriptLabel labels[YURI_SCRIPT_LABELS_MAX];
+    uint8_t label_count;
+    YuriScriptLabel fixups[YURI_SCRIPT_OPS_MAX];
+    uint8_t fixup_count;
+} YuriScriptLinker;
+
+typedef struct {
+    const char* name;
+    SDQDeviceCommand command;
+} YuriScriptMode;
+
+static const YuriScriptMode yuri_script_modes[] = {
+    {"dcsd", SDQDeviceCommand_DCSD},
+    {"reset", SDQDeviceCommand_RESET},
+    {"dfu", SDQDeviceCommand_DFU},
+    {"charging", SDQDeviceCommand_CHARGING},
+};
+
+// Indexed by YuriScriptOp
+static const char* const yuri_script_op_names[] = {
+    "mode",
+    "start",
+    "stop",
+    "await",
+    "expect",
+    "send",
+    "inject",
+    "wait",
+    "log",
+    "goto",
+    "pass",
+    "fail",
+};
+
+// Next space separated word, NULL at the end of the line
+static char* yuri_script_word(char** cursor) {
+    char* word = *cursor;
+    while(*word == ' ' || *word == '\t') word++;
+    if(*word == 0) return NULL;
+    char* end = word;
+    while(*end && *end != ' ' && *end != '\t') end++;
+    if(*end) *end++ = 0;
+    *cursor = end;
+    return word;
+}
+
+static bool yuri_script_number(char** cursor, uint32_t* value) {
+    const char* word = yuri_script_word(cursor);
+    if(!word) return false;
+    char* end;
+    *value = strtoul(word, &end, 10);
+    return end != word && *end == 0;
+}
+
+/* Decodes a quoted string into the pool. Its offset and length go into the step. */
+static const char*
+    yuri_script_string_arg(YuriScript* script, char** cursor, YuriScriptInsn* insn) {
+    char* src = *cursor;
+    while(*src == ' ' || *src == '\t') src++;
+    if(*src++ != '"') return "expected a quoted string";
+    const uint16_t start = script->pool_used;
+    uint16_t len = 0;
+    while(*src != '"') {
+        if(*src == 0) return "missing closing quote";
+        char c = *src++;
+        if(c == '\\') {
+            c = *src++;
+            switch(c) {
+            case 'r':
+                c = '\r';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'x': {
+                char hex[3] = {src[0], src[0] ? src[1] : 0, 0};
+                char* end;
+                c = (char)strtoul(hex, &end, 16);
+                if(end != hex + 2) return "\\x takes two hex digits";
+                src += 2;
+                break;
+            }
+            case '\\':
+            case '"':
+                break;
+            default:
+                return "unknown escape";
+            }
+        }
+        // The terminating NUL needs a byte as well
+        if(start + len + 1 >= YURI_SCRIPT_POOL_SIZE) return "strings do not fit";
+        script->pool[start + len++] = c;
+    }
+    if(len == 0 || len > UINT8_MAX) return "empty or too long string";
+    script->pool[start + len] = 0;
+    script->pool_used = start + len + 1;
+    insn->str = start;
+    insn->arg = len;
+    *cursor = src + 1;
+    return NULL;
+}
+
+static const char* yuri_script_jump(YuriScriptLinker* linker, const char* label, uint16_t from) {
+    if(!label) return "missing label";
+    YuriScriptLabel* fixup = &linker->fixups[linker->fixup_count++];
+    strncpy(fixup->name, label, YURI_SCRIPT_LABEL_LEN - 1);
+    fixup->name[YURI_SCRIPT_LABEL_LEN - 1] = 0;
+    fixup->target = from;
+    return NULL;
+}
+
+// await and expect: a timeout and an optional else label
+static const char* yuri_script_timeout_args(
+    YuriScriptLinker* linker,
+    char** cursor,
+    YuriScriptInsn* insn,
+    uint16_t pc) {
+    if(!yuri_script_number(cursor, &insn->value)) return "expected a timeout in ms";
+    const char* word = yuri_script_word(cursor);
+    if(!word) return NULL;
+    if(strcmp(word, "else") != 0) return "expected else <label>";
+    return yuri_script_jump(linker, yuri_script_word(cursor), pc);
+}
+
+static const char* yuri_script_compile_step(
+    YuriScript* script,
+    YuriScriptLinker* linker,
+    const char* keyword,
+    char* args,
+    YuriScriptInsn* insn) {
+    const uint16_t pc = script->count;
+    uint8_t op = 0;
+    while(op < YuriScriptOpCount && strcmp(yuri_script_op_names[op], keyword) != 0) {
+        op++;
+    }
+    if(op == YuriScriptOpCount) return "unknown step";
+    insn->op = op;
+    const char* error = NULL;
+    switch(op) {
+    case YuriScriptOpMode: {
+        const char* mode = yuri_script_word(&args);
+        size_t i = 0;
+        while(mode && i < COUNT_OF(yuri_script_modes) &&
+              strcmp(yuri_script_modes[i].name, mode) != 0) {
+            i++;
+        }
+        if(!mode || i == COUNT_OF(yuri_script_modes)) {
+            return "expected dcsd, reset, dfu or charging";
+        }
+        insn->arg = yuri_script_modes[i].command;
+        break;
+    }
+    case YuriScriptOpAwait:
+        error = yuri_script_timeout_args(linker, &args, insn, pc);
+        break;
+    case YuriScriptOpExpect:
+        error = yuri_script_string_arg(script, &args, insn);
+        if(!error && insn->arg > STREAM_MATCH_MAX_LEN) error = "pattern too long";
+        if(!error) error = yuri_script_timeout_args(linker, &args, insn, pc);
+        break;
+    case YuriScriptOpSend:
+    case YuriScriptOpLog:
+    case YuriScriptOpFail:
+        error = yuri_script_string_arg(script, &args, insn);
+        break;
+    case YuriScriptOpInject: {
+        const char* path = yuri_script_word(&args);
+        if(!path) return "expected a file";
+        const size_t len = strlen(path);
+        if(len > UINT8_MAX || script->pool_used + len + 1 > YURI_SCRIPT_POOL_SIZE) {
+            return "strings do not fit";
+        }
+        memcpy(script->pool + script->pool_used, path, len + 1);
+        insn->str = script->pool_used;
+        insn->arg = len;
+        script->pool_used += len + 1;
+        break;
+    }
+    case YuriScriptOpWait:
+        if(!yuri_script_number(&args, &insn->value)) error = "expected a time in ms";
+        break;
+    case YuriScriptOpGoto:
+        error = yuri_script_jump(linker, yuri_script_word(&args), pc);
+        break;
+    default:
+        break;
+    }
+    if(!error && yuri_script_word(&args)) error = "unexpected text at the end";
+    return error;
+}
+
+// The first jump to a label that does not exist, NULL when all of them resolved
+static const YuriScriptLabel* yuri_script_link(YuriScript* script, YuriScriptLinker* linker) {
+    for(uint8_t i = 0; i < linker->fixup_count; i++) {
+        const YuriScriptLabel* fixup = &linker->fixups[i];
+        uint8_t l = 0;
+        while(l < linker->label_count && strcmp(linker->labels[l].name, fixup->name) != 0) {
+            l++;
+        }
+        if(l == linker->label_count) return fixup;
+        script->code[fixup->target].jump = linker->labels[l].target;
+    }
+    return NULL;
+}
+
+bool yuri_script_compile(YuriScript* script, char* text, char* error, size_t error_size) {
+    YuriScriptLinker* linker = malloc(sizeof(YuriScriptLinker));
+    linker->label_count = 0;
+    linker->fixup_count = 0;
+    script->count = 0;
+    script->pool_used = 0;
+    const char* problem = NULL;
+    uint16_t line_number = 0;
+    // Lines are cut by hand, strtok would skip empty ones and throw off the numbers
+    char* next = text;
+    while(next && !problem) {
+        char* line = next;
+        next = strchr(line, '\n');
+        if(next) *next++ = 0;
+        line_number++;
+        line = text_file_trim(line);
+        if(line[0] == 0 || line[0] == '#') continue;
+        const size_t len = strlen(line);
+        if(line[len - 1] == ':') {
+            line[len - 1] = 0;
+            if(strchr(line, ' ') || len > YURI_SCRIPT_LABEL_LEN) {
+                problem = "bad label";
+            } else if(linker->label_count == YURI_SCRIPT_LABELS_MAX) {
+                problem = "too many labels";
+            } else {
+                YuriScriptLabel* label = &linker->labels[linker->label_count++];
+                strcpy(label->name, line);
+                label->target = script->count;
+            }
+            continue;
+        }
+        if(script->count == YURI_SCRIPT_OPS_MAX) {
+            problem = "too many steps";
+            break;
+        }
+        YuriScriptInsn* insn = &script->code[script->count];
+        memset(insn, 0, sizeof(YuriScriptInsn));
+        insn->jump = YURI_SCRIPT_NO_JUMP;
+        insn->line = line_number;
+        const char* keyword = yuri_script_word(&line);
+        problem = yuri_script_compile_step(script, linker, keyword, line, insn);
+        if(!problem) script->count++;
+    }
+    bool ok = problem == NULL;
+    if(ok && script->count == 0) {
+        snprintf(error, error_size, "no steps");
+        ok = false;
+    } else if(!ok) {
+        snprintf(error, error_size, "line %u: %s", line_number, problem);
+    } else {
+        const YuriScriptLabel* missing = yuri_script_link(script, linker);
+        if(missing) {
+            snprintf(
+                error,
+                error_size,
+                "line %u: no label %s",
+                script->code[missing->target].line,
+                missing->name);
+            ok = false;
+        }
+    }
+    free(linker);
+    return ok;
+}
+
+YuriScript* yuri_script_load(const char* path, char* error, size_t error_size) {
+    char* text = text_file_read(path, YURI_SCRIPT_FILE_MAX);
+    if(!text) {
+        snprintf(error, error_size, "cannot open %s", path);
+        return NULL;
+    }
+    YuriScript* script = malloc(sizeof(YuriScript));
+    // Named after the file without folder and extension, for the log
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    size_t len = strcspn(name, ".");
+    if(len >= YURI_SCRIPT_NAME_LEN) len = YURI_SCRIPT_NAME_LEN - 1;
+    memcpy(script->name, name, len);
+    script->name[len] = 0;
+    if(!yuri_script_compile(script, text, error, error_size)) {
+        free(script);
+        script = NULL;
+    }
+    free(text);
+    return script;
+}
+
+void yuri_script_free(YuriScript* script) {
+    free(script);
+}
+
+const char* yuri_script_op_name(YuriScriptOp op) {
+    return op < YuriScriptOpCount ? yuri_script_op_names[op] : "unknown";
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lib/sdq/sdq_device.h>
+#include <lib/stream_match/stream_match.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define YURI_SCRIPT_OPS_MAX 64
+#define YURI_SCRIPT_POOL_SIZE 512
+#define YURI_SCRIPT_LABELS_MAX 16
+#define YURI_SCRIPT_LABEL_LEN 16
+#define YURI_SCRIPT_NAME_LEN 24
+// The whole file is read and compiled at once, like the profiles
+#define YURI_SCRIPT_FILE_MAX 2048
+#define YURI_SCRIPT_NO_JUMP 0xFFFF
+#define YURI_SCRIPT_LOG_NAME "script.csv"
+#define YURI_SCRIPT_LOG_HEADER "date,script,elapsed_ms,event,detail"
+
+typedef enum {
+    // arg holds the SDQDeviceCommand
+    YuriScriptOpMode,
+    YuriScriptOpStart,
+    YuriScriptOpStop,
+    // Until the engine ran its command, value is the timeout in ms, jump the else label
+    YuriScriptOpAwait,
+    // Until the string shows up on the main UART, value and jump like await
+    YuriScriptOpExpect,
+    // The string goes out on the main UART
+    YuriScriptOpSend,
+    // The string is a file streamed to the main UART, see /inject
+    YuriScriptOpInject,
+    YuriScriptOpWait,
+    // The string is appended to YURI_SCRIPT_LOG_NAME
+    YuriScriptOpLog,
+    YuriScriptOpGoto,
+    YuriScriptOpPass,
+    // The string is the reason
+    YuriScriptOpFail,
+    YuriScriptOpCount,
+} YuriScriptOp;
+
+/* One step. Strings live NUL terminated in the pool, str is their offset and arg the length
+ * except for mode. A timeout without else label fails the script. */
+typedef struct {
+    uint8_t op;
+    uint8_t arg;
+    uint16_t jump;
+    uint16_t str;
+    uint16_t line;
+    uint32_t value;
+} YuriScriptInsn;
+
+typedef struct {
+    char name[YURI_SCRIPT_NAME_LEN];
+    uint16_t count;
+    uint16_t pool_used;
+    YuriScriptInsn code[YURI_SCRIPT_OPS_MAX];
+    char pool[YURI_SCRIPT_POOL_SIZE];
+} YuriScript;
+
+/* Compiles a script into steps, one per line. text is modified in place. On failure error
+ * tells the line and what is wrong with it.
+ *
+ * # DFU, then stop iBoot from booting on
+ * mode dfu
+ * start
+ * await 60000 else nophone
+ * expect "iBoot" 5000 else noboot
+ * send "setenv auto-boot false\r"
+ * log "auto-boot off"
+ * pass
+ * nophone:
+ * fail "no phone"
+ *
+ * Steps are mode <dcsd | reset | dfu | charging>, start, stop, await <ms>, expect "<text>" <ms>,
+ * send "<text>", inject <file>, wait <ms>, log "<text>", goto <label>, pass and fail "<text>".
+ * await and expect take an optional else <label>. Strings know \r, \n, \t, \\, \" and \xHH. */
+bool yuri_script_compile(YuriScript* script, char* text, char* error, size_t error_size);
+
+/* Reads and compiles a script file, NULL with error filled if that did not work */
+YuriScript* yuri_script_load(const char* path, char* error, size_t error_size);
+void yuri_script_free(YuriScript* script);
+
+static inline const char*
+    yuri_script_string(const YuriScript* script, const YuriScriptInsn* insn) {
+    return script->pool + insn->str;
+}
+
+const char* yuri_script_op_name(YuriScriptOp op);
+
+#ifdef __cplusplus
+}
+#endif
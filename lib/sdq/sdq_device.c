@@ -1,4 +1,5 @@
 #include <lib/sdq/sdq_device.h>
+#include <lib/profile/sdq_profile.h>
 
 const SDQTimings sdq_timings = { // microseconds
     .BREAK_meaningful_min = 12,
@@ -32,7 +33,7 @@ const TRISTART_RESPONSES responses = {
     .KEYSET = {0x7D, 0x02, 0x47, 0x65, 0x74, 0x20, 0x45, 0x53, 0x4e, 0x00},
     .UNKNOWN_76_ANSWER = {0x77, 0x02, 0x01, 0x02, 0x80, 0x60, 0x01, 0x39, 0x3a, 0x44, 0x3e, 0xc9}};
 
-uint8_t RECOVERY_PLIST[277] =
+const uint8_t RECOVERY_PLIST[277] =
     "<?xml version=\"1.0\" encoding=\"UTF-8\"?><!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\"><plist version=\"1.0\"><dict> <key>Label</key> <string>yuricable</string> <key>Request</key> <string>EnterRecovery</string> </dict></plist>";
 
 uint8_t crc_data(const uint8_t* data, size_t len) {
@@ -46,20 +47,175 @@ void sdq_delay_us(uint32_t time_us) {
     furi_delay_us(time_us);
 }
 
+/* Seqlock writer. Interrupts stay masked so the thread side and the SDQ interrupt never write
+ * at the same time, inside the interrupt that is already the case. */
+static void sdq_device_publish(SDQDevice* bus) {
+    FURI_CRITICAL_ENTER();
+    const uint32_t seq = bus->state_seq;
+    __atomic_store_n(&bus->state_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    bus->state.command = bus->runCommand;
+    bus->state.error = bus->error;
+    bus->state.listening = bus->listening;
+    bus->state.connected = bus->connected;
+    bus->state.resetInProgress = bus->resetInProgress;
+    bus->state.commandExecuted = bus->commandExecuted;
+    __atomic_store_n(&bus->state_seq, seq + 2, __ATOMIC_RELEASE);
+    FURI_CRITICAL_EXIT();
+}
+
+/* Applies a posted command. Called between sessions only, so a frame never sees the command
+ * change under it. Nothing posted costs the interrupt a single load. */
+static void sdq_device_take_command(SDQDevice* bus) {
+    uint32_t posted = __atomic_load_n(&bus->mailbox, __ATOMIC_ACQUIRE);
+    if(!(posted & SDQ_DEVICE_MAILBOX_POSTED)) {
+        return;
+    }
+    FURI_CRITICAL_ENTER();
+    bus->runCommand = (SDQDeviceCommand)(posted & 0xFF);
+    bus->commandExecuted = false;
+    sdq_device_publish(bus);
+    // A newer post stays in the mailbox for the next take
+    __atomic_compare_exchange_n(
+        &bus->mailbox, &posted, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    FURI_CRITICAL_EXIT();
+}
+
 struct SDQDevice* sdq_device_alloc(const GpioPin* gpio_pin, UsbUartBridge* uart_bridge) {
     struct SDQDevice* bus = malloc(sizeof(struct SDQDevice));
     bus->gpio_pin = gpio_pin;
     bus->uart_bridge = uart_bridge;
     bus->timings = sdq_timings;
+    bus->base_timings = sdq_timings;
+    bus->timings_posted = false;
     bus->error = SDQDeviceErrorNone;
     bus->runCommand = SDQDeviceCommand_NONE;
+    bus->listening = false;
+    bus->connected = false;
+    bus->resetInProgress = false;
+    bus->commandExecuted = false;
+    bus->mailbox = 0;
+    bus->state_seq = 0;
+    bus->profiles = NULL;
+    bus->profile = NULL;
+    bus->responses = &responses;
+    bus->power_delay_us = SDQ_POWER_DELAY_US;
+    bus->charging_delay_us = SDQ_CHARGING_DELAY_US;
+    bus->charge_identity = SDQChargeIdentityCable;
+    bus->power_requests = 0;
+    bus->power_request[0] = 0;
+    bus->power_request[1] = 0;
+    bus->state_callback = NULL;
+    bus->state_context = NULL;
+    bus->notify_pending = false;
+    bus->sessions = 0;
+    bus->last_edge_tick = 0;
+    bus->low_power = false;
+    bus->awake = false;
+    bus->wakes = 0;
+    bus->wake_tick = 0;
+    bus->wake_latency_us = 0;
+    bus->wake_late = false;
+    bus->resyncs = 0;
+    bus->resyncs_recovered = 0;
+    bus->trace = NULL;
+    bus->trace_break_pending = false;
+    bus->trace_response = NULL;
+    sdq_device_publish(bus);
     return bus;
 }
 
+void sdq_device_set_state_callback(
+    SDQDevice* bus,
+    SDQDeviceStateCallback callback,
+    void* context) {
+    bus->state_context = context;
+    bus->state_callback = callback;
+}
+
+static inline void sdq_device_mark_reset(SDQDevice* bus) {
+    if(bus->uart_bridge) {
+        usb_uart_mark_reset(bus->uart_bridge);
+    }
+}
+
+static inline void sdq_device_trace(
+    SDQDevice* bus,
+    SDQTraceEvent event,
+    uint8_t opcode,
+    const uint8_t* bytes,
+    uint8_t len) {
+    if(bus->trace) {
+        sdq_trace_put(bus->trace, DWT->CYCCNT, event, opcode, bus->error, bytes, len);
+    }
+}
+
+// Only stamps the BREAK, its entry is written with the frame that follows it
+static inline void sdq_device_trace_break(SDQDevice* bus, SDQDeviceError resynced_from) {
+    bus->trace_break_cycles = DWT->CYCCNT;
+    bus->trace_break_from = resynced_from;
+    bus->trace_break_pending = true;
+}
+
+/* Writes the entries stamped for the last BREAK, frame and answer in the order they happened.
+ * Runs once the answer is out, where the line leaves time for it. */
+static void sdq_device_trace_frame(
+    SDQDevice* bus,
+    uint32_t received_cycles,
+    SDQDeviceError received_error,
+    const uint8_t command[4]) {
+    SDQTrace* trace = bus->trace;
+    if(trace && bus->trace_break_pending) {
+        sdq_trace_put(
+            trace,
+            bus->trace_break_cycles,
+            SDQTraceEventBreak,
+            bus->trace_break_from,
+            SDQDeviceErrorNone,
+            NULL,
+            0);
+    }
+    bus->trace_break_pending = false;
+    if(trace && command) {
+        sdq_trace_put(
+            trace,
+            received_cycles,
+            SDQTraceEventRequest,
+            command[0],
+            received_error,
+            command + 1,
+            3);
+    }
+    if(trace && bus->trace_response) {
+        sdq_trace_put(
+            trace,
+            bus->trace_response_cycles,
+            SDQTraceEventResponse,
+            bus->trace_response[0],
+            SDQDeviceErrorNone,
+            bus->trace_response + 1,
+            bus->trace_response_len - 1);
+    }
+    bus->trace_response = NULL;
+}
+
+/* Between the BREAK and the first data bit there is no time for the callback, so inside a
+ * session the change is only noted and the EXTI callback notifies after the session */
+static inline void sdq_device_notify_state(SDQDevice* bus) {
+    if(bus->connected) {
+        bus->notify_pending = true;
+        return;
+    }
+    bus->notify_pending = false;
+    sdq_device_publish(bus);
+    if(bus->state_callback) {
+        bus->state_callback(bus->state_context);
+    }
+}
+
+// The bridge is owned by the app, it only lends it while DCSD needs it
 void sdq_device_free(SDQDevice* bus) {
     sdq_device_stop(bus);
-    usb_uart_disable(bus->uart_bridge);
-    free(bus->uart_bridge);
     free(bus);
 }
 
@@ -76,9 +232,63 @@ static bool sdq_device_wait_while_gpio_is(SDQDevice* bus, uint32_t time_us, cons
     return false;
 }
 
+// Rebuilds the windows the engine runs on from the configured ones and the active profile
+static void sdq_device_apply_timings(SDQDevice* bus) {
+    if(!bus->profile) {
+        bus->timings = bus->base_timings;
+        return;
+    }
+    const uint32_t* base = (const uint32_t*)&bus->base_timings;
+    const uint32_t* override = (const uint32_t*)&bus->profile->timings;
+    uint32_t* timings = (uint32_t*)&bus->timings;
+    for(size_t i = 0; i < sizeof(SDQTimings) / sizeof(uint32_t); i++) {
+        timings[i] = override[i] == SDQ_PROFILE_TIMING_UNSET ? base[i] : override[i];
+    }
+}
+
+/* Applies posted timings. Like a command they are taken between sessions only, a thread
+ * copying them in directly could be interrupted halfway by a session reading them. */
+static void sdq_device_take_timings(SDQDevice* bus) {
+    if(!bus->timings_posted) {
+        return;
+    }
+    FURI_CRITICAL_ENTER();
+    bus->base_timings = bus->posted_timings;
+    bus->timings_posted = false;
+    sdq_device_apply_timings(bus);
+    FURI_CRITICAL_EXIT();
+}
+
+/* Switch to the profile matching the 0x76 request before it is answered, so the model specific
+ * answer and timings apply from this frame on */
+static inline void sdq_device_select_profile(SDQDevice* bus, const uint8_t command[4]) {
+    const SDQProfile* profile = sdq_profile_lookup(bus->profiles, (command[1] << 8) | command[2]);
+    if(!profile || profile == bus->profile) {
+        return;
+    }
+    bus->profile = profile;
+    sdq_device_apply_timings(bus);
+    bus->responses = &profile->responses;
+    bus->power_delay_us = profile->power_delay_us;
+    bus->charging_delay_us = profile->charging_delay_us;
+}
+
+static inline void sdq_device_clear_profile(SDQDevice* bus) {
+    if(bus->profile) {
+        bus->profile = NULL;
+        sdq_device_apply_timings(bus);
+    }
+    bus->responses = &responses;
+    bus->power_delay_us = SDQ_POWER_DELAY_US;
+    bus->charging_delay_us = SDQ_CHARGING_DELAY_US;
+}
+
 static inline bool sdq_device_receive_and_process_command(SDQDevice* bus) {
     uint8_t command[4] = {0};
-    if(sdq_device_receive(bus, command, sizeof(command))) {
+    const bool received = sdq_device_receive(bus, command, sizeof(command));
+    const uint32_t received_cycles = DWT->CYCCNT;
+    const SDQDeviceError received_error = bus->error;
+    if(received) {
         if(sdq_device_wait_while_gpio_is(bus, bus->timings.BREAK_meaningful_max, false)) {
             furi_hal_gpio_init(bus->gpio_pin, GpioModeOutputPushPull, GpioPullUp, GpioSpeedLow);
             switch(command[0]) {
@@ -88,53 +298,64 @@ static inline bool sdq_device_receive_and_process_command(SDQDevice* bus) {
                     bus->commandExecuted = true;
                     break;
                 case SDQDeviceCommand_SN:
-                    if(sdq_device_send(bus, responses.SN, sizeof(responses.SN))) {
+                    if(sdq_device_send(bus, bus->responses->SN, sizeof(bus->responses->SN))) {
                         bus->commandExecuted = true;
                         sdq_device_stop(bus);
                     }
                     break;
                 case SDQDeviceCommand_RESET:
-                    if(sdq_device_send(bus, responses.RESET_DEVICE, sizeof(responses.RESET_DEVICE))) {
+                    if(sdq_device_send(bus, bus->responses->RESET_DEVICE, sizeof(bus->responses->RESET_DEVICE))) {
+                        sdq_device_mark_reset(bus);
                         bus->commandExecuted = true;
                         sdq_device_stop(bus);
                     }
                     break;
                 case SDQDeviceCommand_DFU:
                     if(bus->resetInProgress) {
-                        if(sdq_device_send(bus, responses.DFU, sizeof(responses.DFU))) {
+                        if(sdq_device_send(bus, bus->responses->DFU, sizeof(bus->responses->DFU))) {
                             bus->resetInProgress = false;
                             bus->commandExecuted = true;
                             sdq_device_stop(bus);
                         }
                     } else {
-                        if(sdq_device_send(bus,responses.RESET_DEVICE, sizeof(responses.RESET_DEVICE))) {
+                        if(sdq_device_send(bus,bus->responses->RESET_DEVICE, sizeof(bus->responses->RESET_DEVICE))) {
                             bus->resetInProgress = true;
+                            sdq_device_mark_reset(bus);
+                            sdq_device_notify_state(bus);
                         }
                     }
                     break;
                 case SDQDeviceCommand_DCSD:
                     if(bus->resetInProgress) {
-                        if(sdq_device_send(bus, responses.USB_UART, sizeof(responses.USB_UART))) {
+                        if(sdq_device_send(bus, bus->responses->USB_UART, sizeof(bus->responses->USB_UART))) {
                             bus->resetInProgress = false;
                             bus->commandExecuted = true;
                             sdq_device_stop(bus);
                         }
                     } else {
-                        if(sdq_device_send(bus, responses.RESET_DEVICE, sizeof(responses.RESET_DEVICE))) {
+                        if(sdq_device_send(bus, bus->responses->RESET_DEVICE, sizeof(bus->responses->RESET_DEVICE))) {
                             bus->resetInProgress = true;
+                            sdq_device_mark_reset(bus);
+                            sdq_device_notify_state(bus);
                         }
                     }
                     break;
                 case SDQDeviceCommand_CHARGING:
-                    sdq_delay_us(300);
-                    if(sdq_device_send(bus, responses.USB_UART, sizeof(responses.USB_UART))) {
+                    sdq_delay_us(bus->charging_delay_us);
+                    if(bus->charge_identity == SDQChargeIdentityCable) {
+                        sdq_device_send(bus, bus->responses->USB_A_CHARGING_CABLE, sizeof(bus->responses->USB_A_CHARGING_CABLE));
+                    } else {
+                        sdq_device_send(bus, bus->responses->USB_UART, sizeof(bus->responses->USB_UART));
                     }
                     break;
                 case SDQDeviceCommand_JTAG:
                     break;
                 case SDQDeviceCommand_RECOVERY:
-                    if(sdq_device_send(bus, responses.USB_UART, sizeof(responses.USB_UART))) {
-                        usb_uart_send_data( bus->uart_bridge, RECOVERY_PLIST, sizeof(RECOVERY_PLIST));
+                    if(sdq_device_send(bus, bus->responses->USB_UART, sizeof(bus->responses->USB_UART))) {
+                        if(bus->uart_bridge) {
+                            // Sent by the bridge TX thread, a blocking UART write has no place here
+                            usb_uart_post_data(bus->uart_bridge, RECOVERY_PLIST, sizeof(RECOVERY_PLIST));
+                        }
                         bus->commandExecuted = true;
                         sdq_device_stop(bus);
                     }
@@ -145,25 +366,34 @@ static inline bool sdq_device_receive_and_process_command(SDQDevice* bus) {
                 sdq_delay_us(10);
                 break;
             case TRISTAR_UNKNOWN_76:
-                FURI_LOG_I("SDQ", "TRISTAR_UNKNOWN_76");
-                sdq_device_send(bus, responses.UNKNOWN_76_ANSWER, sizeof(responses.UNKNOWN_76_ANSWER));
+                sdq_device_select_profile(bus, command);
+                sdq_device_send(bus, bus->responses->UNKNOWN_76_ANSWER, sizeof(bus->responses->UNKNOWN_76_ANSWER));
                 break;
             case TRISTAR_POWER:
-                sdq_delay_us(20);
-                sdq_device_send(bus, responses.POWER_ANSWER, 1);
+                bus->power_request[0] = command[1];
+                bus->power_request[1] = command[2];
+                bus->power_requests++;
+                sdq_delay_us(bus->power_delay_us);
+                // Only a charger identity states what it can supply, the rest keep the short answer
+                if(bus->runCommand == SDQDeviceCommand_CHARGING &&
+                   bus->charge_identity == SDQChargeIdentityCable) {
+                    sdq_device_send(bus, bus->responses->POWER_ANSWER, sizeof(bus->responses->POWER_ANSWER));
+                } else {
+                    sdq_device_send(bus, bus->responses->POWER_ANSWER, 1);
+                }
                 break;
             case TRISTAR_SERVICEMODE_ANSWER:
-                sdq_device_send(bus, responses.KEYSET, sizeof(responses.KEYSET));
+                sdq_device_send(bus, bus->responses->KEYSET, sizeof(bus->responses->KEYSET));
                 break;
             //case TRISTART_POWER_LAST:
             //    sdq_device_send(
-            //        bus, responses.LAST_POWER_ANSWER, sizeof(responses.LAST_POWER_ANSWER), false);
+            //        bus, bus->responses->LAST_POWER_ANSWER, sizeof(bus->responses->LAST_POWER_ANSWER), false);
             //    break;
             //case TRISTAR_POWER_HOPEFULLY_LAST:
             //    if(sdq_device_send(
             //           bus,
-            //           responses.HOPEFULLY_LAST_POWER_ANSWER,
-            //           sizeof(responses.HOPEFULLY_LAST_POWER_ANSWER),
+            //           bus->responses->HOPEFULLY_LAST_POWER_ANSWER,
+            //           sizeof(bus->responses->HOPEFULLY_LAST_POWER_ANSWER),
             //           true)) {
             //    }
             //    break;
@@ -172,39 +402,139 @@ static inline bool sdq_device_receive_and_process_command(SDQDevice* bus) {
             }
         }
     }
+    sdq_device_trace_frame(bus, received_cycles, received_error, command);
     return (bus->error == SDQDeviceErrorNone);
 }
 
+/* Skips the rest of a broken frame up to the next BREAK and its recovery, so the following
+ * frame is read from its first bit. Data bits are never low for longer than ZERO_meaningful_max,
+ * WAKE is longer than a BREAK. False if the line brought no BREAK within timeout_us. */
+static bool sdq_device_resync(SDQDevice* bus, uint32_t timeout_us) {
+    const uint32_t cycles_per_us = furi_hal_cortex_instructions_per_microsecond();
+    const uint32_t timeout = timeout_us * cycles_per_us;
+    const uint32_t low_min = bus->timings.ZERO_meaningful_max * cycles_per_us;
+    const uint32_t low_max = bus->timings.BREAK_meaningful_max * cycles_per_us;
+    const uint32_t start = DWT->CYCCNT;
+    // The frame may have broken in the middle of a low phase, that one cannot be measured
+    while(!furi_hal_gpio_read(bus->gpio_pin)) {
+        if(DWT->CYCCNT - start >= timeout) return false;
+    }
+    while(DWT->CYCCNT - start < timeout) {
+        if(furi_hal_gpio_read(bus->gpio_pin)) {
+            continue;
+        }
+        const uint32_t fall = DWT->CYCCNT;
+        uint32_t low;
+        do {
+            low = DWT->CYCCNT - fall;
+        } while(!furi_hal_gpio_read(bus->gpio_pin) && low <= low_max &&
+                DWT->CYCCNT - start < timeout);
+        if(low > low_min && low <= low_max &&
+           sdq_device_wait_while_gpio_is(bus, bus->timings.BREAK_recovery, true)) {
+            return true;
+        }
+        while(!furi_hal_gpio_read(bus->gpio_pin)) {
+            if(DWT->CYCCNT - start >= timeout) return false;
+        }
+    }
+    return false;
+}
+
 static inline bool sdq_device_bus_start(SDQDevice* bus) {
+    bus->sessions++;
     bus->connected = true;
-    while(sdq_device_receive_and_process_command(bus)) {
+    sdq_device_trace_break(bus, SDQDeviceErrorNone);
+    uint8_t resyncs = 0;
+    while(1) {
+        // Low here means Tristar already started the next frame, high is a line gone idle
+        const bool started = !furi_hal_gpio_read(bus->gpio_pin);
+        if(sdq_device_receive_and_process_command(bus)) {
+            continue;
+        }
+        // A glitch inside a frame only costs that frame, the session and its state go on
+        if(!started || !bus->listening || resyncs == SDQ_RESYNC_MAX ||
+           (bus->error != SDQDeviceErrorBitReadTiming &&
+            bus->error != SDQDeviceErrorInvalidCRC)) {
+            break;
+        }
+        resyncs++;
+        bus->resyncs++;
+        const SDQDeviceError error = bus->error;
+        sdq_device_trace(bus, SDQTraceEventResync, 0, NULL, 0);
+        if(!sdq_device_resync(bus, SDQ_RESYNC_TIMEOUT_US)) {
+            break;
+        }
+        bus->error = SDQDeviceErrorNone;
+        bus->resyncs_recovered++;
+        sdq_device_trace_break(bus, error);
     }
     const bool result = (bus->error == SDQDeviceErrorNone);
+    sdq_device_trace_frame(bus, 0, SDQDeviceErrorNone, NULL);
+    sdq_device_trace(bus, SDQTraceEventEnd, 0, NULL, 0);
     bus->connected = false;
+    bus->notify_pending = true;
     return result;
 }
 
+/* First edge after a low-power wait. The core only runs again once its clocks are back, so the
+ * part of the BREAK still low tells how long that took. */
+static void sdq_device_wake(SDQDevice* bus) {
+    const uint32_t cycles_per_us = furi_hal_cortex_instructions_per_microsecond();
+    const uint32_t limit = bus->timings.BREAK_meaningful_max * cycles_per_us;
+    const uint32_t start = DWT->CYCCNT;
+    uint32_t low = 0;
+    bus->wake_late = furi_hal_gpio_read(bus->gpio_pin);
+    while(!furi_hal_gpio_read(bus->gpio_pin) && low < limit) {
+        low = DWT->CYCCNT - start;
+    }
+    const uint32_t left_us = low / cycles_per_us;
+    bus->wake_latency_us = left_us < bus->timings.BREAK_meaningful ?
+                               bus->timings.BREAK_meaningful - left_us :
+                               0;
+    bus->wake_tick = bus->last_edge_tick;
+    bus->wakes++;
+    bus->awake = true;
+    furi_hal_power_insomnia_enter();
+    const uint8_t latency = bus->wake_late ? UINT8_MAX : bus->wake_latency_us;
+    sdq_device_trace(bus, SDQTraceEventWake, 0, &latency, 1);
+}
+
 static void sdq_device_exti_callback(void* context) {
     SDQDevice* bus = context;
+    bus->last_edge_tick = furi_get_tick();
+    const bool wake = bus->low_power && !bus->awake;
     FURI_CRITICAL_ENTER()
+    if(wake) {
+        sdq_device_wake(bus);
+    }
     if(sdq_device_wait_while_gpio_is(bus, bus->timings.BREAK_meaningful_min, false)) {
         if(sdq_device_wait_while_gpio_is(bus, bus->timings.BREAK_recovery, true)) {
             sdq_device_bus_start(bus);
         }
     }
+    // Whatever was posted meanwhile is taken here, not on the way to the next first data bit
+    sdq_device_take_command(bus);
+    sdq_device_take_timings(bus);
     furi_hal_gpio_remove_int_callback(bus->gpio_pin);
     furi_hal_gpio_add_int_callback(bus->gpio_pin, sdq_device_exti_callback, bus);
     furi_hal_gpio_write(bus->gpio_pin, true);
     furi_hal_gpio_init(bus->gpio_pin, GpioModeInterruptFall, GpioPullUp, GpioSpeedVeryHigh);
     FURI_CRITICAL_EXIT()
+    if(wake || bus->notify_pending) {
+        sdq_device_notify_state(bus);
+    }
 }
 
 void sdq_device_start(SDQDevice* bus) {
+    sdq_device_take_command(bus);
+    sdq_device_take_timings(bus);
+    sdq_device_clear_profile(bus);
     furi_hal_gpio_remove_int_callback(bus->gpio_pin);
     furi_hal_gpio_add_int_callback(bus->gpio_pin, sdq_device_exti_callback, bus);
     furi_hal_gpio_write(bus->gpio_pin, true);
     furi_hal_gpio_init(bus->gpio_pin, GpioModeInterruptFall, GpioPullUp, GpioSpeedVeryHigh);
     bus->listening = true;
+    sdq_device_notify_state(bus);
 }
 
 void sdq_device_stop(SDQDevice* bus) {
@@ -214,6 +544,86 @@ void sdq_device_stop(SDQDevice* bus) {
     furi_hal_gpio_write(bus->gpio_pin, true);
     furi_hal_gpio_init(bus->gpio_pin, GpioModeAnalog, GpioPullNo, GpioSpeedVeryHigh);
     furi_hal_gpio_remove_int_callback(bus->gpio_pin);
+    // Stopped from inside a session once its command ran: the next one picks up a post and the
+    // thread ends the wake, doze is not for interrupt context
+    if(!bus->connected) {
+        sdq_device_doze(bus);
+        sdq_device_take_command(bus);
+        sdq_device_take_timings(bus);
+    }
+    sdq_device_notify_state(bus);
+}
+
+void sdq_device_post_command(SDQDevice* bus, SDQDeviceCommand command) {
+    __atomic_store_n(&bus->mailbox, SDQ_DEVICE_MAILBOX_POSTED | command, __ATOMIC_RELEASE);
+    // Sessions only run inside the EXTI interrupt, seen from anywhere else the engine is always
+    // between two of them
+    if(!bus->connected) {
+        sdq_device_take_command(bus);
+    }
+}
+
+void sdq_device_set_timings(SDQDevice* bus, const SDQTimings* timings) {
+    // The interrupt may take the slot the moment the flag is up, so both change together
+    FURI_CRITICAL_ENTER();
+    bus->posted_timings = *timings;
+    bus->timings_posted = true;
+    FURI_CRITICAL_EXIT();
+    if(!bus->connected) {
+        sdq_device_take_timings(bus);
+    }
+}
+
+SDQDeviceCommand sdq_device_get_command(SDQDevice* bus) {
+    const uint32_t posted = __atomic_load_n(&bus->mailbox, __ATOMIC_ACQUIRE);
+    if(posted & SDQ_DEVICE_MAILBOX_POSTED) {
+        return (SDQDeviceCommand)(posted & 0xFF);
+    }
+    SDQDeviceState state;
+    sdq_device_get_state(bus, &state);
+    return state.command;
+}
+
+void sdq_device_get_state(SDQDevice* bus, SDQDeviceState* state) {
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&bus->state_seq, __ATOMIC_ACQUIRE);
+        if(seq & 1) {
+            continue;
+        }
+        *state = bus->state;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((seq & 1) || __atomic_load_n(&bus->state_seq, __ATOMIC_RELAXED) != seq);
+}
+
+void sdq_device_set_low_power(SDQDevice* bus, bool enabled) {
+    bus->low_power = enabled;
+    if(!enabled) {
+        sdq_device_doze(bus);
+    }
+}
+
+void sdq_device_doze(SDQDevice* bus) {
+    FURI_CRITICAL_ENTER();
+    const bool awake = bus->awake;
+    bus->awake = false;
+    FURI_CRITICAL_EXIT();
+    if(awake) {
+        furi_hal_power_insomnia_exit();
+    }
+}
+
+static void sdq_device_watch_callback(void* context) {
+    SDQDevice* bus = context;
+    bus->last_edge_tick = furi_get_tick();
+}
+
+void sdq_device_watch(SDQDevice* bus) {
+    bus->last_edge_tick = furi_get_tick();
+    furi_hal_gpio_remove_int_callback(bus->gpio_pin);
+    furi_hal_gpio_add_int_callback(bus->gpio_pin, sdq_device_watch_callback, bus);
+    furi_hal_gpio_write(bus->gpio_pin, true);
+    furi_hal_gpio_init(bus->gpio_pin, GpioModeInterruptFall, GpioPullUp, GpioSpeedVeryHigh);
 }
 
 uint8_t sdq_device_receive_bit(SDQDevice* bus, bool isLastBitofByte) {
@@ -283,9 +693,31 @@ bool sdq_device_send(SDQDevice* bus, const uint8_t data[], size_t data_size) {
     for(size_t i = 0; i < data_size + 1; i++) {
         sdq_device_send_byte(bus, response_buffer[i]);
     }
+    // Only stamped, the entry is written after the request's once the session has time for it
+    bus->trace_response_cycles = DWT->CYCCNT;
+    bus->trace_response = data;
+    bus->trace_response_len = data_size;
     return true;
 }
 
+const char* sdq_device_error_name(SDQDeviceError error) {
+    switch(error) {
+    case SDQDeviceErrorNone:
+        return "none";
+    case SDQDeviceErrorNotConnected:
+        return "not connected";
+    case SDQDeviceErrorInvalidCommand:
+        return "invalid command";
+    case SDQDeviceErrorBitReadTiming:
+        return "bit timing";
+    case SDQDeviceErrorTimeout:
+        return "timeout";
+    case SDQDeviceErrorInvalidCRC:
+        return "crc";
+    }
+    return "unknown";
+}
+
 bool sdq_device_receive(SDQDevice* bus, uint8_t data[], size_t data_size) {
     size_t bytes_received = 0;
     for(; bytes_received < data_size; ++bytes_received) {
@@ -6,12 +6,21 @@
 #include <furi_hal_gpio.h>
 #include <furi_hal.h>
 #include <lib/uart/usb_uart_bridge.c>
+#include <lib/trace/sdq_trace.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define RESPONSE_BUFFER_SIZE 8
+#define SDQ_POWER_DELAY_US 20
+#define SDQ_CHARGING_DELAY_US 300
+// How long a broken frame may wait in place for the next BREAK, Tristar retries right away
+#define SDQ_RESYNC_TIMEOUT_US 1500
+// Broken frames one session may resync from before it ends like before
+#define SDQ_RESYNC_MAX 3
+// Set in the mailbox word while a posted command waits, the low byte holds the command
+#define SDQ_DEVICE_MAILBOX_POSTED 0x100UL
 
 enum TRISTAR_REQUESTS {
     TRISTAR_POWER = 0x70,
@@ -34,6 +43,11 @@ typedef struct {
     uint8_t UNKNOWN_76_ANSWER[12];
 } TRISTART_RESPONSES;
 
+extern const TRISTART_RESPONSES responses;
+
+typedef struct SDQProfile SDQProfile;
+typedef struct SDQProfileTable SDQProfileTable;
+
 typedef enum {
     SDQDeviceCommand_NONE = 0,
     SDQDeviceCommand_DCSD,
@@ -45,6 +59,15 @@ typedef enum {
     SDQDeviceCommand_RECOVERY,
 } SDQDeviceCommand;
 
+// What charging mode tells the phone it is
+typedef enum {
+    // A USB-A charging cable, answers the power negotiation in full
+    SDQChargeIdentityCable,
+    // A USB UART accessory with a one byte power answer, what charging mode used to be
+    SDQChargeIdentityUsbUart,
+    SDQChargeIdentityCount,
+} SDQChargeIdentity;
+
 typedef struct {
     uint32_t BREAK_meaningful_min;
     uint32_t BREAK_meaningful_max;
@@ -66,6 +89,8 @@ typedef struct {
     uint32_t ONE_STOP_recovery;
 } SDQTimings;
 
+extern const SDQTimings sdq_timings;
+
 typedef enum {
     SDQDeviceErrorNone = 0,
     SDQDeviceErrorNotConnected,
@@ -75,26 +100,128 @@ typedef enum {
     SDQDeviceErrorInvalidCRC,
 } SDQDeviceError;
 
+/* The engine state other threads go by. Only the engine writes it, readers take a consistent
+ * copy with sdq_device_get_state. */
+typedef struct {
+    SDQDeviceCommand command;
+    SDQDeviceError error;
+    bool listening;
+    bool connected;
+    bool resetInProgress;
+    bool commandExecuted;
+} SDQDeviceState;
+
 typedef struct SDQDevice SDQDevice;
 
+/* Fired on listening/reset transitions and once a session is over, may run in interrupt
+ * context. Never while a frame is on the line, changes inside a session wait for its end. */
+typedef void (*SDQDeviceStateCallback)(void* context);
+
 struct SDQDevice {
     const GpioPin* gpio_pin;
+    // NULL while the bridge is not running, the app attaches it on demand
     UsbUartBridge* uart_bridge;
+    // Windows the engine runs on: the configured ones with the profile's overrides on top
     SDQTimings timings;
+    // Owned by the engine, the app posts commands and reads the published state instead
     SDQDeviceError error;
     SDQDeviceCommand runCommand;
     bool listening;
     bool connected;
     bool resetInProgress;
     bool commandExecuted;
+    // Command posted from the GUI or CLI, the engine takes it between sessions
+    volatile uint32_t mailbox;
+    // Seqlock over state, odd while the engine rewrites it
+    volatile uint32_t state_seq;
+    SDQDeviceState state;
+    // Model profiles, the active one is picked from the 0x76 request and dropped on start
+    const SDQProfileTable* profiles;
+    const SDQProfile* profile;
+    const TRISTART_RESPONSES* responses;
+    // Configured windows, set through sdq_device_set_timings and never changed by a profile
+    SDQTimings base_timings;
+    // Timings set from a thread, the engine takes them between sessions like a command
+    SDQTimings posted_timings;
+    volatile bool timings_posted;
+    uint16_t power_delay_us;
+    uint16_t charging_delay_us;
+    uint8_t charge_identity;
+    // TRISTAR_POWER requests seen and the argument bytes of the last one
+    volatile uint32_t power_requests;
+    uint8_t power_request[2];
+    SDQDeviceStateCallback state_callback;
+    void* state_context;
+    // A change inside a session, published and notified once the session is over
+    bool notify_pending;
+    // Valid BREAKs so far and the tick of the last falling edge, for telling plug and unplug
+    volatile uint32_t sessions;
+    volatile uint32_t last_edge_tick;
+    // Low-power wait: the core may stop between phones, the first edge wakes it and the engine
+    // then holds insomnia until sdq_device_doze
+    bool low_power;
+    volatile bool awake;
+    volatile uint32_t wakes;
+    volatile uint32_t wake_tick;
+    // Judged by how much of the waking BREAK was left, late if it was already over
+    volatile uint32_t wake_latency_us;
+    volatile bool wake_late;
+    // Frames dropped by a resync and how many of those found the next BREAK in time
+    volatile uint32_t resyncs;
+    volatile uint32_t resyncs_recovered;
+    // Written from the interrupt, NULL turns tracing off
+    SDQTrace* trace;
+    // Stamps taken between the BREAK and the answer, written to the trace after the answer
+    uint32_t trace_break_cycles;
+    uint8_t trace_break_from;
+    bool trace_break_pending;
+    uint32_t trace_response_cycles;
+    const uint8_t* trace_response;
+    uint8_t trace_response_len;
 };
 
 struct SDQDevice* sdq_device_alloc(const GpioPin* gpio_pin, UsbUartBridge* uart_bridge);
 void sdq_device_free(SDQDevice* bus);
 
+void sdq_device_set_state_callback(
+    SDQDevice* bus,
+    SDQDeviceStateCallback callback,
+    void* context);
+
 void sdq_device_start(SDQDevice* bus);
+/* Also ends a held wake, except when the engine stops itself inside a session. That wake is
+ * left for sdq_device_doze from a thread. */
 void sdq_device_stop(SDQDevice* bus);
 
+/* Hands the engine the command for the next phone and clears the executed flag. It is taken
+ * right away unless a session is running, then once that is over. The newest post wins. */
+void sdq_device_post_command(SDQDevice* bus, SDQDeviceCommand command);
+
+/* Configured windows, a profile picked during a session overrides some of them until the next
+ * start. Copied, the caller keeps its own. Taken right away unless a session is running, then
+ * once that is over. */
+void sdq_device_set_timings(SDQDevice* bus, const SDQTimings* timings);
+
+/* The command the next session runs, a posted one if the engine has not taken it yet */
+SDQDeviceCommand sdq_device_get_command(SDQDevice* bus);
+
+/* Copies the last published state without locking, retries while the engine rewrites it */
+void sdq_device_get_state(SDQDevice* bus, SDQDeviceState* state);
+
+/* Only stamp falling edges on the pin, the engine stays stopped. Tells when a phone that got
+ * its command is unplugged, its Tristar keeps polling until then. */
+void sdq_device_watch(SDQDevice* bus);
+
+/* Lets the core stop while the engine waits for a phone. Only the EXTI on the ID pin stays
+ * armed, the BREAK that wakes the core may be lost but the engine stays awake for the next
+ * poll. Turning it off releases a held wake. */
+void sdq_device_set_low_power(SDQDevice* bus, bool enabled);
+
+/* Ends the wake the first edge started, thread context only */
+void sdq_device_doze(SDQDevice* bus);
+
+const char* sdq_device_error_name(SDQDeviceError error);
+
 bool sdq_device_send(SDQDevice* bus, const uint8_t data[], size_t data_size);
 bool sdq_device_receive(SDQDevice* bus, uint8_t data[], size_t data_size);
 
@@ -0,0 +1,207 @@
+#include <lib/sdq/sdq_host.h>
+
+typedef struct {
+    uint8_t request[3];
+    uint8_t reply_size;
+    size_t offset;
+} SDQHostProbeStep;
+
+// The sequence a Tristar runs on a freshly plugged accessory
+static const SDQHostProbeStep sdq_host_probe_steps[] = {
+    {{TRISTAR_POLL, 0x00, 0x02}, sizeof(((SDQHostProbe*)0)->id), offsetof(SDQHostProbe, id)},
+    {{TRISTAR_UNKNOWN_76, 0x01, 0x02},
+     sizeof(((SDQHostProbe*)0)->info),
+     offsetof(SDQHostProbe, info)},
+    {{TRISTAR_POWER, 0x00, 0x00},
+     sizeof(((SDQHostProbe*)0)->power),
+     offsetof(SDQHostProbe, power)},
+};
+
+static const struct {
+    size_t offset;
+    const char* name;
+} sdq_host_kinds[] = {
+    {offsetof(TRISTART_RESPONSES, USB_UART), "USB UART"},
+    {offsetof(TRISTART_RESPONSES, USB_A_CHARGING_CABLE), "USB-A charging cable"},
+    {offsetof(TRISTART_RESPONSES, DFU), "DFU"},
+    {offsetof(TRISTART_RESPONSES, RESET_DEVICE), "reset"},
+    {offsetof(TRISTART_RESPONSES, USB_UART_JTAG), "USB UART + JTAG"},
+    {offsetof(TRISTART_RESPONSES, USB_SPAM_JTAG), "USB SPAM + JTAG"},
+    {offsetof(TRISTART_RESPONSES, SN), "serial number"},
+};
+
+SDQHost* sdq_host_alloc(const GpioPin* gpio_pin) {
+    SDQHost* host = malloc(sizeof(SDQHost));
+    host->gpio_pin = gpio_pin;
+    host->timings = sdq_timings;
+    host->error = SDQHostErrorNone;
+    host->cycles_per_us = furi_hal_cortex_instructions_per_microsecond();
+    host->edge = 0;
+    host->edge_late_max = 0;
+    // Open drain, the accessory drives the same line for its reply
+    furi_hal_gpio_write(gpio_pin, true);
+    furi_hal_gpio_init(gpio_pin, GpioModeOutputOpenDrain, GpioPullUp, GpioSpeedVeryHigh);
+    return host;
+}
+
+void sdq_host_free(SDQHost* host) {
+    furi_hal_gpio_write(host->gpio_pin, true);
+    furi_hal_gpio_init(host->gpio_pin, GpioModeAnalog, GpioPullNo, GpioSpeedVeryHigh);
+    free(host);
+}
+
+static inline bool sdq_host_before(uint32_t deadline) {
+    return (int32_t)(DWT->CYCCNT - deadline) < 0;
+}
+
+static inline void sdq_host_wait_until(uint32_t deadline) {
+    while(sdq_host_before(deadline)) {
+    }
+}
+
+/* Drive the next edge on its deadline and schedule the one after it */
+static inline void sdq_host_edge(SDQHost* host, bool level, uint32_t hold_us) {
+    sdq_host_wait_until(host->edge);
+    furi_hal_gpio_write(host->gpio_pin, level);
+    const uint32_t late = DWT->CYCCNT - host->edge;
+    if(late > host->edge_late_max) host->edge_late_max = late;
+    host->edge += hold_us * host->cycles_per_us;
+}
+
+static inline void sdq_host_pulse(SDQHost* host, uint32_t low_us, uint32_t high_us) {
+    sdq_host_edge(host, false, low_us);
+    sdq_host_edge(host, true, high_us);
+}
+
+static void sdq_host_send_byte(SDQHost* host, uint8_t byte) {
+    const SDQTimings* timings = &host->timings;
+    for(uint8_t mask = 0x01; mask != 0; mask <<= 1) {
+        const bool one = byte & mask;
+        uint32_t recovery = one ? timings->ONE_recovery : timings->ZERO_recovery;
+        if(mask == 0x80) {
+            recovery = one ? timings->ONE_STOP_recovery : timings->ZERO_STOP_recovery;
+        }
+        sdq_host_pulse(host, one ? timings->ONE_meaningful : timings->ZERO_meaningful, recovery);
+    }
+}
+
+/* Time in cycles until the line leaves `level`, UINT32_MAX if it stays there for timeout_us */
+static uint32_t sdq_host_wait_while(SDQHost* host, bool level, uint32_t timeout_us) {
+    const uint32_t start = DWT->CYCCNT;
+    const uint32_t timeout = timeout_us * host->cycles_per_us;
+    uint32_t elapsed;
+    do {
+        elapsed = DWT->CYCCNT - start;
+        if(furi_hal_gpio_read(host->gpio_pin) != level) return elapsed;
+    } while(elapsed < timeout);
+    return UINT32_MAX;
+}
+
+static bool sdq_host_receive(SDQHost* host, uint8_t* data, size_t size) {
+    const SDQTimings* timings = &host->timings;
+    // The accessory only has to keep its edges coming, its exact recovery is its own business
+    const uint32_t gap_us = (timings->ONE_STOP_recovery > timings->ZERO_STOP_recovery ?
+                                 timings->ONE_STOP_recovery :
+                                 timings->ZERO_STOP_recovery) +
+                            timings->ONE_meaningful_max;
+    uint32_t wait_us = SDQ_HOST_REPLY_TIMEOUT_US;
+    for(size_t i = 0; i < size; i++) {
+        uint8_t value = 0;
+        for(uint8_t mask = 0x01; mask != 0; mask <<= 1) {
+            if(sdq_host_wait_while(host, true, wait_us) == UINT32_MAX) {
+                host->error = (i == 0 && mask == 0x01) ? SDQHostErrorNoReply :
+                                                         SDQHostErrorBitReadTiming;
+                return false;
+            }
+            const uint32_t low = sdq_host_wait_while(host, false, timings->ZERO_meaningful_max);
+            if(low == UINT32_MAX) {
+                host->error = SDQHostErrorBitReadTiming;
+                return false;
+            }
+            if(low <= timings->ONE_meaningful_max * host->cycles_per_us) value |= mask;
+            wait_us = gap_us;
+        }
+        data[i] = value;
+    }
+    return true;
+}
+
+void sdq_host_wake(SDQHost* host) {
+    host->edge = DWT->CYCCNT + host->cycles_per_us;
+    sdq_host_pulse(host, host->timings.WAKE_meaningful, host->timings.WAKE_recovery);
+    sdq_host_wait_until(host->edge);
+}
+
+bool sdq_host_transfer(
+    SDQHost* host,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* reply,
+    size_t reply_size) {
+    furi_check(request_size < SDQ_HOST_FRAME_MAX);
+    furi_check(reply_size >= 2 && reply_size <= SDQ_HOST_FRAME_MAX);
+    uint8_t frame[SDQ_HOST_FRAME_MAX];
+    memcpy(frame, request, request_size);
+    frame[request_size] = crc_data(request, request_size);
+    host->error = SDQHostErrorNone;
+
+    FURI_CRITICAL_ENTER()
+    host->edge = DWT->CYCCNT + host->cycles_per_us;
+    sdq_host_pulse(host, host->timings.BREAK_meaningful, host->timings.BREAK_recovery);
+    for(size_t i = 0; i < request_size + 1; i++) {
+        sdq_host_send_byte(host, frame[i]);
+    }
+    // The second BREAK hands the line to the accessory, it answers as soon as it is released
+    sdq_host_edge(host, false, host->timings.BREAK_meaningful);
+    sdq_host_wait_until(host->edge);
+    furi_hal_gpio_write(host->gpio_pin, true);
+    sdq_host_receive(host, reply, reply_size);
+    FURI_CRITICAL_EXIT()
+
+    if(host->error == SDQHostErrorNone &&
+       crc_data(reply, reply_size - 1) != reply[reply_size - 1]) {
+        host->error = SDQHostErrorInvalidCRC;
+    }
+    return host->error == SDQHostErrorNone;
+}
+
+bool sdq_host_probe(SDQHost* host, SDQHostProbe* probe) {
+    memset(probe, 0, sizeof(SDQHostProbe));
+    sdq_host_wake(host);
+    for(size_t i = 0; i < COUNT_OF(sdq_host_probe_steps); i++) {
+        const SDQHostProbeStep* step = &sdq_host_probe_steps[i];
+        uint8_t* reply = (uint8_t*)probe + step->offset;
+        if(!sdq_host_transfer(
+               host, step->request, sizeof(step->request), reply, step->reply_size)) {
+            probe->error = host->error;
+            probe->failed_request = step->request[0];
+            return false;
+        }
+        sdq_host_wait_until(DWT->CYCCNT + SDQ_HOST_REQUEST_GAP_US * host->cycles_per_us);
+    }
+    return true;
+}
+
+const char* sdq_host_probe_kind(const SDQHostProbe* probe) {
+    for(size_t i = 0; i < COUNT_OF(sdq_host_kinds); i++) {
+        const uint8_t* known = (const uint8_t*)&responses + sdq_host_kinds[i].offset;
+        if(memcmp(probe->id, known, sizeof(responses.USB_UART)) == 0) {
+            return sdq_host_kinds[i].name;
+        }
+    }
+    return NULL;
+}
+
+const char* sdq_host_error_name(SDQHostError error) {
+    switch(error) {
+    case SDQHostErrorNone:
+        return "ok";
+    case SDQHostErrorNoReply:
+        return "no reply";
+    case SDQHostErrorBitReadTiming:
+        return "bit timing";
+    case SDQHostErrorInvalidCRC:
+        return "crc";
+    }
+    return "unknown";
+}
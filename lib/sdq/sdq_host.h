@@ -0,0 +1,73 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lib/sdq/sdq_device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Request and reply frames including the CRC byte
+#define SDQ_HOST_FRAME_MAX 16
+// Charging accessories answer a POLL only after a few hundred microseconds
+#define SDQ_HOST_REPLY_TIMEOUT_US 1000
+// Idle line between two transfers of a probe
+#define SDQ_HOST_REQUEST_GAP_US 200
+
+typedef enum {
+    SDQHostErrorNone = 0,
+    SDQHostErrorNoReply,
+    SDQHostErrorBitReadTiming,
+    SDQHostErrorInvalidCRC,
+} SDQHostError;
+
+/* Tristar side of the bus, for probing cables and accessories. Transmit edges are placed
+ * against absolute cycle counter deadlines, so time spent between two edges does not add up
+ * over a frame. */
+typedef struct {
+    const GpioPin* gpio_pin;
+    SDQTimings timings;
+    SDQHostError error;
+    uint32_t cycles_per_us;
+    // Cycle count of the next edge to drive
+    uint32_t edge;
+    // Worst delay between a deadline and its edge since alloc, in cycles
+    uint32_t edge_late_max;
+} SDQHost;
+
+/* What an accessory answered to the probe sequence: WAKE, POLL, 0x76 and POWER */
+typedef struct {
+    SDQHostError error;
+    // Request that failed, 0 when the probe went through
+    uint8_t failed_request;
+    uint8_t id[8];
+    uint8_t info[13];
+    uint8_t power[2];
+} SDQHostProbe;
+
+SDQHost* sdq_host_alloc(const GpioPin* gpio_pin);
+void sdq_host_free(SDQHost* host);
+
+/* WAKE pulse followed by its recovery time */
+void sdq_host_wake(SDQHost* host);
+
+/* BREAK, request with its CRC appended, BREAK, then read reply_size bytes. The last reply
+ * byte is the accessory's CRC and is checked. */
+bool sdq_host_transfer(
+    SDQHost* host,
+    const uint8_t* request,
+    size_t request_size,
+    uint8_t* reply,
+    size_t reply_size);
+
+bool sdq_host_probe(SDQHost* host, SDQHostProbe* probe);
+
+/* Names the accessory by its POLL answer, NULL if it matches none of the known ones */
+const char* sdq_host_probe_kind(const SDQHostProbe* probe);
+
+const char* sdq_host_error_name(SDQHostError error);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+#include <lib/stream_match/stream_match.h>
+#include <string.h>
+
+void stream_match_init(StreamMatch* match, const char* pattern) {
+    size_t len = strlen(pattern);
+    if(len > STREAM_MATCH_MAX_LEN) len = STREAM_MATCH_MAX_LEN;
+    match->pattern = pattern;
+    match->len = len;
+    match->state = 0;
+
+    // fail[i]: length of the longest proper border of pattern[0..i]
+    uint8_t border = 0;
+    match->fail[0] = 0;
+    for(uint8_t i = 1; i < len; i++) {
+        while(border > 0 && pattern[i] != pattern[border]) {
+            border = match->fail[border - 1];
+        }
+        if(pattern[i] == pattern[border]) border++;
+        match->fail[i] = border;
+    }
+}
+
+void stream_match_reset(StreamMatch* match) {
+    match->state = 0;
+}
+
+bool stream_match_feed(StreamMatch* match, char byte) {
+    if(match->len == 0) return false;
+    uint8_t state = match->state;
+    while(state > 0 && byte != match->pattern[state]) {
+        state = match->fail[state - 1];
+    }
+    if(byte == match->pattern[state]) state++;
+    if(state == match->len) {
+        match->state = match->fail[state - 1];
+        return true;
+    }
+    match->state = state;
+    return false;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_MATCH_MAX_LEN 32
+
+/* Incremental substring search (KMP). Bytes are fed one at a time as they arrive and every
+ * byte is looked at once, so a pattern split across packets is still found without keeping
+ * or re-scanning earlier data. */
+typedef struct {
+    const char* pattern;
+    uint8_t len;
+    uint8_t state;
+    uint8_t fail[STREAM_MATCH_MAX_LEN];
+} StreamMatch;
+
+/* Patterns longer than STREAM_MATCH_MAX_LEN are truncated */
+void stream_match_init(StreamMatch* match, const char* pattern);
+
+void stream_match_reset(StreamMatch* match);
+
+/* Returns true when `byte` completes an occurrence of the pattern */
+bool stream_match_feed(StreamMatch* match, char byte);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+#include <lib/text_file/text_file.h>
+#include <storage/storage.h>
+#include <stdlib.h>
+#include <string.h>
+
+char* text_file_read(const char* path, size_t max) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    char* text = NULL;
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        text = malloc(max + 1);
+        size_t len = storage_file_read(file, text, max);
+        text[len] = 0;
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return text;
+}
+
+char* text_file_trim(char* str) {
+    while(*str == ' ' || *str == '\t') str++;
+    char* end = str + strlen(str);
+    while(end > str && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) *--end = 0;
+    return str;
+}
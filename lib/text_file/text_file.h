@@ -0,0 +1,17 @@
+#pragma once
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Reads up to `max` bytes of a text file into a NUL terminated buffer the caller frees. NULL
+ * if the file cannot be opened, anything past `max` is left out. */
+char* text_file_read(const char* path, size_t max);
+
+/* Strips spaces, tabs and a trailing CR in place, returns where the text now starts */
+char* text_file_trim(char* str);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,114 @@
+#include <lib/timeline/boot_timeline.h>
+#include <lib/stream_match/stream_match.c>
+#include <stdio.h>
+#include <string.h>
+
+static const struct {
+    const char* banner;
+    BootStage stage;
+} boot_timeline_banners[BOOT_TIMELINE_BANNERS] = {
+    {"iBoot for ", BootStageIBoot},
+    {"iBSS for ", BootStageIBoot},
+    {"jumping into image at", BootStageKernel},
+    {"Darwin Kernel Version", BootStageKernel},
+    {"launchd", BootStageUserspace},
+    {"panic(cpu", BootStagePanic},
+    {"Debugger called: <panic>", BootStagePanic},
+};
+
+static const char* const boot_stage_names[BootStageCount] = {
+    "reset",
+    "iboot",
+    "kernel",
+    "userspace",
+    "panic",
+};
+
+void boot_timeline_init(BootTimeline* timeline) {
+    memset(timeline, 0, sizeof(BootTimeline));
+    for(size_t i = 0; i < BOOT_TIMELINE_BANNERS; i++) {
+        stream_match_init(&timeline->banners[i], boot_timeline_banners[i].banner);
+    }
+}
+
+static bool boot_timeline_finish(BootTimeline* timeline) {
+    BootTimelineSession* current = &timeline->current;
+    if(current->seen == 0) return false;
+    memcpy(&timeline->last, current, sizeof(BootTimelineSession));
+    uint32_t number = current->number;
+    memset(current, 0, sizeof(BootTimelineSession));
+    current->number = number;
+    return true;
+}
+
+static void boot_timeline_begin(BootTimeline* timeline, uint32_t tick) {
+    timeline->current.number++;
+    timeline->current.start = tick;
+}
+
+void boot_timeline_mark_reset(BootTimeline* timeline, uint32_t tick) {
+    // A reset while the previous boot is still running ends it without a report
+    uint32_t number = timeline->current.number;
+    memset(&timeline->current, 0, sizeof(BootTimelineSession));
+    timeline->current.number = number;
+    boot_timeline_begin(timeline, tick);
+    timeline->current.at[BootStageReset] = tick;
+    timeline->current.seen = (1 << BootStageReset);
+}
+
+bool boot_timeline_feed(
+    BootTimeline* timeline,
+    const uint8_t* data,
+    size_t len,
+    uint32_t end_tick,
+    uint32_t byte_us) {
+    bool finished = false;
+    for(size_t i = 0; i < len; i++) {
+        for(size_t b = 0; b < BOOT_TIMELINE_BANNERS; b++) {
+            if(!stream_match_feed(&timeline->banners[b], data[i])) continue;
+
+            const BootStage stage = boot_timeline_banners[b].stage;
+            const uint32_t tick = end_tick - (uint32_t)((len - 1 - i) * byte_us / 1000);
+            BootTimelineSession* current = &timeline->current;
+            if(current->seen & (1 << stage)) {
+                // iBoot prints its banner once per boot, seeing it again means a reboot
+                if(stage != BootStageIBoot) continue;
+                finished |= boot_timeline_finish(timeline);
+            }
+            if(current->seen == 0) {
+                // Userspace chatter after a finished boot is not a new one
+                if(stage != BootStageIBoot) continue;
+                boot_timeline_begin(timeline, tick);
+            }
+            current->at[stage] = tick;
+            current->seen |= (1 << stage);
+            if(stage == BootStageUserspace || stage == BootStagePanic) {
+                finished |= boot_timeline_finish(timeline);
+            }
+        }
+    }
+    return finished;
+}
+
+size_t boot_timeline_format(const BootTimelineSession* session, char* out, size_t size) {
+    int written = snprintf(out, size, "boot #%lu:", (unsigned long)session->number);
+    uint32_t total = 0;
+    for(size_t stage = 0; stage < BootStageCount; stage++) {
+        if(!(session->seen & (1 << stage))) continue;
+        const uint32_t offset = session->at[stage] - session->start;
+        if(offset > total) total = offset;
+        if(written >= 0 && (size_t)written < size) {
+            written += snprintf(
+                out + written,
+                size - written,
+                " %s +%lums",
+                boot_stage_names[stage],
+                (unsigned long)offset);
+        }
+    }
+    if(written >= 0 && (size_t)written < size) {
+        written += snprintf(out + written, size - written, " total %lums", (unsigned long)total);
+    }
+    if(written < 0) return 0;
+    return (size_t)written < size ? (size_t)written : size - 1;
+}
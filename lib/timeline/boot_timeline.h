@@ -0,0 +1,57 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lib/stream_match/stream_match.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    BootStageReset,
+    BootStageIBoot,
+    BootStageKernel,
+    BootStageUserspace,
+    BootStagePanic,
+    BootStageCount,
+} BootStage;
+
+#define BOOT_TIMELINE_BANNERS 7
+
+/* One boot, times in ms (furi ticks). A session begins with an SDQ reset or, when the phone was
+ * rebooted some other way, with the first iBoot banner. Stages are kept at their first sighting. */
+typedef struct {
+    uint32_t number;
+    uint32_t start;
+    uint32_t at[BootStageCount];
+    uint8_t seen;
+} BootTimelineSession;
+
+typedef struct {
+    BootTimelineSession current;
+    BootTimelineSession last;
+    StreamMatch banners[BOOT_TIMELINE_BANNERS];
+} BootTimeline;
+
+void boot_timeline_init(BootTimeline* timeline);
+
+/* Start a new session at `tick`, the moment the reset was sent over SDQ */
+void boot_timeline_mark_reset(BootTimeline* timeline, uint32_t tick);
+
+/* Scan UART output for stage banners. `end_tick` is when the last byte of `data` was received,
+ * earlier bytes are dated back by `byte_us` each. Returns true when a session ended (userspace
+ * reached, panic, or a new boot interrupted it) and `last` holds a fresh report. */
+bool boot_timeline_feed(
+    BootTimeline* timeline,
+    const uint8_t* data,
+    size_t len,
+    uint32_t end_tick,
+    uint32_t byte_us);
+
+/* One line report, stages that were not reached are left out */
+size_t boot_timeline_format(const BootTimelineSession* session, char* out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,80 @@
+#include <lib/trace/sdq_trace.h>
+#include <lib/sdq/sdq_device.h>
+#include <stdio.h>
+#include <string.h>
+
+void sdq_trace_reset(SDQTrace* trace) {
+    trace->tail = trace->head;
+    trace->lost = 0;
+    trace->base_valid = false;
+}
+
+bool sdq_trace_take(SDQTrace* trace, SDQTraceEntry* out) {
+    while(1) {
+        uint32_t head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+        // The oldest slot is the next one the writer fills, it is given up as well
+        if(head - trace->tail > SDQ_TRACE_COUNT - 1) {
+            trace->lost += head - trace->tail - (SDQ_TRACE_COUNT - 1);
+            trace->tail = head - (SDQ_TRACE_COUNT - 1);
+        }
+        if(trace->tail == head) {
+            return false;
+        }
+        memcpy(out, &trace->entries[trace->tail & (SDQ_TRACE_COUNT - 1)], sizeof(SDQTraceEntry));
+        // The slot may have been reused while it was copied, then go round and skip ahead
+        head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+        if(head - trace->tail <= SDQ_TRACE_COUNT - 1) {
+            trace->tail++;
+            return true;
+        }
+    }
+}
+
+size_t sdq_trace_format(
+    SDQTrace* trace,
+    const SDQTraceEntry* entry,
+    uint32_t cycles_per_us,
+    char* out,
+    size_t size) {
+    if(!trace->base_valid) {
+        trace->base_cycles = entry->cycles;
+        trace->base_valid = true;
+    }
+    char bytes[SDQ_TRACE_BYTES * 2 + 1] = {0};
+    const uint8_t count = entry->len < SDQ_TRACE_BYTES ? entry->len : SDQ_TRACE_BYTES;
+    for(uint8_t i = 0; i < count; i++) {
+        snprintf(bytes + i * 2, 3, "%02X", entry->bytes[i]);
+    }
+    int len = snprintf(
+        out,
+        size,
+        "%lu,%s,%02X,%u,%s,%s",
+        (unsigned long)((entry->cycles - trace->base_cycles) / cycles_per_us),
+        sdq_trace_event_name(entry->event),
+        entry->opcode,
+        entry->len,
+        bytes,
+        sdq_device_error_name(entry->error));
+    if(len < 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+const char* sdq_trace_event_name(SDQTraceEvent event) {
+    switch(event) {
+    case SDQTraceEventWake:
+        return "wake";
+    case SDQTraceEventBreak:
+        return "break";
+    case SDQTraceEventRequest:
+        return "request";
+    case SDQTraceEventResponse:
+        return "response";
+    case SDQTraceEventEnd:
+        return "end";
+    case SDQTraceEventResync:
+        return "resync";
+    default:
+        break;
+    }
+    return "unknown";
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Power of two, the newest entries overwrite the oldest
+#define SDQ_TRACE_COUNT 256
+#define SDQ_TRACE_BYTES 4
+#define SDQ_TRACE_LOG_NAME "sdq_trace.csv"
+#define SDQ_TRACE_LOG_HEADER "date,t_us,event,opcode,len,bytes,error"
+
+typedef enum {
+    // Low-power wake, bytes[0] holds the estimated latency in us, 255 when it came too late
+    SDQTraceEventWake,
+    // A valid BREAK opened a session, opcode holds the error it resynced from if any
+    SDQTraceEventBreak,
+    // Frame from Tristar as received including its CRC, error set when it did not decode
+    SDQTraceEventRequest,
+    // Frame the engine answered with, without the CRC it appends
+    SDQTraceEventResponse,
+    // The session ended, error is what ended it
+    SDQTraceEventEnd,
+    // A broken frame was dropped, the engine looks for the next BREAK in the same session
+    SDQTraceEventResync,
+    SDQTraceEventCount,
+} SDQTraceEvent;
+
+/* DWT cycle stamp, the SDQDeviceError at the time and the bytes following the opcode */
+typedef struct {
+    uint32_t cycles;
+    uint8_t event;
+    uint8_t opcode;
+    uint8_t error;
+    uint8_t len;
+    uint8_t bytes[SDQ_TRACE_BYTES];
+} SDQTraceEntry;
+
+/* Single writer, the SDQ interrupt, and single reader, whichever thread drains it. The writer
+ * never waits: it fills the slot and then publishes it by moving head. The reader copies an
+ * entry and only keeps it if the writer has not lapped it meanwhile. */
+typedef struct {
+    SDQTraceEntry entries[SDQ_TRACE_COUNT];
+    volatile uint32_t head;
+    uint32_t tail;
+    // Entries overwritten before they were drained
+    uint32_t lost;
+    uint32_t base_cycles;
+    bool base_valid;
+} SDQTrace;
+
+void sdq_trace_reset(SDQTrace* trace);
+
+/* Interrupt side, a dozen stores. Bytes beyond SDQ_TRACE_BYTES are only counted in len. */
+static inline void sdq_trace_put(
+    SDQTrace* trace,
+    uint32_t cycles,
+    SDQTraceEvent event,
+    uint8_t opcode,
+    uint8_t error,
+    const uint8_t* bytes,
+    uint8_t len) {
+    const uint32_t head = trace->head;
+    SDQTraceEntry* entry = &trace->entries[head & (SDQ_TRACE_COUNT - 1)];
+    entry->cycles = cycles;
+    entry->event = event;
+    entry->opcode = opcode;
+    entry->error = error;
+    entry->len = len;
+    for(uint8_t i = 0; i < len && i < SDQ_TRACE_BYTES; i++) {
+        entry->bytes[i] = bytes[i];
+    }
+    __atomic_store_n(&trace->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* Thread side. Copies out the oldest entry still in the ring, false once it is empty. */
+bool sdq_trace_take(SDQTrace* trace, SDQTraceEntry* out);
+
+/* One CSV line matching SDQ_TRACE_LOG_HEADER without the date column, times relative to the
+ * first entry drained since the last reset */
+size_t sdq_trace_format(
+    SDQTrace* trace,
+    const SDQTraceEntry* entry,
+    uint32_t cycles_per_us,
+    char* out,
+    size_t size);
+
+const char* sdq_trace_event_name(SDQTraceEvent event);
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,13 +6,51 @@
 #include <furi_hal_usb_cdc.h>
 #include "yuricable_pro_max_asciiart.h"
 #include <log_saver.h>
+#include <lib/rpc/yuri_rpc.c>
+#include <lib/timeline/boot_timeline.c>
+#include <lib/line_filter/line_filter.c>
 
 //TODO: FL-3276 port to new USART API
 #include <stm32wbxx_ll_lpuart.h>
 #include <stm32wbxx_ll_usart.h>
 
 #define USB_CDC_PKT_LEN      CDC_DATA_SZ
-#define USB_UART_RX_BUF_SIZE (USB_CDC_PKT_LEN * 5)
+#define USB_UART_RX_BUF_SIZE (USB_CDC_PKT_LEN * 16)
+
+// Partial packets are held back at most this long so light traffic still goes out promptly
+#define USB_UART_FLUSH_DEADLINE_MS 2
+// A CDC packet that is not acknowledged within this time means nobody is reading the port
+#define USB_UART_TX_TIMEOUT_MS 100
+
+// Queued bridge output (command replies, RPC frames) sent between UART packets
+#define USB_UART_CHATTER_BUF_SIZE (USB_CDC_PKT_LEN * 8)
+// Give the terminal time to settle before greeting it
+#define USB_UART_MOTD_DELAY_MS 100
+
+// DMA completion timestamps kept for latency accounting, must be a power of two
+#define USB_UART_RX_STAMP_COUNT 16
+
+#define USB_UART_TIMELINE_REPORT_LEN 128
+// A boot report the chatter queue had no room for is tried again this often
+#define USB_UART_TIMELINE_RETRY_MS 20
+
+// Lines that passed the filter and wait for CDC
+#define USB_UART_FILTERED_BUF_SIZE (USB_CDC_PKT_LEN * 8)
+// An unterminated line (a prompt) is decided after this much silence
+#define USB_UART_FILTER_IDLE_MS 50
+
+// SD payloads are streamed through two buffers of this size, whatever the file size
+#define USB_UART_INJECT_CHUNK   512
+#define USB_UART_INJECT_BUFFERS 2
+// How often a waiting injector looks at the stop request
+#define USB_UART_INJECT_POLL_MS 50
+
+// Queued writes from other threads, the TX thread sends them like forwarded CDC data
+#define USB_UART_SEND_BUF_SIZE 256
+
+#define USB_UART_PORT_MAIN 0
+#define USB_UART_PORT_AUX  1
+#define USB_UART_PORTS     2
 
 #define USB_CDC_BIT_DTR     (1 << 0)
 #define USB_CDC_BIT_RTS     (1 << 1)
@@ -37,12 +75,73 @@ typedef enum {
     WorkerEvtLineCfgSet = (1 << 6),
     WorkerEvtCtrlLineSet = (1 << 7),
 
+    WorkerEvtChatter = (1 << 8),
+    WorkerEvtCtrlRx = (1 << 9),
+    WorkerEvtMotd = (1 << 10),
+    WorkerEvtSdqReset = (1 << 11),
+    WorkerEvtInject = (1 << 12),
+    WorkerEvtSend = (1 << 13),
+
 } WorkerEvtFlags;
 
 #define WORKER_ALL_RX_EVENTS                                                      \
     (WorkerEvtStop | WorkerEvtRxDone | WorkerEvtCfgChange | WorkerEvtLineCfgSet | \
-     WorkerEvtCtrlLineSet | WorkerEvtCdcTxComplete)
-#define WORKER_ALL_TX_EVENTS (WorkerEvtTxStop | WorkerEvtCdcRx)
+     WorkerEvtCtrlLineSet | WorkerEvtCdcTxComplete | WorkerEvtChatter | WorkerEvtMotd | \
+     WorkerEvtSdqReset)
+#define WORKER_ALL_TX_EVENTS \
+    (WorkerEvtTxStop | WorkerEvtCdcRx | WorkerEvtCtrlRx | WorkerEvtInject | WorkerEvtSend)
+
+typedef struct {
+    uint32_t end;
+    uint32_t cycles;
+    uint32_t tick;
+} UsbUartRxStamp;
+
+typedef struct {
+    FuriSemaphore* sem;
+    uint32_t started;
+} UsbUartEndpoint;
+
+typedef struct {
+    uint8_t idx;
+    uint16_t len;
+} UsbUartInjectChunk;
+
+/* SD file streamed to the main UART: the injector thread reads into one buffer while the TX
+ * thread sends the other */
+typedef struct {
+    FuriThread* thread;
+    File* file;
+    FuriSemaphore* free_sem;
+    FuriMessageQueue* ready;
+    UsbUartInjectPacing pacing;
+    volatile bool stop;
+    volatile bool running;
+    bool started;
+    volatile uint32_t sent;
+    uint32_t total;
+    uint8_t buf[USB_UART_INJECT_BUFFERS][USB_UART_INJECT_CHUNK];
+} UsbUartInject;
+
+/* One Flipper UART with its own DMA ring and log session */
+typedef struct {
+    UsbUartBridge* bridge;
+    uint8_t id;
+    FuriHalSerialHandle* serial_handle;
+    FuriStreamBuffer* rx_stream;
+    LogSaver* log;
+
+    uint32_t rx_cnt;
+    uint32_t rx_dropped;
+    uint32_t baudrate_cur;
+    uint32_t rx_pending_since;
+
+    UsbUartRxStamp rx_stamps[USB_UART_RX_STAMP_COUNT];
+    volatile uint32_t rx_stamp_head;
+    uint32_t rx_stamp_tail;
+    volatile uint32_t rx_in;
+    uint32_t rx_out;
+} UsbUartPort;
 
 struct UsbUartBridge {
     UsbUartConfig cfg;
@@ -51,23 +150,68 @@ struct UsbUartBridge {
     FuriThread* thread;
     FuriThread* tx_thread;
 
-    FuriStreamBuffer* rx_stream;
-    FuriHalSerialHandle* serial_handle;
+    UsbUartPort port[USB_UART_PORTS];
+    FuriStreamBuffer* filtered_stream;
+    FuriStreamBuffer* chatter_stream;
 
     FuriMutex* usb_mutex;
+    FuriMutex* chatter_mutex;
 
-    FuriSemaphore* tx_sem;
+    UsbUartEndpoint data_ep;
+    UsbUartEndpoint ctrl_ep;
 
     UsbUartState st;
 
+    // Next source on the data endpoint: a port, or USB_UART_PORTS for chatter
+    uint8_t turn;
+
+    size_t motd_sent;
+    uint32_t motd_due;
+    bool motd_pending;
+
+    BootTimeline timeline;
+    volatile uint32_t reset_tick;
+    bool timeline_pending;
+    char timeline_report[USB_UART_TIMELINE_REPORT_LEN];
+    // Copy of the last finished boot for /timeline, the worker rewrites timeline.last in place
+    BootTimelineSession timeline_last;
+    FuriMutex* timeline_mutex;
+
+    UsbUartInject* inject;
+
+    FuriStreamBuffer* send_stream;
+    FuriMutex* send_mutex;
+    // Constant buffer posted from an interrupt, sent after the queued bytes
+    const uint8_t* posted_data;
+    size_t posted_len;
+
+    LineFilter filter;
+    FuriMutex* filter_mutex;
+    bool filter_on;
+    uint8_t filter_buf[USB_CDC_PKT_LEN];
+
     UsbUartBridgeCommand commandCallback;
     void* commandContext;
 
+    UsbUartBridgeRpc rpcCallback;
+    void* rpcContext;
+
+    UsbUartBridgeRx rxCallback;
+    void* rxContext;
+    bool rpc_mode;
+    bool is_command;
+    size_t command_length;
+    uint8_t command_buffer[COMMAND_LENGTH];
+    YuriRpcParser rpc_parser;
+    uint8_t rpc_frame[YURI_RPC_FRAME_MAX];
+
     FuriApiLock cfg_lock;
 
     CliVcp* cli_vcp;
 
-    uint8_t rx_buf[USB_CDC_PKT_LEN];
+    // Room for the mux header in front of a full packet
+    uint8_t rx_buf[USB_UART_MUX_HEADER_SIZE + USB_CDC_PKT_LEN];
+    uint8_t chatter_buf[USB_UART_MUX_HEADER_SIZE + USB_CDC_PKT_LEN];
 };
 
 static void vcp_on_cdc_tx_complete(void* context);
@@ -76,6 +220,11 @@ static void vcp_state_callback(void* context, uint8_t state);
 static void vcp_on_cdc_control_line(void* context, uint8_t state);
 static void vcp_on_line_config(void* context, struct usb_cdc_line_coding* config);
 
+static void vcp_ctrl_on_cdc_tx_complete(void* context);
+static void vcp_ctrl_on_cdc_rx(void* context);
+static void vcp_ctrl_on_cdc_control_line(void* context, uint8_t state);
+static void vcp_ctrl_on_line_config(void* context, struct usb_cdc_line_coding* config);
+
 static const CdcCallbacks cdc_cb = {
     vcp_on_cdc_tx_complete,
     vcp_on_cdc_rx,
@@ -84,16 +233,35 @@ static const CdcCallbacks cdc_cb = {
     vcp_on_line_config,
 };
 
+static const CdcCallbacks cdc_ctrl_cb = {
+    vcp_ctrl_on_cdc_tx_complete,
+    vcp_ctrl_on_cdc_rx,
+    vcp_state_callback,
+    vcp_ctrl_on_cdc_control_line,
+    vcp_ctrl_on_line_config,
+};
+
+/* Control interface when commands are split from the data interface */
+static inline uint8_t usb_uart_ctrl_ch(uint8_t vcp_ch) {
+    return vcp_ch == 0 ? 1 : 0;
+}
+
 /* USB UART worker */
 
 static int32_t usb_uart_tx_thread(void* context);
 
+static inline uint32_t usb_uart_cycles(void) {
+    return DWT->CYCCNT;
+}
+
 static void usb_uart_on_irq_rx_dma_cb(
     FuriHalSerialHandle* handle,
     FuriHalSerialRxEvent ev,
     size_t size,
     void* context) {
-    UsbUartBridge* usb_uart = (UsbUartBridge*)context;
+    UsbUartPort* port = (UsbUartPort*)context;
+    UsbUartBridge* usb_uart = port->bridge;
+    const uint32_t start = usb_uart_cycles();
 
     if(ev & (FuriHalSerialRxEventData | FuriHalSerialRxEventIdle)) {
         uint8_t data[FURI_HAL_SERIAL_DMA_BUFFER_SIZE] = {0};
@@ -102,16 +270,69 @@ static void usb_uart_on_irq_rx_dma_cb(
                 handle,
                 data,
                 (size > FURI_HAL_SERIAL_DMA_BUFFER_SIZE) ? FURI_HAL_SERIAL_DMA_BUFFER_SIZE : size);
-            furi_stream_buffer_send(usb_uart->rx_stream, data, ret, 0);
+            size_t sent = furi_stream_buffer_send(port->rx_stream, data, ret, 0);
+            port->rx_in += sent;
+            port->rx_dropped += ret - sent;
             size -= ret;
         };
+        const uint32_t head = port->rx_stamp_head;
+        UsbUartRxStamp* stamp = &port->rx_stamps[head & (USB_UART_RX_STAMP_COUNT - 1)];
+        stamp->end = port->rx_in;
+        stamp->cycles = start;
+        stamp->tick = furi_get_tick();
+        __atomic_store_n(&port->rx_stamp_head, head + 1, __ATOMIC_RELEASE);
         furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtRxDone);
     }
+    usb_uart->st.busy_cycles += usb_uart_cycles() - start;
 }
 
-static void usb_uart_vcp_init(UsbUartBridge* usb_uart, uint8_t vcp_ch) {
+/* DMA completion stamp of the chunk that carried the byte at stream offset `offset` */
+static bool usb_uart_rx_stamp_of(UsbUartPort* port, uint32_t offset, UsbUartRxStamp* out) {
+    while(1) {
+        uint32_t head = __atomic_load_n(&port->rx_stamp_head, __ATOMIC_ACQUIRE);
+        // The oldest slot is the next one the DMA callback fills, it is given up as well
+        if(head - port->rx_stamp_tail > USB_UART_RX_STAMP_COUNT - 1) {
+            port->rx_stamp_tail = head - (USB_UART_RX_STAMP_COUNT - 1);
+        }
+        if(port->rx_stamp_tail == head) {
+            return false;
+        }
+        memcpy(
+            out,
+            &port->rx_stamps[port->rx_stamp_tail & (USB_UART_RX_STAMP_COUNT - 1)],
+            sizeof(UsbUartRxStamp));
+        // The slot may have been reused while it was copied, then go round and skip ahead
+        head = __atomic_load_n(&port->rx_stamp_head, __ATOMIC_ACQUIRE);
+        if(head - port->rx_stamp_tail > USB_UART_RX_STAMP_COUNT - 1) {
+            continue;
+        }
+        if((int32_t)(out->end - offset) > 0) {
+            return true;
+        }
+        port->rx_stamp_tail++;
+    }
+}
+
+static void usb_uart_record_latency(UsbUartBridge* usb_uart, uint32_t since) {
+    uint32_t latency_us =
+        (usb_uart_cycles() - since) / furi_hal_cortex_instructions_per_microsecond();
+    size_t bucket = 0;
+    while(latency_us && bucket < USB_UART_LATENCY_BUCKETS - 1) {
+        latency_us >>= 1;
+        bucket++;
+    }
+    usb_uart->st.latency_hist[bucket]++;
+}
+
+static void usb_uart_vcp_init(UsbUartBridge* usb_uart, uint8_t vcp_ch, uint8_t ctrl_split) {
     furi_hal_usb_unlock();
-    if(vcp_ch == 0) {
+    if(ctrl_split) {
+        // Both interfaces belong to the bridge, the Flipper CLI has to make room
+        cli_vcp_disable(usb_uart->cli_vcp);
+        furi_check(furi_hal_usb_set_config(&usb_cdc_dual, NULL) == true);
+        furi_hal_cdc_set_callbacks(
+            usb_uart_ctrl_ch(vcp_ch), (CdcCallbacks*)&cdc_ctrl_cb, usb_uart);
+    } else if(vcp_ch == 0) {
         cli_vcp_disable(usb_uart->cli_vcp);
         furi_check(furi_hal_usb_set_config(&usb_cdc_single, NULL) == true);
     } else {
@@ -121,47 +342,82 @@ static void usb_uart_vcp_init(UsbUartBridge* usb_uart, uint8_t vcp_ch) {
     furi_hal_cdc_set_callbacks(vcp_ch, (CdcCallbacks*)&cdc_cb, usb_uart);
 }
 
-static void usb_uart_vcp_deinit(UsbUartBridge* usb_uart, uint8_t vcp_ch) {
-    UNUSED(usb_uart);
+static void usb_uart_vcp_deinit(UsbUartBridge* usb_uart, uint8_t vcp_ch, uint8_t ctrl_split) {
     furi_hal_cdc_set_callbacks(vcp_ch, NULL, NULL);
+    if(ctrl_split) {
+        furi_hal_cdc_set_callbacks(usb_uart_ctrl_ch(vcp_ch), NULL, NULL);
+    }
     if(vcp_ch != 0) {
         cli_vcp_disable(usb_uart->cli_vcp);
     }
 }
 
-static void usb_uart_serial_init(UsbUartBridge* usb_uart, uint8_t uart_ch) {
-    furi_assert(!usb_uart->serial_handle);
+static bool usb_uart_serial_init(UsbUartPort* port, uint8_t uart_ch) {
+    furi_assert(!port->serial_handle);
 
-    usb_uart->serial_handle = furi_hal_serial_control_acquire(uart_ch);
-    furi_assert(usb_uart->serial_handle);
+    port->serial_handle = furi_hal_serial_control_acquire(uart_ch);
+    if(!port->serial_handle) return false;
 
-    furi_hal_serial_init(usb_uart->serial_handle, 115200);
-    furi_hal_serial_dma_rx_start(
-        usb_uart->serial_handle, usb_uart_on_irq_rx_dma_cb, usb_uart, false);
+    furi_hal_serial_init(port->serial_handle, 115200);
+    furi_hal_serial_dma_rx_start(port->serial_handle, usb_uart_on_irq_rx_dma_cb, port, false);
+    return true;
 }
 
-static void usb_uart_serial_deinit(UsbUartBridge* usb_uart) {
-    furi_assert(usb_uart->serial_handle);
+static void usb_uart_serial_deinit(UsbUartPort* port) {
+    furi_assert(port->serial_handle);
 
-    furi_hal_serial_deinit(usb_uart->serial_handle);
-    furi_hal_serial_control_release(usb_uart->serial_handle);
-    usb_uart->serial_handle = NULL;
+    furi_hal_serial_deinit(port->serial_handle);
+    furi_hal_serial_control_release(port->serial_handle);
+    port->serial_handle = NULL;
 }
 
 static void usb_uart_set_baudrate(UsbUartBridge* usb_uart, uint32_t baudrate) {
+    UsbUartPort* port = &usb_uart->port[USB_UART_PORT_MAIN];
     if(baudrate != 0) {
-        furi_hal_serial_set_br(usb_uart->serial_handle, baudrate);
-        usb_uart->st.baudrate_cur = baudrate;
+        furi_hal_serial_set_br(port->serial_handle, baudrate);
+        port->baudrate_cur = baudrate;
     } else {
         struct usb_cdc_line_coding* line_cfg =
             furi_hal_cdc_get_port_settings(usb_uart->cfg.vcp_ch);
         if(line_cfg->dwDTERate > 0) {
-            furi_hal_serial_set_br(usb_uart->serial_handle, line_cfg->dwDTERate);
-            usb_uart->st.baudrate_cur = line_cfg->dwDTERate;
+            furi_hal_serial_set_br(port->serial_handle, line_cfg->dwDTERate);
+            port->baudrate_cur = line_cfg->dwDTERate;
         }
     }
 }
 
+static inline uint8_t usb_uart_aux_ch(uint8_t uart_ch) {
+    return uart_ch == FuriHalSerialIdUsart ? FuriHalSerialIdLpuart : FuriHalSerialIdUsart;
+}
+
+/* The second UART runs at a fixed rate, it has no CDC line coding to follow */
+static void usb_uart_aux_start(UsbUartBridge* usb_uart) {
+    UsbUartPort* port = &usb_uart->port[USB_UART_PORT_AUX];
+    if(usb_uart->cfg.aux_baudrate == 0) return;
+    if(!usb_uart_serial_init(port, usb_uart_aux_ch(usb_uart->cfg.uart_ch))) {
+        FURI_LOG_W("UsbUart", "Second UART is busy");
+        return;
+    }
+    furi_hal_serial_set_br(port->serial_handle, usb_uart->cfg.aux_baudrate);
+    port->baudrate_cur = usb_uart->cfg.aux_baudrate;
+}
+
+static void usb_uart_aux_stop(UsbUartBridge* usb_uart) {
+    UsbUartPort* port = &usb_uart->port[USB_UART_PORT_AUX];
+    if(port->serial_handle) usb_uart_serial_deinit(port);
+    port->baudrate_cur = 0;
+}
+
+/* With both UARTs running every data packet carries a tag telling whose bytes it holds */
+static inline bool usb_uart_muxed(UsbUartBridge* usb_uart) {
+    return usb_uart->port[USB_UART_PORT_AUX].serial_handle != NULL;
+}
+
+static inline size_t usb_uart_payload_max(UsbUartBridge* usb_uart) {
+    return usb_uart_muxed(usb_uart) ? USB_CDC_PKT_LEN - USB_UART_MUX_HEADER_SIZE :
+                                      USB_CDC_PKT_LEN;
+}
+
 static void usb_uart_update_ctrl_lines(UsbUartBridge* usb_uart) {
     if(usb_uart->cfg.flow_pins != 0) {
         furi_assert((size_t)(usb_uart->cfg.flow_pins - 1) < COUNT_OF(flow_pins));
@@ -172,15 +428,296 @@ static void usb_uart_update_ctrl_lines(UsbUartBridge* usb_uart) {
     }
 }
 
-void usb_uart_print_motd(UsbUartBridge* usb_uart) {
-    furi_delay_ms(100);
-    size_t l = 10;
-    for(size_t i = 0; i < sizeof(MOTD_ASCII_ART); i += l) {
-        if(i + l > sizeof(MOTD_ASCII_ART)) {
-            l = sizeof(MOTD_ASCII_ART) - i;
+static void usb_uart_queue_motd(UsbUartBridge* usb_uart) {
+    usb_uart->motd_sent = 0;
+    usb_uart->motd_due = furi_get_tick() + furi_ms_to_ticks(USB_UART_MOTD_DELAY_MS);
+    usb_uart->motd_pending = true;
+}
+
+static void usb_uart_cdc_send(UsbUartBridge* usb_uart, uint8_t ch, uint8_t* data, size_t len) {
+    furi_check(furi_mutex_acquire(usb_uart->usb_mutex, FuriWaitForever) == FuriStatusOk);
+    furi_hal_cdc_send(ch, data, len);
+    furi_check(furi_mutex_release(usb_uart->usb_mutex) == FuriStatusOk);
+}
+
+/* Send a payload that was read to `buf + USB_UART_MUX_HEADER_SIZE`, tagged when muxed */
+static void usb_uart_cdc_send_tagged(UsbUartBridge* usb_uart, uint8_t* buf, size_t len, uint8_t tag) {
+    if(usb_uart_muxed(usb_uart)) {
+        buf[0] = USB_UART_MUX_SOF;
+        buf[1] = tag;
+        buf[2] = len;
+        usb_uart_cdc_send(usb_uart, usb_uart->cfg.vcp_ch, buf, len + USB_UART_MUX_HEADER_SIZE);
+    } else {
+        usb_uart_cdc_send(usb_uart, usb_uart->cfg.vcp_ch, buf + USB_UART_MUX_HEADER_SIZE, len);
+    }
+}
+
+/* Run a packet through the boot timeline. A packet can span several DMA chunks, each part is
+ * dated by its own chunk so stage times do not depend on when USB got around to sending it. */
+static void usb_uart_rx_timeline(UsbUartBridge* usb_uart, const uint8_t* data, size_t len) {
+    UsbUartPort* port = &usb_uart->port[USB_UART_PORT_MAIN];
+    const uint32_t byte_us = port->baudrate_cur ? 10000000UL / port->baudrate_cur : 0;
+    uint32_t offset = port->rx_out;
+    bool finished = false;
+    while(len > 0) {
+        UsbUartRxStamp stamp;
+        size_t part = len;
+        uint32_t end_tick = furi_get_tick();
+        if(usb_uart_rx_stamp_of(port, offset, &stamp)) {
+            if(stamp.end - offset < part) part = stamp.end - offset;
+            // The chunk may go on past this packet
+            end_tick = stamp.tick - (stamp.end - (offset + part)) * byte_us / 1000;
+        }
+        finished |= boot_timeline_feed(&usb_uart->timeline, data, part, end_tick, byte_us);
+        data += part;
+        len -= part;
+        offset += part;
+    }
+    if(finished) {
+        furi_check(furi_mutex_acquire(usb_uart->timeline_mutex, FuriWaitForever) == FuriStatusOk);
+        memcpy(&usb_uart->timeline_last, &usb_uart->timeline.last, sizeof(BootTimelineSession));
+        furi_check(furi_mutex_release(usb_uart->timeline_mutex) == FuriStatusOk);
+        size_t report_len = boot_timeline_format(
+            &usb_uart->timeline.last,
+            usb_uart->timeline_report,
+            sizeof(usb_uart->timeline_report) - 2);
+        memcpy(usb_uart->timeline_report + report_len, "\r\n", 3);
+        usb_uart->timeline_pending = true;
+    }
+}
+
+/* Everything that follows the main UART byte by byte, whether or not the line filter is on */
+static void usb_uart_rx_watch(UsbUartBridge* usb_uart, const uint8_t* data, size_t len) {
+    usb_uart_rx_timeline(usb_uart, data, len);
+    if(usb_uart->rxCallback) {
+        usb_uart->rxCallback(data, len, usb_uart->rxContext);
+    }
+}
+
+/* Queue the last boot report. The worker must not block on the chatter queue it drains itself,
+ * so this gives up while another thread is printing and is retried on a short timeout. */
+static void usb_uart_timeline_print(UsbUartBridge* usb_uart) {
+    const size_t len = strlen(usb_uart->timeline_report);
+    if(furi_mutex_acquire(usb_uart->chatter_mutex, 0) != FuriStatusOk) return;
+    if(furi_stream_buffer_spaces_available(usb_uart->chatter_stream) >= len + 2) {
+        furi_stream_buffer_send(usb_uart->chatter_stream, "\r\n", 2, 0);
+        furi_stream_buffer_send(usb_uart->chatter_stream, usb_uart->timeline_report, len, 0);
+        usb_uart->timeline_pending = false;
+    }
+    furi_check(furi_mutex_release(usb_uart->chatter_mutex) == FuriStatusOk);
+}
+
+static void usb_uart_filter_output(const uint8_t* data, size_t len, void* context) {
+    UsbUartBridge* usb_uart = (UsbUartBridge*)context;
+    size_t sent = furi_stream_buffer_send(usb_uart->filtered_stream, data, len, 0);
+    usb_uart->port[USB_UART_PORT_MAIN].rx_dropped += len - sent;
+}
+
+/* Run everything received so far through the line filter. Stats and the boot timeline see the
+ * unfiltered stream, CDC and the SD log only the lines that pass. Returns the ms until a
+ * pending unterminated line is due. */
+static uint32_t usb_uart_rx_filter(UsbUartBridge* usb_uart) {
+    UsbUartPort* port = &usb_uart->port[USB_UART_PORT_MAIN];
+    furi_check(furi_mutex_acquire(usb_uart->filter_mutex, FuriWaitForever) == FuriStatusOk);
+    const uint32_t now = furi_get_tick();
+    size_t len;
+    while((len = furi_stream_buffer_receive(
+               port->rx_stream, usb_uart->filter_buf, USB_CDC_PKT_LEN, 0)) > 0) {
+        usb_uart_rx_watch(usb_uart, usb_uart->filter_buf, len);
+        port->rx_out += len;
+        port->rx_cnt += len;
+        line_filter_feed(
+            &usb_uart->filter, usb_uart->filter_buf, len, now, usb_uart_filter_output, usb_uart);
+    }
+    uint32_t wait = line_filter_poll(
+        &usb_uart->filter, now, USB_UART_FILTER_IDLE_MS, usb_uart_filter_output, usb_uart);
+    furi_check(furi_mutex_release(usb_uart->filter_mutex) == FuriStatusOk);
+    return wait == UINT32_MAX ? FuriWaitForever : furi_ms_to_ticks(wait);
+}
+
+/* Filtered lines still queued after the filter was switched off go out first */
+static FuriStreamBuffer* usb_uart_rx_source(UsbUartPort* port) {
+    UsbUartBridge* usb_uart = port->bridge;
+    if(port->id == USB_UART_PORT_MAIN &&
+       (usb_uart->filter_on ||
+        furi_stream_buffer_bytes_available(usb_uart->filtered_stream) > 0)) {
+        return usb_uart->filtered_stream;
+    }
+    return port->rx_stream;
+}
+
+static void usb_uart_rx_send_packet(UsbUartPort* port) {
+    UsbUartBridge* usb_uart = port->bridge;
+    const uint32_t start = usb_uart_cycles();
+    FuriStreamBuffer* source = usb_uart_rx_source(port);
+    uint8_t* payload = usb_uart->rx_buf + USB_UART_MUX_HEADER_SIZE;
+    size_t len = furi_stream_buffer_receive(source, payload, usb_uart_payload_max(usb_uart), 0);
+    port->rx_pending_since = 0;
+    usb_uart->st.cdc_packets++;
+    if(source == usb_uart->filtered_stream) {
+        usb_uart_cdc_send_tagged(usb_uart, usb_uart->rx_buf, len, port->id);
+        log_saver_write(port->log, (char*)payload, len);
+        usb_uart->st.busy_cycles += usb_uart_cycles() - start;
+        return;
+    }
+    UsbUartRxStamp stamp;
+    const uint32_t since = usb_uart_rx_stamp_of(port, port->rx_out, &stamp) ? stamp.cycles :
+                                                                             start;
+    if(port->id == USB_UART_PORT_MAIN) usb_uart_rx_watch(usb_uart, payload, len);
+    port->rx_out += len;
+    port->rx_cnt += len;
+    usb_uart_cdc_send_tagged(usb_uart, usb_uart->rx_buf, len, port->id);
+    if(port->id == USB_UART_PORT_MAIN) usb_uart_record_latency(usb_uart, since);
+    log_saver_write(port->log, (char*)payload, len);
+    usb_uart->st.busy_cycles += usb_uart_cycles() - start;
+}
+
+static void usb_uart_chatter_send_packet(UsbUartBridge* usb_uart) {
+    // Chatter sharing the data interface is tagged like UART data when muxed
+    const bool inline_chatter = !usb_uart->cfg.ctrl_split;
+    const size_t max = inline_chatter ? usb_uart_payload_max(usb_uart) : USB_CDC_PKT_LEN;
+    uint8_t* payload = usb_uart->chatter_buf + (inline_chatter ? USB_UART_MUX_HEADER_SIZE : 0);
+    size_t len = furi_stream_buffer_receive(usb_uart->chatter_stream, payload, max, 0);
+    if(len == 0 && usb_uart->motd_pending) {
+        len = sizeof(MOTD_ASCII_ART) - usb_uart->motd_sent;
+        if(len > max) len = max;
+        memcpy(payload, MOTD_ASCII_ART + usb_uart->motd_sent, len);
+        usb_uart->motd_sent += len;
+        usb_uart->motd_pending = usb_uart->motd_sent < sizeof(MOTD_ASCII_ART);
+    }
+    if(inline_chatter) {
+        usb_uart_cdc_send_tagged(usb_uart, usb_uart->chatter_buf, len, USB_UART_MUX_TAG_BRIDGE);
+    } else {
+        usb_uart_cdc_send(usb_uart, usb_uart_ctrl_ch(usb_uart->cfg.vcp_ch), payload, len);
+    }
+}
+
+static void usb_uart_drop_rx(UsbUartBridge* usb_uart) {
+    for(size_t i = 0; i < USB_UART_PORTS; i++) {
+        UsbUartPort* port = &usb_uart->port[i];
+        const size_t available = furi_stream_buffer_bytes_available(port->rx_stream);
+        port->rx_dropped += available;
+        port->rx_out += available;
+        furi_stream_buffer_reset(port->rx_stream);
+        port->rx_pending_since = 0;
+    }
+    usb_uart->port[USB_UART_PORT_MAIN].rx_dropped +=
+        furi_stream_buffer_bytes_available(usb_uart->filtered_stream);
+    furi_stream_buffer_reset(usb_uart->filtered_stream);
+}
+
+/* Whether a port has a packet worth sending. Full packets always are, a partial one once it
+ * is older than the flush deadline; `wait` is lowered to that deadline. */
+static bool usb_uart_port_ready(UsbUartPort* port, uint32_t now, uint32_t* wait) {
+    const size_t available = furi_stream_buffer_bytes_available(usb_uart_rx_source(port));
+    if(available >= usb_uart_payload_max(port->bridge)) return true;
+    if(available == 0) {
+        port->rx_pending_since = 0;
+        return false;
+    }
+    if(port->rx_pending_since == 0) {
+        port->rx_pending_since = now;
+    }
+    const uint32_t age = now - port->rx_pending_since;
+    if(age >= furi_ms_to_ticks(USB_UART_FLUSH_DEADLINE_MS)) return true;
+    const uint32_t left = furi_ms_to_ticks(USB_UART_FLUSH_DEADLINE_MS) - age;
+    if(left < *wait) *wait = left;
+    return false;
+}
+
+/* Round robin over the sources that are ready, USB_UART_PORTS stands for chatter */
+static uint8_t usb_uart_next_source(UsbUartBridge* usb_uart, const bool* ready, uint8_t count) {
+    for(uint8_t i = 0; i < count; i++) {
+        const uint8_t source = (usb_uart->turn + i) % count;
+        if(ready[source]) {
+            usb_uart->turn = (source + 1) % count;
+            return source;
+        }
+    }
+    return count;
+}
+
+static void usb_uart_drop_chatter(UsbUartBridge* usb_uart) {
+    furi_stream_buffer_reset(usb_uart->chatter_stream);
+    usb_uart->motd_pending = false;
+}
+
+/* Claim an endpoint for the next packet. While the previous packet is in flight `wait` is
+ * lowered to the time left before the transfer counts as stalled. */
+static bool usb_uart_ep_claim(UsbUartEndpoint* ep, uint32_t now, uint32_t* wait, bool* stalled) {
+    if(furi_semaphore_acquire(ep->sem, 0) == FuriStatusOk) {
+        ep->started = now;
+        return true;
+    }
+    const uint32_t in_flight = now - ep->started;
+    if(in_flight < furi_ms_to_ticks(USB_UART_TX_TIMEOUT_MS)) {
+        const uint32_t left = furi_ms_to_ticks(USB_UART_TX_TIMEOUT_MS) - in_flight;
+        if(left < *wait) *wait = left;
+    } else {
+        *stalled = true;
+    }
+    return false;
+}
+
+/* Schedule the CDC endpoints between UART data and bridge chatter. Full UART packets go out
+ * back-to-back, each one as soon as the previous is acknowledged; a partial packet waits for
+ * more data until the flush deadline expires. With a split control interface chatter has an
+ * endpoint of its own, otherwise it takes turns with the UARTs on the data endpoint, so
+ * neither the MOTD nor a long RPC reply can hold back incoming UART bytes. Never blocks,
+ * returns how long the worker may sleep before the drain has to run again. */
+static uint32_t usb_uart_tx_drain(UsbUartBridge* usb_uart) {
+    const bool split = usb_uart->cfg.ctrl_split;
+    while(1) {
+        uint32_t wait = FuriWaitForever;
+        if(usb_uart->filter_on) wait = usb_uart_rx_filter(usb_uart);
+        const uint32_t now = furi_get_tick();
+
+        bool ready[USB_UART_PORTS + 1] = {false};
+        bool data_ready = false;
+        for(size_t i = 0; i < USB_UART_PORTS; i++) {
+            if(!usb_uart->port[i].serial_handle) continue;
+            ready[i] = usb_uart_port_ready(&usb_uart->port[i], now, &wait);
+            data_ready |= ready[i];
+        }
+
+        bool chatter_ready = furi_stream_buffer_bytes_available(usb_uart->chatter_stream) > 0;
+        if(!chatter_ready && usb_uart->motd_pending) {
+            const int32_t until_motd = (int32_t)(usb_uart->motd_due - now);
+            chatter_ready = until_motd <= 0;
+            if(!chatter_ready && (uint32_t)until_motd < wait) wait = until_motd;
+        }
+        ready[USB_UART_PORTS] = chatter_ready && !split;
+
+        bool sent = false;
+        bool data_stalled = false;
+        bool ctrl_stalled = false;
+        if((data_ready || ready[USB_UART_PORTS]) &&
+           usb_uart_ep_claim(&usb_uart->data_ep, now, &wait, &data_stalled)) {
+            const uint8_t source = usb_uart_next_source(usb_uart, ready, USB_UART_PORTS + 1);
+            if(source < USB_UART_PORTS) {
+                usb_uart_rx_send_packet(&usb_uart->port[source]);
+            } else {
+                usb_uart_chatter_send_packet(usb_uart);
+            }
+            sent = true;
+        }
+        if(split) {
+            if(chatter_ready &&
+               usb_uart_ep_claim(&usb_uart->ctrl_ep, now, &wait, &ctrl_stalled)) {
+                usb_uart_chatter_send_packet(usb_uart);
+                sent = true;
+            }
+        } else {
+            ctrl_stalled = data_stalled;
+        }
+
+        // Nobody is reading the port
+        if(data_stalled) usb_uart_drop_rx(usb_uart);
+        if(ctrl_stalled) usb_uart_drop_chatter(usb_uart);
+
+        if(!sent) {
+            return wait;
         }
-        furi_hal_cdc_send(usb_uart->cfg.vcp_ch, (uint8_t*)MOTD_ASCII_ART + i, l);
-        furi_delay_us(500);
     }
 }
 
@@ -190,18 +727,23 @@ static int32_t usb_uart_worker(void* context) {
     memcpy(&usb_uart->cfg, &usb_uart->cfg_new, sizeof(UsbUartConfig));
 
     usb_uart->cli_vcp = furi_record_open(RECORD_CLI_VCP);
+    boot_timeline_init(&usb_uart->timeline);
 
-    usb_uart->rx_stream = furi_stream_buffer_alloc(USB_UART_RX_BUF_SIZE, 1);
+    for(size_t i = 0; i < USB_UART_PORTS; i++) {
+        usb_uart->port[i].rx_stream = furi_stream_buffer_alloc(USB_UART_RX_BUF_SIZE, 1);
+    }
+    usb_uart->filtered_stream = furi_stream_buffer_alloc(USB_UART_FILTERED_BUF_SIZE, 1);
+    usb_uart->chatter_stream = furi_stream_buffer_alloc(USB_UART_CHATTER_BUF_SIZE, 1);
 
-    usb_uart->tx_sem = furi_semaphore_alloc(1, 1);
+    usb_uart->data_ep.sem = furi_semaphore_alloc(1, 1);
+    usb_uart->ctrl_ep.sem = furi_semaphore_alloc(1, 1);
     usb_uart->usb_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    usb_uart->chatter_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
 
-    usb_uart->tx_thread =
-        furi_thread_alloc_ex("UsbUartTxWorker", 768, usb_uart_tx_thread, usb_uart);
-
-    usb_uart_vcp_init(usb_uart, usb_uart->cfg.vcp_ch);
-    usb_uart_serial_init(usb_uart, usb_uart->cfg.uart_ch);
+    usb_uart_vcp_init(usb_uart, usb_uart->cfg.vcp_ch, usb_uart->cfg.ctrl_split);
+    furi_check(usb_uart_serial_init(&usb_uart->port[USB_UART_PORT_MAIN], usb_uart->cfg.uart_ch));
     usb_uart_set_baudrate(usb_uart, usb_uart->cfg.baudrate);
+    usb_uart_aux_start(usb_uart);
     if(usb_uart->cfg.flow_pins != 0) {
         furi_assert((size_t)(usb_uart->cfg.flow_pins - 1) < COUNT_OF(flow_pins));
         furi_hal_gpio_init_simple(
@@ -214,52 +756,66 @@ static int32_t usb_uart_worker(void* context) {
     furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtCdcRx);
 
     furi_thread_start(usb_uart->tx_thread);
+    // Writes queued before it ran could not wake it
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtSend);
 
+    uint32_t timeout = FuriWaitForever;
     while(1) {
         uint32_t events =
-            furi_thread_flags_wait(WORKER_ALL_RX_EVENTS, FuriFlagWaitAny, FuriWaitForever);
+            furi_thread_flags_wait(WORKER_ALL_RX_EVENTS, FuriFlagWaitAny, timeout);
+        if(events == (uint32_t)FuriFlagErrorTimeout) events = 0;
         furi_check(!(events & FuriFlagError));
         if(events & WorkerEvtStop) break;
-        if(events & (WorkerEvtRxDone | WorkerEvtCdcTxComplete)) {
-            size_t len = furi_stream_buffer_receive(
-                usb_uart->rx_stream, usb_uart->rx_buf, USB_CDC_PKT_LEN, 0);
-            if(len > 0) {
-                if(furi_semaphore_acquire(usb_uart->tx_sem, 100) == FuriStatusOk) {
-                    usb_uart->st.rx_cnt += len;
-                    furi_check(
-                        furi_mutex_acquire(usb_uart->usb_mutex, FuriWaitForever) == FuriStatusOk);
-                    furi_hal_cdc_send(usb_uart->cfg.vcp_ch, usb_uart->rx_buf, len);
-                    save_log_and_write((char*)usb_uart->rx_buf, len);
-                    furi_check(furi_mutex_release(usb_uart->usb_mutex) == FuriStatusOk);
-                } else {
-                    furi_stream_buffer_reset(usb_uart->rx_stream);
-                }
-            }
+        if(events & WorkerEvtSdqReset) {
+            boot_timeline_mark_reset(&usb_uart->timeline, usb_uart->reset_tick);
+        }
+        timeout = usb_uart_tx_drain(usb_uart);
+        if(usb_uart->timeline_pending) {
+            usb_uart_timeline_print(usb_uart);
+            timeout = usb_uart_tx_drain(usb_uart);
         }
         if(events & WorkerEvtCfgChange) {
-            if(usb_uart->cfg.vcp_ch != usb_uart->cfg_new.vcp_ch) {
+            if(usb_uart->cfg.vcp_ch != usb_uart->cfg_new.vcp_ch ||
+               usb_uart->cfg.ctrl_split != usb_uart->cfg_new.ctrl_split) {
                 furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtTxStop);
                 furi_thread_join(usb_uart->tx_thread);
 
-                usb_uart_vcp_deinit(usb_uart, usb_uart->cfg.vcp_ch);
-                usb_uart_vcp_init(usb_uart, usb_uart->cfg_new.vcp_ch);
+                usb_uart_vcp_deinit(usb_uart, usb_uart->cfg.vcp_ch, usb_uart->cfg.ctrl_split);
+                usb_uart_vcp_init(
+                    usb_uart, usb_uart->cfg_new.vcp_ch, usb_uart->cfg_new.ctrl_split);
 
                 usb_uart->cfg.vcp_ch = usb_uart->cfg_new.vcp_ch;
+                usb_uart->cfg.ctrl_split = usb_uart->cfg_new.ctrl_split;
                 furi_thread_start(usb_uart->tx_thread);
+                // Chunks queued while it was down would wait for the next one otherwise
+                furi_thread_flags_set(
+                    furi_thread_get_id(usb_uart->tx_thread), WorkerEvtInject | WorkerEvtSend);
                 events |= WorkerEvtCtrlLineSet;
                 events |= WorkerEvtLineCfgSet;
+                events |= WorkerEvtMotd;
             }
             if(usb_uart->cfg.uart_ch != usb_uart->cfg_new.uart_ch) {
                 furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtTxStop);
                 furi_thread_join(usb_uart->tx_thread);
 
-                usb_uart_serial_deinit(usb_uart);
-                usb_uart_serial_init(usb_uart, usb_uart->cfg_new.uart_ch);
+                // The second UART is always the other one, release it before swapping
+                usb_uart_aux_stop(usb_uart);
+                usb_uart_serial_deinit(&usb_uart->port[USB_UART_PORT_MAIN]);
+                furi_check(usb_uart_serial_init(
+                    &usb_uart->port[USB_UART_PORT_MAIN], usb_uart->cfg_new.uart_ch));
 
                 usb_uart->cfg.uart_ch = usb_uart->cfg_new.uart_ch;
                 usb_uart_set_baudrate(usb_uart, usb_uart->cfg.baudrate);
+                usb_uart_aux_start(usb_uart);
 
                 furi_thread_start(usb_uart->tx_thread);
+                furi_thread_flags_set(
+                    furi_thread_get_id(usb_uart->tx_thread), WorkerEvtInject | WorkerEvtSend);
+            }
+            if(usb_uart->cfg.aux_baudrate != usb_uart->cfg_new.aux_baudrate) {
+                usb_uart_aux_stop(usb_uart);
+                usb_uart->cfg.aux_baudrate = usb_uart->cfg_new.aux_baudrate;
+                usb_uart_aux_start(usb_uart);
             }
             if(usb_uart->cfg.baudrate != usb_uart->cfg_new.baudrate) {
                 usb_uart_set_baudrate(usb_uart, usb_uart->cfg_new.baudrate);
@@ -301,7 +857,15 @@ static int32_t usb_uart_worker(void* context) {
         }
         if(events & WorkerEvtCtrlLineSet) {
             usb_uart_update_ctrl_lines(usb_uart);
-            usb_uart_print_motd(usb_uart);
+        }
+        if(events & WorkerEvtMotd) {
+            usb_uart_queue_motd(usb_uart);
+            timeout = usb_uart_tx_drain(usb_uart);
+        }
+        // Once the phone went quiet nothing else would wake the worker for the retry
+        if(usb_uart->timeline_pending &&
+           timeout > furi_ms_to_ticks(USB_UART_TIMELINE_RETRY_MS)) {
+            timeout = furi_ms_to_ticks(USB_UART_TIMELINE_RETRY_MS);
         }
     }
 
@@ -314,14 +878,20 @@ static int32_t usb_uart_worker(void* context) {
 
     furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtTxStop);
     furi_thread_join(usb_uart->tx_thread);
-    furi_thread_free(usb_uart->tx_thread);
 
-    usb_uart_vcp_deinit(usb_uart, usb_uart->cfg.vcp_ch);
-    usb_uart_serial_deinit(usb_uart);
+    usb_uart_vcp_deinit(usb_uart, usb_uart->cfg.vcp_ch, usb_uart->cfg.ctrl_split);
+    usb_uart_aux_stop(usb_uart);
+    usb_uart_serial_deinit(&usb_uart->port[USB_UART_PORT_MAIN]);
 
-    furi_stream_buffer_free(usb_uart->rx_stream);
+    for(size_t i = 0; i < USB_UART_PORTS; i++) {
+        furi_stream_buffer_free(usb_uart->port[i].rx_stream);
+    }
+    furi_stream_buffer_free(usb_uart->filtered_stream);
+    furi_stream_buffer_free(usb_uart->chatter_stream);
     furi_mutex_free(usb_uart->usb_mutex);
-    furi_semaphore_free(usb_uart->tx_sem);
+    furi_mutex_free(usb_uart->chatter_mutex);
+    furi_semaphore_free(usb_uart->data_ep.sem);
+    furi_semaphore_free(usb_uart->ctrl_ep.sem);
 
     furi_hal_usb_unlock();
     furi_check(furi_hal_usb_set_config(&usb_cdc_single, NULL) == true);
@@ -332,82 +902,202 @@ static int32_t usb_uart_worker(void* context) {
     return 0;
 }
 
+/* Queues the frame whole or not at all, false if the chatter queue had no room in time. A
+ * frame cut short would swallow the next one on the host. */
+static bool usb_uart_rpc_send(
+    UsbUartBridge* usb_uart,
+    uint8_t seq,
+    uint8_t cmd,
+    uint8_t flags,
+    uint8_t status,
+    const uint8_t* payload,
+    size_t len) {
+    size_t size = yuri_rpc_encode(
+        usb_uart->rpc_frame,
+        sizeof(usb_uart->rpc_frame),
+        seq,
+        cmd,
+        flags | YuriRpcFlagResponse,
+        status,
+        payload,
+        len);
+    if(!size) return false;
+    const uint32_t start = furi_get_tick();
+    while(furi_stream_buffer_spaces_available(usb_uart->chatter_stream) < size) {
+        if(furi_get_tick() - start >= furi_ms_to_ticks(USB_UART_TX_TIMEOUT_MS)) return false;
+        furi_delay_ms(1);
+    }
+    return usb_uart_print(usb_uart, usb_uart->rpc_frame, size) == size;
+}
+
+static void usb_uart_rpc_enter(UsbUartBridge* usb_uart) {
+    usb_uart->rpc_mode = true;
+    yuri_rpc_parser_reset(&usb_uart->rpc_parser);
+    usb_uart_rpc_send(usb_uart, 0, YuriRpcCommandHello, 0, YuriRpcStatusOk, NULL, 0);
+}
+
+static void usb_uart_rpc_process(UsbUartBridge* usb_uart, const uint8_t* data, size_t len) {
+    for(size_t i = 0; i < len && usb_uart->rpc_mode; i++) {
+        if(!yuri_rpc_parser_feed(&usb_uart->rpc_parser, data[i])) continue;
+        const YuriRpcFrame* request = &usb_uart->rpc_parser.frame;
+        switch(request->cmd) {
+        case YuriRpcCommandHello:
+        case YuriRpcCommandPing:
+            usb_uart_rpc_reply(
+                usb_uart, request, 0, YuriRpcStatusOk, request->payload, request->len);
+            break;
+        case YuriRpcCommandExit:
+            usb_uart_rpc_reply(usb_uart, request, 0, YuriRpcStatusOk, NULL, 0);
+            usb_uart->rpc_mode = false;
+            break;
+        default:
+            usb_uart->rpcCallback(usb_uart, request, usb_uart->rpcContext);
+            break;
+        }
+    }
+}
+
+/* Handle command and RPC traffic. Returns false for bytes that are not meant for the bridge,
+ * which on an inline control channel are UART data. */
+static bool usb_uart_control_process(UsbUartBridge* usb_uart, uint8_t* data, size_t len) {
+    if(usb_uart->rpc_mode) {
+        usb_uart_rpc_process(usb_uart, data, len);
+        return true;
+    }
+    if(data[0] != '/' && !usb_uart->is_command) {
+        return false;
+    }
+
+    uint8_t* command_buffer = usb_uart->command_buffer;
+    usb_uart->is_command = true;
+    bool write = false;
+
+    if(data[0] == 0x7f) {
+        if(usb_uart->command_length > 0) {
+            usb_uart->command_length--;
+            command_buffer[usb_uart->command_length] = 0;
+
+            uint8_t backspace[7] = {0x1B, 0x5B, 0x44, 0x1B, 0x5B, 0x31, 0x50};
+            usb_uart_print(usb_uart, backspace, sizeof(backspace));
+        }
+    } else {
+        if(usb_uart->command_length + len < COMMAND_LENGTH) {
+            usb_uart_print(usb_uart, data, len);
+
+            memcpy(command_buffer + usb_uart->command_length, data, len);
+            usb_uart->command_length += len;
+            write = true;
+        }
+    }
+
+    if(data[len - 1] == 0xd) {
+        usb_uart->is_command = false;
+        if(write) {
+            command_buffer[usb_uart->command_length - 1] = 0;
+        }
+        usb_uart->command_length = 0;
+
+        if(usb_uart->rpcCallback && strcmp((char*)command_buffer + 1, "rpc") == 0) {
+            usb_uart_rpc_enter(usb_uart);
+            return true;
+        }
+
+        FuriString* message =
+            usb_uart->commandCallback((char*)command_buffer + 1, usb_uart->commandContext);
+        if(message != NULL) {
+            usb_uart_print(usb_uart, (uint8_t*)"\n\r", 2);
+            usb_uart_print(
+                usb_uart, (uint8_t*)furi_string_get_cstr(message), furi_string_size(message));
+            usb_uart_print(usb_uart, (uint8_t*)"\n\r", 2);
+            furi_string_free(message);
+        }
+    }
+    return true;
+}
+
+static size_t usb_uart_cdc_receive(UsbUartBridge* usb_uart, uint8_t ch, uint8_t* data) {
+    furi_check(furi_mutex_acquire(usb_uart->usb_mutex, FuriWaitForever) == FuriStatusOk);
+    size_t len = furi_hal_cdc_receive(ch, data, USB_CDC_PKT_LEN);
+    furi_check(furi_mutex_release(usb_uart->usb_mutex) == FuriStatusOk);
+    return len;
+}
+
+/* Send on the main UART, holding the RS-485 driver enabled for the whole buffer */
+static void usb_uart_serial_send(UsbUartBridge* usb_uart, const uint8_t* data, size_t len) {
+    if(usb_uart->cfg.software_de_re != 0) furi_hal_gpio_write(USB_USART_DE_RE_PIN, false);
+
+    FuriHalSerialHandle* handle = usb_uart->port[USB_UART_PORT_MAIN].serial_handle;
+    furi_hal_serial_tx(handle, data, len);
+
+    if(usb_uart->cfg.software_de_re != 0) {
+        furi_hal_serial_tx_wait_complete(handle);
+        furi_hal_gpio_write(USB_USART_DE_RE_PIN, true);
+    }
+}
+
+/* Send every chunk the injector handed over, a stopped injection only gets its buffers back */
+static void usb_uart_inject_drain(UsbUartBridge* usb_uart) {
+    UsbUartInject* inject = usb_uart->inject;
+    if(!inject) return;
+    UsbUartInjectChunk chunk;
+    while(furi_message_queue_get(inject->ready, &chunk, 0) == FuriStatusOk) {
+        if(!inject->stop) {
+            usb_uart_serial_send(usb_uart, inject->buf[chunk.idx], chunk.len);
+            usb_uart->st.tx_cnt += chunk.len;
+            inject->sent += chunk.len;
+        }
+        furi_semaphore_release(inject->free_sem);
+    }
+}
+
 static int32_t usb_uart_tx_thread(void* context) {
     UsbUartBridge* usb_uart = (UsbUartBridge*)context;
 
-    bool is_command = false;
-    size_t command_length = 0;
-    uint8_t* command_buffer = malloc(COMMAND_LENGTH);
     uint8_t data[USB_CDC_PKT_LEN];
     while(1) {
         uint32_t events =
             furi_thread_flags_wait(WORKER_ALL_TX_EVENTS, FuriFlagWaitAny, FuriWaitForever);
         furi_check(!(events & FuriFlagError));
         if(events & WorkerEvtTxStop) break;
+        if(events & WorkerEvtCtrlRx) {
+            size_t len =
+                usb_uart_cdc_receive(usb_uart, usb_uart_ctrl_ch(usb_uart->cfg.vcp_ch), data);
+            if(len > 0) {
+                // Anything that is not a command has no destination on the control interface
+                usb_uart_control_process(usb_uart, data, len);
+            }
+        }
         if(events & WorkerEvtCdcRx) {
-            furi_check(furi_mutex_acquire(usb_uart->usb_mutex, FuriWaitForever) == FuriStatusOk);
-            size_t len = furi_hal_cdc_receive(usb_uart->cfg.vcp_ch, data, USB_CDC_PKT_LEN);
-            furi_check(furi_mutex_release(usb_uart->usb_mutex) == FuriStatusOk);
+            size_t len = usb_uart_cdc_receive(usb_uart, usb_uart->cfg.vcp_ch, data);
 
             if(len > 0) {
                 usb_uart->st.tx_cnt += len;
 
-                if(data[0] == '/' || is_command) {
-                    is_command = true;
-                    bool write = false;
-
-                    if(data[0] == 0x7f) {
-                        if(command_length > 0) {
-                            command_length--;
-                            command_buffer[command_length] = 0;
-
-                            uint8_t backspace[7] = {0x1B, 0x5B, 0x44, 0x1B, 0x5B, 0x31, 0x50};
-                            furi_hal_cdc_send(usb_uart->cfg.vcp_ch, backspace, sizeof(backspace));
-                        }
-                    } else {
-                        if(command_length + len < COMMAND_LENGTH) {
-                            furi_hal_cdc_send(usb_uart->cfg.vcp_ch, data, len);
-
-                            memcpy(command_buffer + command_length, data, len);
-                            command_length += len;
-                            write = true;
-                        }
-                    }
-
-                    if(data[len - 1] == 0xd) {
-                        is_command = false;
-                        if(write) {
-                            command_buffer[command_length - 1] = 0;
-                        }
-
-                        FuriString* message = usb_uart->commandCallback(
-                            (char*)command_buffer + 1, usb_uart->commandContext);
-                        if(message != NULL) {
-                            FuriString* new_line = furi_string_alloc_set_str("\n\r");
-                            furi_string_cat(message, new_line);
-                            furi_string_cat(new_line, message);
-
-                            const char* c_message = furi_string_get_cstr(new_line);
-                            furi_hal_cdc_send(
-                                usb_uart->cfg.vcp_ch, (uint8_t*)c_message, strlen(c_message));
-
-                            free((char*)c_message);
-                            furi_string_free(new_line);
-                            furi_string_free(message);
-                        }
-                        command_length = 0;
-                    }
+                if(!usb_uart->cfg.ctrl_split && usb_uart_control_process(usb_uart, data, len)) {
                     continue;
                 }
-                if(usb_uart->cfg.software_de_re != 0)
-                    furi_hal_gpio_write(USB_USART_DE_RE_PIN, false);
 
-                furi_hal_serial_tx(usb_uart->serial_handle, data, len);
-
-                if(usb_uart->cfg.software_de_re != 0) {
-                    furi_hal_serial_tx_wait_complete(usb_uart->serial_handle);
-                    furi_hal_gpio_write(USB_USART_DE_RE_PIN, true);
-                }
+                usb_uart_serial_send(usb_uart, data, len);
+            }
+        }
+        if(events & WorkerEvtInject) {
+            usb_uart_inject_drain(usb_uart);
+        }
+        if(events & WorkerEvtSend) {
+            size_t len;
+            while((len = furi_stream_buffer_receive(usb_uart->send_stream, data, sizeof(data), 0)) >
+                  0) {
+                usb_uart->st.tx_cnt += len;
+                usb_uart_serial_send(usb_uart, data, len);
+            }
+            FURI_CRITICAL_ENTER();
+            const uint8_t* posted = usb_uart->posted_data;
+            len = usb_uart->posted_len;
+            usb_uart->posted_data = NULL;
+            FURI_CRITICAL_EXIT();
+            if(posted) {
+                usb_uart->st.tx_cnt += len;
+                usb_uart_serial_send(usb_uart, posted, len);
             }
         }
     }
@@ -418,7 +1108,7 @@ static int32_t usb_uart_tx_thread(void* context) {
 
 static void vcp_on_cdc_tx_complete(void* context) {
     UsbUartBridge* usb_uart = (UsbUartBridge*)context;
-    furi_semaphore_release(usb_uart->tx_sem);
+    furi_semaphore_release(usb_uart->data_ep.sem);
     furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtCdcTxComplete);
 }
 
@@ -435,7 +1125,9 @@ static void vcp_state_callback(void* context, uint8_t state) {
 static void vcp_on_cdc_control_line(void* context, uint8_t state) {
     UNUSED(state);
     UsbUartBridge* usb_uart = (UsbUartBridge*)context;
-    furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtCtrlLineSet);
+    uint32_t flags = WorkerEvtCtrlLineSet;
+    if(!usb_uart->cfg.ctrl_split) flags |= WorkerEvtMotd;
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), flags);
 }
 
 static void vcp_on_line_config(void* context, struct usb_cdc_line_coding* config) {
@@ -444,12 +1136,205 @@ static void vcp_on_line_config(void* context, struct usb_cdc_line_coding* config
     furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtLineCfgSet);
 }
 
+static void vcp_ctrl_on_cdc_tx_complete(void* context) {
+    UsbUartBridge* usb_uart = (UsbUartBridge*)context;
+    furi_semaphore_release(usb_uart->ctrl_ep.sem);
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtCdcTxComplete);
+}
+
+static void vcp_ctrl_on_cdc_rx(void* context) {
+    UsbUartBridge* usb_uart = (UsbUartBridge*)context;
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtCtrlRx);
+}
+
+static void vcp_ctrl_on_cdc_control_line(void* context, uint8_t state) {
+    UNUSED(state);
+    UsbUartBridge* usb_uart = (UsbUartBridge*)context;
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtMotd);
+}
+
+static void vcp_ctrl_on_line_config(void* context, struct usb_cdc_line_coding* config) {
+    // The UART follows the line coding of the data interface only
+    UNUSED(context);
+    UNUSED(config);
+}
+
+/* SD injection */
+
+/* Take a free buffer, gives up when the injection is stopped */
+static bool usb_uart_inject_take(UsbUartInject* inject) {
+    while(furi_semaphore_acquire(inject->free_sem, furi_ms_to_ticks(USB_UART_INJECT_POLL_MS)) !=
+          FuriStatusOk) {
+        if(inject->stop) return false;
+    }
+    return true;
+}
+
+/* Wait until every queued chunk left the UART, the TX thread always drains the queue */
+static void usb_uart_inject_settle(UsbUartInject* inject) {
+    for(size_t i = 0; i < USB_UART_INJECT_BUFFERS; i++) {
+        furi_check(furi_semaphore_acquire(inject->free_sem, FuriWaitForever) == FuriStatusOk);
+    }
+    for(size_t i = 0; i < USB_UART_INJECT_BUFFERS; i++) {
+        furi_semaphore_release(inject->free_sem);
+    }
+}
+
+static void usb_uart_inject_sleep(UsbUartInject* inject, uint32_t ms) {
+    while(ms && !inject->stop) {
+        const uint32_t step = ms > USB_UART_INJECT_POLL_MS ? USB_UART_INJECT_POLL_MS : ms;
+        furi_delay_ms(step);
+        ms -= step;
+    }
+}
+
+/* Reads the file ahead of the TX thread. A byte rate spreads chunks so the average holds, a
+ * delay is the silence between the end of one chunk and the start of the next. */
+static int32_t usb_uart_inject_thread(void* context) {
+    UsbUartBridge* usb_uart = (UsbUartBridge*)context;
+    UsbUartInject* inject = usb_uart->inject;
+    const UsbUartInjectPacing* pacing = &inject->pacing;
+
+    size_t chunk = sizeof(inject->buf[0]);
+    if(pacing->chunk && pacing->chunk < chunk) chunk = pacing->chunk;
+    // Bursts of at most 50 ms worth keep the rate even at the chunk level too
+    if(pacing->byte_rate && pacing->byte_rate / 20 < chunk) {
+        chunk = pacing->byte_rate < 20 ? 1 : pacing->byte_rate / 20;
+    }
+
+    const uint32_t start = furi_get_tick();
+    uint32_t queued = 0;
+    uint8_t idx = 0;
+    while(!inject->stop) {
+        if(pacing->delay_ms && queued) usb_uart_inject_settle(inject);
+        const uint32_t gap_start = furi_get_tick();
+
+        if(!usb_uart_inject_take(inject)) break;
+        const size_t len = storage_file_read(inject->file, inject->buf[idx], chunk);
+        if(len == 0) {
+            furi_semaphore_release(inject->free_sem);
+            break;
+        }
+
+        if(pacing->delay_ms && queued) {
+            const uint32_t spent = furi_get_tick() - gap_start;
+            if(spent < pacing->delay_ms) usb_uart_inject_sleep(inject, pacing->delay_ms - spent);
+        } else if(pacing->byte_rate) {
+            const uint32_t due = (uint64_t)queued * 1000 / pacing->byte_rate;
+            const uint32_t elapsed = furi_get_tick() - start;
+            if(due > elapsed) usb_uart_inject_sleep(inject, due - elapsed);
+        }
+        if(inject->stop) {
+            furi_semaphore_release(inject->free_sem);
+            break;
+        }
+
+        UsbUartInjectChunk ready = {.idx = idx, .len = len};
+        furi_check(
+            furi_message_queue_put(inject->ready, &ready, FuriWaitForever) == FuriStatusOk);
+        furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtInject);
+        queued += len;
+        idx ^= 1;
+    }
+    usb_uart_inject_settle(inject);
+
+    storage_file_close(inject->file);
+    storage_file_free(inject->file);
+    inject->file = NULL;
+    furi_record_close(RECORD_STORAGE);
+    inject->running = false;
+    return 0;
+}
+
+bool usb_uart_inject_file(
+    UsbUartBridge* usb_uart,
+    const char* path,
+    const UsbUartInjectPacing* pacing) {
+    furi_assert(usb_uart);
+    furi_assert(path);
+    furi_assert(pacing);
+    usb_uart_inject_stop(usb_uart);
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    if(!storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        storage_file_free(file);
+        furi_record_close(RECORD_STORAGE);
+        return false;
+    }
+
+    UsbUartInject* inject = usb_uart->inject;
+    if(!inject) {
+        inject = malloc(sizeof(UsbUartInject));
+        inject->free_sem = furi_semaphore_alloc(USB_UART_INJECT_BUFFERS, USB_UART_INJECT_BUFFERS);
+        inject->ready =
+            furi_message_queue_alloc(USB_UART_INJECT_BUFFERS, sizeof(UsbUartInjectChunk));
+        inject->thread =
+            furi_thread_alloc_ex("UsbUartInject", 1024, usb_uart_inject_thread, usb_uart);
+        usb_uart->inject = inject;
+    }
+    inject->file = file;
+    inject->pacing = *pacing;
+    inject->stop = false;
+    inject->sent = 0;
+    inject->total = storage_file_size(file);
+    inject->running = true;
+    inject->started = true;
+    // The storage record stays open until the injector closes the file
+    furi_thread_start(inject->thread);
+    return true;
+}
+
+void usb_uart_inject_stop(UsbUartBridge* usb_uart) {
+    furi_assert(usb_uart);
+    UsbUartInject* inject = usb_uart->inject;
+    if(!inject || !inject->started) return;
+    inject->stop = true;
+    furi_thread_join(inject->thread);
+    inject->started = false;
+}
+
+bool usb_uart_inject_progress(UsbUartBridge* usb_uart, uint32_t* sent, uint32_t* total) {
+    furi_assert(usb_uart);
+    UsbUartInject* inject = usb_uart->inject;
+    if(!inject) return false;
+    if(sent) *sent = inject->sent;
+    if(total) *total = inject->total;
+    return inject->running;
+}
+
+static void usb_uart_inject_free(UsbUartBridge* usb_uart) {
+    UsbUartInject* inject = usb_uart->inject;
+    if(!inject) return;
+    furi_thread_free(inject->thread);
+    furi_message_queue_free(inject->ready);
+    furi_semaphore_free(inject->free_sem);
+    free(inject);
+    usb_uart->inject = NULL;
+}
+
 UsbUartBridge* usb_uart_enable(UsbUartConfig* cfg) {
     UsbUartBridge* usb_uart = malloc(sizeof(UsbUartBridge));
 
     memcpy(&(usb_uart->cfg_new), cfg, sizeof(UsbUartConfig));
 
-    usb_uart->thread = furi_thread_alloc_ex("UsbUartWorker", 1024, usb_uart_worker, usb_uart);
+    for(uint8_t i = 0; i < USB_UART_PORTS; i++) {
+        usb_uart->port[i].bridge = usb_uart;
+        usb_uart->port[i].id = i;
+    }
+    usb_uart->port[USB_UART_PORT_MAIN].log = log_saver_alloc("iBoot_log");
+    usb_uart->port[USB_UART_PORT_AUX].log = log_saver_alloc("uart2_log");
+    line_filter_init(&usb_uart->filter);
+    usb_uart->filter_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    memset(&usb_uart->timeline_last, 0, sizeof(BootTimelineSession));
+    usb_uart->timeline_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    // Here rather than in the worker, a queued write may come right after enable returns
+    usb_uart->send_stream = furi_stream_buffer_alloc(USB_UART_SEND_BUF_SIZE, 1);
+    usb_uart->send_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    usb_uart->posted_data = NULL;
+    usb_uart->tx_thread =
+        furi_thread_alloc_ex("UsbUartTxWorker", 1536, usb_uart_tx_thread, usb_uart);
+    usb_uart->thread = furi_thread_alloc_ex("UsbUartWorker", 1536, usb_uart_worker, usb_uart);
 
     furi_thread_start(usb_uart->thread);
     return usb_uart;
@@ -457,9 +1342,20 @@ UsbUartBridge* usb_uart_enable(UsbUartConfig* cfg) {
 
 void usb_uart_disable(UsbUartBridge* usb_uart) {
     furi_assert(usb_uart);
+    // The injector needs the TX thread to hand its buffers back
+    usb_uart_inject_stop(usb_uart);
     furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtStop);
     furi_thread_join(usb_uart->thread);
     furi_thread_free(usb_uart->thread);
+    furi_thread_free(usb_uart->tx_thread);
+    usb_uart_inject_free(usb_uart);
+    furi_mutex_free(usb_uart->filter_mutex);
+    furi_mutex_free(usb_uart->timeline_mutex);
+    furi_stream_buffer_free(usb_uart->send_stream);
+    furi_mutex_free(usb_uart->send_mutex);
+    for(size_t i = 0; i < USB_UART_PORTS; i++) {
+        log_saver_free(usb_uart->port[i].log);
+    }
     free(usb_uart);
 }
 
@@ -483,6 +1379,36 @@ void usb_uart_set_command_callback(
     usb_uart->commandContext = context;
 }
 
+void usb_uart_set_rpc_callback(UsbUartBridge* usb_uart, UsbUartBridgeRpc callback, void* context) {
+    furi_assert(usb_uart);
+    furi_assert(callback);
+    usb_uart->rpcCallback = callback;
+    usb_uart->rpcContext = context;
+}
+
+void usb_uart_set_rx_callback(UsbUartBridge* usb_uart, UsbUartBridgeRx callback, void* context) {
+    furi_assert(usb_uart);
+    usb_uart->rxCallback = callback;
+    usb_uart->rxContext = context;
+}
+
+bool usb_uart_rpc_reply(
+    UsbUartBridge* usb_uart,
+    const YuriRpcFrame* request,
+    uint8_t flags,
+    uint8_t status,
+    const uint8_t* payload,
+    size_t len) {
+    furi_assert(usb_uart);
+    furi_assert(request);
+    if(usb_uart_rpc_send(usb_uart, request->seq, request->cmd, flags, status, payload, len)) {
+        return true;
+    }
+    // Ends the request for the host instead of leaving it to its timeout
+    usb_uart_rpc_send(usb_uart, request->seq, request->cmd, 0, YuriRpcStatusError, NULL, 0);
+    return false;
+}
+
 void usb_uart_get_config(UsbUartBridge* usb_uart, UsbUartConfig* cfg) {
     furi_assert(usb_uart);
     furi_assert(cfg);
@@ -493,8 +1419,150 @@ void usb_uart_get_state(UsbUartBridge* usb_uart, UsbUartState* st) {
     furi_assert(usb_uart);
     furi_assert(st);
     memcpy(st, &(usb_uart->st), sizeof(UsbUartState));
+    const UsbUartPort* main = &usb_uart->port[USB_UART_PORT_MAIN];
+    const UsbUartPort* aux = &usb_uart->port[USB_UART_PORT_AUX];
+    st->rx_cnt = main->rx_cnt;
+    st->rx_dropped = main->rx_dropped;
+    st->baudrate_cur = main->baudrate_cur;
+    st->aux_rx_cnt = aux->rx_cnt;
+    st->aux_rx_dropped = aux->rx_dropped;
+    st->aux_baudrate_cur = aux->baudrate_cur;
+}
+
+void usb_uart_reset_state(UsbUartBridge* usb_uart) {
+    furi_assert(usb_uart);
+    for(size_t i = 0; i < USB_UART_PORTS; i++) {
+        usb_uart->port[i].rx_cnt = 0;
+        usb_uart->port[i].rx_dropped = 0;
+    }
+    usb_uart->st.tx_cnt = 0;
+    usb_uart->st.cdc_packets = 0;
+    usb_uart->st.busy_cycles = 0;
+    memset(usb_uart->st.latency_hist, 0, sizeof(usb_uart->st.latency_hist));
+}
+
+uint32_t usb_uart_state_latency_percentile(const UsbUartState* st, uint8_t percent) {
+    furi_assert(st);
+    uint64_t total = 0;
+    for(size_t i = 0; i < USB_UART_LATENCY_BUCKETS; i++) {
+        total += st->latency_hist[i];
+    }
+    if(total == 0) return 0;
+    const uint64_t rank = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < USB_UART_LATENCY_BUCKETS; i++) {
+        seen += st->latency_hist[i];
+        if(seen >= rank) return 1UL << i;
+    }
+    return 1UL << (USB_UART_LATENCY_BUCKETS - 1);
+}
+
+size_t usb_uart_print(UsbUartBridge* usb_uart, const uint8_t* data, size_t len) {
+    furi_assert(usb_uart);
+    furi_check(furi_mutex_acquire(usb_uart->chatter_mutex, FuriWaitForever) == FuriStatusOk);
+    size_t queued = 0;
+    while(queued < len) {
+        size_t sent = furi_stream_buffer_send(
+            usb_uart->chatter_stream,
+            data + queued,
+            len - queued,
+            furi_ms_to_ticks(USB_UART_TX_TIMEOUT_MS));
+        furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtChatter);
+        if(sent == 0) break;
+        queued += sent;
+    }
+    furi_check(furi_mutex_release(usb_uart->chatter_mutex) == FuriStatusOk);
+    return queued;
+}
+
+void usb_uart_mark_reset(UsbUartBridge* usb_uart) {
+    furi_assert(usb_uart);
+    usb_uart->reset_tick = furi_get_tick();
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtSdqReset);
+}
+
+bool usb_uart_get_timeline(UsbUartBridge* usb_uart, char* out, size_t size) {
+    furi_assert(usb_uart);
+    BootTimelineSession last;
+    furi_check(furi_mutex_acquire(usb_uart->timeline_mutex, FuriWaitForever) == FuriStatusOk);
+    memcpy(&last, &usb_uart->timeline_last, sizeof(BootTimelineSession));
+    furi_check(furi_mutex_release(usb_uart->timeline_mutex) == FuriStatusOk);
+    if(last.seen == 0) return false;
+    boot_timeline_format(&last, out, size);
+    return true;
+}
+
+bool usb_uart_filter_add(UsbUartBridge* usb_uart, const char* pattern, bool exclude) {
+    furi_assert(usb_uart);
+    furi_check(furi_mutex_acquire(usb_uart->filter_mutex, FuriWaitForever) == FuriStatusOk);
+    bool added = line_filter_add(&usb_uart->filter, pattern, exclude);
+    usb_uart->filter_on = line_filter_active(&usb_uart->filter);
+    furi_check(furi_mutex_release(usb_uart->filter_mutex) == FuriStatusOk);
+    return added;
 }
 
-void usb_uart_send_data(UsbUartBridge* usb_uart, uint8_t* data, size_t data_size) {
-    furi_hal_serial_tx(usb_uart->serial_handle, data, data_size);
+void usb_uart_filter_set_rate(UsbUartBridge* usb_uart, uint32_t lines_per_s) {
+    furi_assert(usb_uart);
+    furi_check(furi_mutex_acquire(usb_uart->filter_mutex, FuriWaitForever) == FuriStatusOk);
+    line_filter_set_rate(&usb_uart->filter, lines_per_s);
+    usb_uart->filter_on = line_filter_active(&usb_uart->filter);
+    furi_check(furi_mutex_release(usb_uart->filter_mutex) == FuriStatusOk);
+}
+
+void usb_uart_filter_clear(UsbUartBridge* usb_uart) {
+    furi_assert(usb_uart);
+    furi_check(furi_mutex_acquire(usb_uart->filter_mutex, FuriWaitForever) == FuriStatusOk);
+    // Settle the line in progress under the old rules, the bypass would never release it
+    line_filter_poll(
+        &usb_uart->filter, furi_get_tick(), 0, usb_uart_filter_output, usb_uart);
+    line_filter_clear(&usb_uart->filter);
+    usb_uart->filter_on = false;
+    furi_check(furi_mutex_release(usb_uart->filter_mutex) == FuriStatusOk);
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->thread), WorkerEvtRxDone);
+}
+
+size_t usb_uart_filter_describe(UsbUartBridge* usb_uart, char* out, size_t size) {
+    furi_assert(usb_uart);
+    furi_check(furi_mutex_acquire(usb_uart->filter_mutex, FuriWaitForever) == FuriStatusOk);
+    size_t len = line_filter_describe(&usb_uart->filter, out, size);
+    furi_check(furi_mutex_release(usb_uart->filter_mutex) == FuriStatusOk);
+    return len;
+}
+
+size_t usb_uart_log_read(
+    UsbUartBridge* usb_uart,
+    uint8_t port,
+    size_t offset,
+    char* out,
+    size_t len) {
+    furi_assert(usb_uart);
+    furi_assert(port < USB_UART_PORTS);
+    return log_saver_read(usb_uart->port[port].log, offset, out, len);
+}
+
+void usb_uart_post_data(UsbUartBridge* usb_uart, const uint8_t* data, size_t len) {
+    furi_assert(usb_uart);
+    FURI_CRITICAL_ENTER();
+    usb_uart->posted_data = data;
+    usb_uart->posted_len = len;
+    FURI_CRITICAL_EXIT();
+    furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtSend);
+}
+
+size_t usb_uart_queue_data(UsbUartBridge* usb_uart, const uint8_t* data, size_t len) {
+    furi_assert(usb_uart);
+    furi_check(furi_mutex_acquire(usb_uart->send_mutex, FuriWaitForever) == FuriStatusOk);
+    size_t queued = 0;
+    while(queued < len) {
+        size_t sent = furi_stream_buffer_send(
+            usb_uart->send_stream,
+            data + queued,
+            len - queued,
+            furi_ms_to_ticks(USB_UART_TX_TIMEOUT_MS));
+        furi_thread_flags_set(furi_thread_get_id(usb_uart->tx_thread), WorkerEvtSend);
+        if(sent == 0) break;
+        queued += sent;
+    }
+    furi_check(furi_mutex_release(usb_uart->send_mutex) == FuriStatusOk);
+    return queued;
 }
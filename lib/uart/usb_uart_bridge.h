@@ -2,8 +2,20 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <lib/rpc/yuri_rpc.h>
+#include <lib/timeline/boot_timeline.h>
 
-#define COMMAND_LENGTH 16
+#define COMMAND_LENGTH 64
+
+#define USB_UART_LATENCY_BUCKETS 20
+
+/* With both UARTs running every packet on the data interface is a frame
+ *   SOF | tag | len | payload[len]
+ * tag 0 is the main UART, 1 the second one and USB_UART_MUX_TAG_BRIDGE command replies and
+ * other bridge output that shares the interface. A frame never spans two USB packets. */
+#define USB_UART_MUX_SOF         0xA6
+#define USB_UART_MUX_HEADER_SIZE 3
+#define USB_UART_MUX_TAG_BRIDGE  0xFF
 
 typedef struct UsbUartBridge UsbUartBridge;
 
@@ -14,16 +26,32 @@ typedef struct {
     uint8_t baudrate_mode;
     uint32_t baudrate;
     uint8_t software_de_re;
+    // Raw UART on vcp_ch, commands and telemetry on the other interface of the dual config
+    uint8_t ctrl_split;
+    // Capture the other UART (LPUART when uart_ch is USART and vice versa) too, 0 is off
+    uint32_t aux_baudrate;
 } UsbUartConfig;
 
 typedef struct {
     uint32_t rx_cnt;
     uint32_t tx_cnt;
     uint32_t baudrate_cur;
+    uint32_t rx_dropped;
+    uint32_t cdc_packets;
+    uint64_t busy_cycles;
+    // Bucket n counts UART to CDC forwarding latencies in [2^(n-1), 2^n) us
+    uint32_t latency_hist[USB_UART_LATENCY_BUCKETS];
+    uint32_t aux_rx_cnt;
+    uint32_t aux_baudrate_cur;
+    uint32_t aux_rx_dropped;
 } UsbUartState;
 
 typedef FuriString* (*UsbUartBridgeCommand)(char* command, void* context);
 
+typedef void (*UsbUartBridgeRpc)(UsbUartBridge* usb_uart, const YuriRpcFrame* request, void* context);
+
+typedef void (*UsbUartBridgeRx)(const uint8_t* data, size_t len, void* context);
+
 UsbUartBridge* usb_uart_enable(UsbUartConfig* cfg);
 
 void usb_uart_disable(UsbUartBridge* usb_uart);
@@ -35,8 +63,82 @@ void usb_uart_set_command_callback(
     UsbUartBridgeCommand callback,
     void* context);
 
+void usb_uart_set_rpc_callback(UsbUartBridge* usb_uart, UsbUartBridgeRpc callback, void* context);
+
+/* Sees every byte received on the main UART ahead of the line filter, called from the bridge
+ * worker. Set it before data flows, the callback has to stay valid until the bridge is off. */
+void usb_uart_set_rx_callback(UsbUartBridge* usb_uart, UsbUartBridgeRx callback, void* context);
+
+/* Answer an RPC request, call repeatedly with YuriRpcFlagMore to stream a response. A frame
+ * the CDC port has no room for is not sent, an error status ends the request instead and this
+ * returns false, a streaming handler stops there. */
+bool usb_uart_rpc_reply(
+    UsbUartBridge* usb_uart,
+    const YuriRpcFrame* request,
+    uint8_t flags,
+    uint8_t status,
+    const uint8_t* payload,
+    size_t len);
+
 void usb_uart_get_config(UsbUartBridge* usb_uart, UsbUartConfig* cfg);
 
 void usb_uart_get_state(UsbUartBridge* usb_uart, UsbUartState* st);
 
-void usb_uart_send_data(UsbUartBridge* usb_uart, uint8_t* data, size_t data_size);
\ No newline at end of file
+void usb_uart_reset_state(UsbUartBridge* usb_uart);
+
+uint32_t usb_uart_state_latency_percentile(const UsbUartState* st, uint8_t percent);
+
+/* Start a boot timeline session, call right after the reset went out over SDQ */
+void usb_uart_mark_reset(UsbUartBridge* usb_uart);
+
+/* Report of the last finished boot, false if there was none yet */
+bool usb_uart_get_timeline(UsbUartBridge* usb_uart, char* out, size_t size);
+
+/* Line filter in front of CDC and the SD log. Include patterns (any must match), exclude
+ * patterns (none may match) and a lines per second limit, see lib/line_filter. */
+bool usb_uart_filter_add(UsbUartBridge* usb_uart, const char* pattern, bool exclude);
+
+void usb_uart_filter_set_rate(UsbUartBridge* usb_uart, uint32_t lines_per_s);
+
+void usb_uart_filter_clear(UsbUartBridge* usb_uart);
+
+size_t usb_uart_filter_describe(UsbUartBridge* usb_uart, char* out, size_t size);
+
+/* Queue bridge output for the CDC port, it is interleaved with forwarded UART data. Returns
+ * how much was queued, less than len when the port stayed busy for too long. */
+size_t usb_uart_print(UsbUartBridge* usb_uart, const uint8_t* data, size_t len);
+
+/* Read back the log session of a UART, 0 main and 1 the second one */
+size_t usb_uart_log_read(
+    UsbUartBridge* usb_uart,
+    uint8_t port,
+    size_t offset,
+    char* out,
+    size_t len);
+
+/* Queue bytes for the main UART from any thread but the bridge ones, the TX thread sends them
+ * between forwarded CDC data with the RS-485 driver handled. Returns how many were queued
+ * before the queue stayed full for too long. */
+size_t usb_uart_queue_data(UsbUartBridge* usb_uart, const uint8_t* data, size_t len);
+
+/* Same for interrupt context: hands the TX thread a buffer that stays valid, it goes out after
+ * whatever is queued. Never blocks, a newer post replaces one not sent yet. */
+void usb_uart_post_data(UsbUartBridge* usb_uart, const uint8_t* data, size_t len);
+
+typedef struct {
+    uint16_t chunk; // bytes per SD read, 0 for the largest buffer
+    uint16_t delay_ms; // silence on the wire between chunks
+    uint32_t byte_rate; // average bytes per second, 0 for as fast as the UART goes
+} UsbUartInjectPacing;
+
+/* Stream a file to the main UART next to the forwarded CDC data, RAM use does not depend on the
+ * file size. A running injection is stopped first. Must not be called from bridge threads. */
+bool usb_uart_inject_file(
+    UsbUartBridge* usb_uart,
+    const char* path,
+    const UsbUartInjectPacing* pacing);
+
+void usb_uart_inject_stop(UsbUartBridge* usb_uart);
+
+/* Bytes sent of the last injection, true while it is still running */
+bool usb_uart_inject_progress(UsbUartBridge* usb_uart, uint32_t* sent, uint32_t* total);
\ No newline at end of file
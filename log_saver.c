@@ -2,14 +2,29 @@
 #include <furi_hal.h>
 #include <locale/locale.h>
 #include <storage/storage.h>
+#include <log_saver.h>
 
 #define TAG "YuriStorage"
 #define STORAGE_FILE_BUF_LEN 5
 #define END_MARKER "======== End of iBoot serial output. ========"
 #define MAX_BUFFER_SIZE 10000
 
-char aggregate_buffer[MAX_BUFFER_SIZE];
-size_t aggregate_buffer_len = 0;
+struct LogSaver {
+    const char* prefix;
+    size_t aggregate_buffer_len;
+    // Kept NUL terminated for the end marker search
+    char aggregate_buffer[MAX_BUFFER_SIZE + 1];
+};
+
+LogSaver* log_saver_alloc(const char* prefix) {
+    LogSaver* saver = malloc(sizeof(LogSaver));
+    saver->prefix = prefix;
+    return saver;
+}
+
+void log_saver_free(LogSaver* saver) {
+    free(saver);
+}
 
 static bool storage_printf(File* file, const char* format, ...) {
     va_list args;
@@ -35,19 +50,20 @@ static bool storage_write_file(File* file, const char* str, size_t str_len) {
     return result;
 }
 
-void save_log_and_write(char* str, size_t len) {
-    if(aggregate_buffer_len + len > MAX_BUFFER_SIZE) {
-        aggregate_buffer_len = 0;
+void log_saver_write(LogSaver* saver, const char* str, size_t len) {
+    if(saver->aggregate_buffer_len + len > MAX_BUFFER_SIZE) {
+        saver->aggregate_buffer_len = 0;
     }
-    memcpy(aggregate_buffer + aggregate_buffer_len, str, len);
-    aggregate_buffer_len += len;
-    if(strstr(aggregate_buffer, END_MARKER) != NULL) {
+    memcpy(saver->aggregate_buffer + saver->aggregate_buffer_len, str, len);
+    saver->aggregate_buffer_len += len;
+    saver->aggregate_buffer[saver->aggregate_buffer_len] = 0;
+    if(strstr(saver->aggregate_buffer, END_MARKER) != NULL) {
         Storage* storage = furi_record_open(RECORD_STORAGE);
         File* file = storage_file_alloc(storage);
         DateTime currentDate;
         furi_hal_rtc_get_datetime(&currentDate);
         char dateTimeStr[64];
-        snprintf(dateTimeStr, sizeof(dateTimeStr), "iBoot_log_%04u%02u%02u%02u%02u.txt", currentDate.year, currentDate.month, currentDate.day, currentDate.hour, currentDate.minute);
+        snprintf(dateTimeStr, sizeof(dateTimeStr), "%s_%04u%02u%02u%02u%02u.txt", saver->prefix, currentDate.year, currentDate.month, currentDate.day, currentDate.hour, currentDate.minute);
         char fullPath[128];
         snprintf(fullPath, sizeof(fullPath), "%s/%s", STORAGE_APP_DATA_PATH_PREFIX, dateTimeStr);
         
@@ -58,13 +74,95 @@ void save_log_and_write(char* str, size_t len) {
             return;
         }
 
-        if(!storage_write_file(file, aggregate_buffer, aggregate_buffer_len)) {
+        if(!storage_write_file(file, saver->aggregate_buffer, saver->aggregate_buffer_len)) {
             FURI_LOG_E(TAG, "Failed to write log to file");
         }
 
         storage_file_close(file);
         storage_file_free(file);
         furi_record_close(RECORD_STORAGE);
-        aggregate_buffer_len = 0;
+        saver->aggregate_buffer_len = 0;
+    }
+}
+
+size_t log_saver_read(LogSaver* saver, size_t offset, char* out, size_t len) {
+    if(offset >= saver->aggregate_buffer_len) {
+        return 0;
+    }
+    if(len > saver->aggregate_buffer_len - offset) {
+        len = saver->aggregate_buffer_len - offset;
+    }
+    memcpy(out, saver->aggregate_buffer + offset, len);
+    return len;
+}
+
+bool log_saver_append_record(const char* name, const char* header, const char* record) {
+    DateTime currentDate;
+    furi_hal_rtc_get_datetime(&currentDate);
+    // Assembled up front so the record lands on the card with a single write
+    char line[192];
+    int len = snprintf(line, sizeof(line), "%04u-%02u-%02u %02u:%02u:%02u,%s\n", currentDate.year, currentDate.month, currentDate.day, currentDate.hour, currentDate.minute, currentDate.second, record);
+    if(len < 0 || (size_t)len >= sizeof(line)) {
+        return false;
+    }
+    char fullPath[128];
+    snprintf(fullPath, sizeof(fullPath), "%s/%s", STORAGE_APP_DATA_PATH_PREFIX, name);
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool result = false;
+    if(storage_file_open(file, fullPath, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        result = true;
+        if(storage_file_size(file) == 0) {
+            result = storage_printf(file, "%s", header);
+        }
+        result = result && storage_file_write(file, line, len) == (size_t)len;
+        if(!result) {
+            FURI_LOG_E(TAG, "Failed to append to %s", name);
+        }
+    } else {
+        FURI_LOG_E(TAG, "Failed to open %s", name);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return result;
+}
+
+bool log_saver_append_records(
+    const char* name,
+    const char* header,
+    LogSaverNextRecord next,
+    void* context) {
+    DateTime currentDate;
+    furi_hal_rtc_get_datetime(&currentDate);
+    char line[192];
+    const int date_len = snprintf(line, sizeof(line), "%04u-%02u-%02u %02u:%02u:%02u,", currentDate.year, currentDate.month, currentDate.day, currentDate.hour, currentDate.minute, currentDate.second);
+    char fullPath[128];
+    snprintf(fullPath, sizeof(fullPath), "%s/%s", STORAGE_APP_DATA_PATH_PREFIX, name);
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool result = false;
+    if(storage_file_open(file, fullPath, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        result = true;
+        if(storage_file_size(file) == 0) {
+            result = storage_printf(file, "%s", header);
+        }
+        size_t len;
+        // Room for the newline after the record
+        while(result && (len = next(line + date_len, sizeof(line) - date_len - 1, context)) > 0) {
+            line[date_len + len] = '\n';
+            result = storage_file_write(file, line, date_len + len + 1) == date_len + len + 1;
+        }
+        if(!result) {
+            FURI_LOG_E(TAG, "Failed to append to %s", name);
+        }
+    } else {
+        FURI_LOG_E(TAG, "Failed to open %s", name);
     }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return result;
 }
@@ -5,10 +5,29 @@
 extern "C" {
 #endif
 
-bool storage_printf(File* file, const char* format, ...);
-bool storage_write_file(File* file, const char* str, size_t str_len);
-void save_log_and_write(char* str, size_t len);
+typedef struct LogSaver LogSaver;
+
+/* One log session, written to <app data>/<prefix>_<date>.txt when the iBoot end marker shows up */
+LogSaver* log_saver_alloc(const char* prefix);
+void log_saver_free(LogSaver* saver);
+
+void log_saver_write(LogSaver* saver, const char* str, size_t len);
+size_t log_saver_read(LogSaver* saver, size_t offset, char* out, size_t len);
+
+/* Append "<date>,<record>" as one line to <app data>/<name>, a new file starts with the header */
+bool log_saver_append_record(const char* name, const char* header, const char* record);
+
+/* Fills out with the next record, 0 when there is none left */
+typedef size_t (*LogSaverNextRecord)(char* out, size_t size, void* context);
+
+/* Like log_saver_append_record for as many records as next hands out, the file is opened once
+ * and every line gets the same date */
+bool log_saver_append_records(
+    const char* name,
+    const char* header,
+    LogSaverNextRecord next,
+    void* context);
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,402 @@
+/* Throughput and latency benchmark for the USB UART bridge.
+ *
+ * Runs lib/uart/usb_uart_bridge.c unmodified on the host against the Furi stand-in in
+ * tools/host: a generator thread plays the UART DMA at a configurable baud rate and a USB host
+ * thread acknowledges CDC packets with a fixed per-packet service time. The figures come from
+ * the same UsbUartState counters that `/stats` reports on the Flipper.
+ *
+ * Build:
+ *   gcc -O2 -pthread -Itools/host/include -I. tools/host/host_furi.c \
+ *       tools/bridge_bench/bridge_bench.c -o bridge_bench
+ * Run:
+ *   ./bridge_bench -b 115200,921600,3000000 -d 3 [-f capture.log] [-u 60] [-c 128] [-a]
+ *
+ * -a feeds the same traffic into both UARTs and checks the demultiplexed CDC frames.
+ * -i streams a file through usb_uart_inject_file instead and checks what reaches the UART,
+ *    -r paces it in bytes per second.
+ */
+#include <furi.h>
+#include <host_sim.h>
+#include "../../lib/crc/crc.c"
+#include "../../lib/uart/usb_uart_bridge.c"
+
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+typedef struct {
+    uint32_t baudrate;
+    uint32_t duration_ms;
+    uint32_t usb_packet_us;
+    size_t chunk;
+    const uint8_t* replay;
+    size_t replay_size;
+    bool dual;
+    const char* inject;
+    uint32_t inject_rate;
+} BenchConfig;
+
+typedef struct {
+    const BenchConfig* cfg;
+    volatile bool running;
+    uint64_t generated;
+    uint64_t received[USB_UART_PORTS];
+    // Generator offset of the next byte each port should deliver, drops move it ahead
+    uint64_t offset[USB_UART_PORTS];
+    uint64_t resyncs;
+    uint64_t mismatched;
+    uint64_t log_bytes;
+    FuriMessageQueue* usb_queue;
+    pthread_t usb_thread;
+} Bench;
+
+typedef struct {
+    uint8_t data[CDC_DATA_SZ];
+    uint16_t len;
+} BenchPacket;
+
+static Bench* bench_current;
+
+// Bytes that have to match after a gap before the check trusts it as a resync
+#define BENCH_RESYNC_MATCH 8
+
+struct LogSaver {
+    uint8_t unused;
+};
+
+LogSaver* log_saver_alloc(const char* prefix) {
+    UNUSED(prefix);
+    return malloc(sizeof(LogSaver));
+}
+
+void log_saver_free(LogSaver* saver) {
+    free(saver);
+}
+
+void log_saver_write(LogSaver* saver, const char* str, size_t len) {
+    UNUSED(saver);
+    UNUSED(str);
+    bench_current->log_bytes += len;
+}
+
+size_t log_saver_read(LogSaver* saver, size_t offset, char* out, size_t len) {
+    UNUSED(saver);
+    UNUSED(offset);
+    UNUSED(out);
+    UNUSED(len);
+    return 0;
+}
+
+static uint64_t bench_now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint8_t bench_byte_at(const Bench* bench, uint64_t offset) {
+    if(bench->cfg->replay) {
+        return bench->cfg->replay[offset % bench->cfg->replay_size];
+    }
+    // Hashed, a few bytes after a drop have to tell where the stream went on
+    uint32_t x = (uint32_t)offset * 2654435761u;
+    x ^= x >> 15;
+    x *= 2246822519u;
+    x ^= x >> 13;
+    return (uint8_t)(x >> 24);
+}
+
+static void bench_cdc_tx(uint8_t if_num, const uint8_t* data, size_t size, void* ctx) {
+    Bench* bench = ctx;
+    if(if_num != 1) return;
+    BenchPacket packet = {.len = (uint16_t)size};
+    memcpy(packet.data, data, size);
+    furi_check(furi_message_queue_put(bench->usb_queue, &packet, FuriWaitForever) == FuriStatusOk);
+}
+
+/* First skip past `offset` where `data` continues the generated stream, 0 if there is none.
+ * The bridge only ever drops bytes, so nothing before `offset` needs looking at. */
+static uint64_t bench_resync(const Bench* bench, const uint8_t* data, size_t len, uint64_t offset) {
+    // The generator injects a chunk before it counts it
+    const uint64_t end = bench->generated + bench->cfg->chunk;
+    for(uint64_t skip = 1; offset + skip + len <= end; skip++) {
+        size_t i = 0;
+        while(i < len && data[i] == bench_byte_at(bench, offset + skip + i)) i++;
+        if(i == len) return skip;
+    }
+    return 0;
+}
+
+/* Follows the generated stream across drops, which /stats already counts, so only bytes that
+ * match nowhere ahead count as corrupted. One mismatch per packet at most. */
+static void bench_check(Bench* bench, uint8_t port, const uint8_t* data, size_t len) {
+    uint64_t offset = bench->offset[port];
+    bool corrupted = false;
+    for(size_t i = 0; i < len; i++, offset++) {
+        if(data[i] == bench_byte_at(bench, offset)) continue;
+        const size_t match = len - i < BENCH_RESYNC_MATCH ? len - i : BENCH_RESYNC_MATCH;
+        const uint64_t skip = bench_resync(bench, data + i, match, offset);
+        if(skip) {
+            offset += skip;
+            bench->resyncs++;
+        } else {
+            corrupted = true;
+        }
+    }
+    if(corrupted) bench->mismatched++;
+    bench->offset[port] = offset;
+    bench->received[port] += len;
+}
+
+static void* bench_usb_host(void* ctx) {
+    Bench* bench = ctx;
+    BenchPacket packet;
+    while(furi_message_queue_get(bench->usb_queue, &packet, FuriWaitForever) == FuriStatusOk) {
+        if(packet.len == 0) break;
+        if(!bench->cfg->dual) {
+            bench_check(bench, USB_UART_PORT_MAIN, packet.data, packet.len);
+        } else if(
+            packet.len < USB_UART_MUX_HEADER_SIZE || packet.data[0] != USB_UART_MUX_SOF ||
+            packet.data[2] != packet.len - USB_UART_MUX_HEADER_SIZE) {
+            bench->mismatched++;
+        } else if(packet.data[1] < USB_UART_PORTS) {
+            bench_check(
+                bench,
+                packet.data[1],
+                packet.data + USB_UART_MUX_HEADER_SIZE,
+                packet.len - USB_UART_MUX_HEADER_SIZE);
+        }
+        if(bench->cfg->usb_packet_us) furi_delay_us(bench->cfg->usb_packet_us);
+        host_cdc_tx_complete(1);
+    }
+    return NULL;
+}
+
+static void bench_generate(Bench* bench) {
+    const BenchConfig* cfg = bench->cfg;
+    const double bytes_per_ns = (double)cfg->baudrate / 10.0 / 1e9;
+    uint8_t chunk[FURI_HAL_SERIAL_DMA_BUFFER_SIZE];
+    const uint64_t start = bench_now_ns(CLOCK_MONOTONIC);
+    const uint64_t end = start + (uint64_t)cfg->duration_ms * 1000000ULL;
+    while(1) {
+        uint64_t now = bench_now_ns(CLOCK_MONOTONIC);
+        if(now >= end) break;
+        uint64_t due = (uint64_t)((double)(now - start) * bytes_per_ns);
+        if(due < bench->generated + cfg->chunk) {
+            uint64_t wait_ns = (uint64_t)((double)(bench->generated + cfg->chunk - due) /
+                                          bytes_per_ns);
+            furi_delay_us((uint32_t)(wait_ns / 1000) + 1);
+            continue;
+        }
+        while(bench->generated + cfg->chunk <= due) {
+            for(size_t i = 0; i < cfg->chunk; i++) {
+                chunk[i] = bench_byte_at(bench, bench->generated + i);
+            }
+            host_serial_inject(FuriHalSerialIdUsart, chunk, cfg->chunk);
+            if(cfg->dual) host_serial_inject(FuriHalSerialIdLpuart, chunk, cfg->chunk);
+            bench->generated += cfg->chunk;
+        }
+    }
+}
+
+static void bench_run(const BenchConfig* cfg) {
+    Bench bench = {.cfg = cfg};
+    bench_current = &bench;
+    bench.usb_queue = furi_message_queue_alloc(32, sizeof(BenchPacket));
+    host_cdc_set_tx_hook(bench_cdc_tx, &bench);
+    pthread_create(&bench.usb_thread, NULL, bench_usb_host, &bench);
+
+    UsbUartConfig bridge_cfg = {
+        .vcp_ch = 1,
+        .uart_ch = FuriHalSerialIdUsart,
+        .baudrate = cfg->baudrate,
+        .aux_baudrate = cfg->dual ? cfg->baudrate : 0};
+    UsbUartBridge* bridge = usb_uart_enable(&bridge_cfg);
+    furi_delay_ms(50);
+
+    const uint64_t cpu_start = bench_now_ns(CLOCK_PROCESS_CPUTIME_ID);
+    const uint64_t wall_start = bench_now_ns(CLOCK_MONOTONIC);
+    bench_generate(&bench);
+    // Let the bridge flush what is still buffered
+    UsbUartState st;
+    uint32_t last = UINT32_MAX;
+    while(1) {
+        furi_delay_ms(20);
+        usb_uart_get_state(bridge, &st);
+        if(st.rx_cnt + st.aux_rx_cnt == last) break;
+        last = st.rx_cnt + st.aux_rx_cnt;
+    }
+    const uint64_t wall_ns = bench_now_ns(CLOCK_MONOTONIC) - wall_start;
+    const uint64_t cpu_ns = bench_now_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+
+    usb_uart_disable(bridge);
+    BenchPacket stop = {.len = 0};
+    furi_message_queue_put(bench.usb_queue, &stop, FuriWaitForever);
+    pthread_join(bench.usb_thread, NULL);
+    furi_message_queue_free(bench.usb_queue);
+    host_cdc_set_tx_hook(NULL, NULL);
+
+    const double seconds = (double)wall_ns / 1e9;
+    const uint64_t lost = bench.generated - st.rx_cnt;
+    printf(
+        "%9lu baud: %10.0f B/s (%5.1f%% of line) | latency p50 %6luus p99 %6luus | dropped %lu "
+        "(%lu lost) mismatched %lu resynced %lu | cpu %.1f ns/B, bridge %.1f cycles/B | %lu "
+        "packets\n",
+        (unsigned long)cfg->baudrate,
+        (double)st.rx_cnt / seconds,
+        100.0 * (double)st.rx_cnt / seconds / ((double)cfg->baudrate / 10.0),
+        (unsigned long)usb_uart_state_latency_percentile(&st, 50),
+        (unsigned long)usb_uart_state_latency_percentile(&st, 99),
+        (unsigned long)st.rx_dropped,
+        (unsigned long)lost,
+        (unsigned long)bench.mismatched,
+        (unsigned long)bench.resyncs,
+        st.rx_cnt ? (double)cpu_ns / (double)st.rx_cnt : 0.0,
+        st.rx_cnt ? (double)st.busy_cycles / (double)st.rx_cnt : 0.0,
+        (unsigned long)st.cdc_packets);
+    if(cfg->dual) {
+        printf(
+            "%15s %10.0f B/s on uart2 | dropped %lu (%lu lost)\n",
+            "",
+            (double)st.aux_rx_cnt / seconds,
+            (unsigned long)st.aux_rx_dropped,
+            (unsigned long)(bench.generated - st.aux_rx_cnt));
+    }
+}
+
+typedef struct {
+    const uint8_t* expected;
+    size_t size;
+    size_t seen;
+    uint64_t mismatched;
+} BenchInject;
+
+static void bench_serial_tx(FuriHalSerialId id, const uint8_t* data, size_t size, void* ctx) {
+    BenchInject* inject = ctx;
+    if(id != FuriHalSerialIdUsart) return;
+    for(size_t i = 0; i < size; i++) {
+        if(inject->seen + i >= inject->size || data[i] != inject->expected[inject->seen + i]) {
+            inject->mismatched++;
+        }
+    }
+    inject->seen += size;
+}
+
+static void bench_inject(const BenchConfig* cfg) {
+    BenchInject inject = {.expected = cfg->replay, .size = cfg->replay_size};
+    host_serial_set_tx_hook(bench_serial_tx, &inject);
+
+    UsbUartConfig bridge_cfg = {
+        .vcp_ch = 1, .uart_ch = FuriHalSerialIdUsart, .baudrate = cfg->baudrate};
+    UsbUartBridge* bridge = usb_uart_enable(&bridge_cfg);
+    furi_delay_ms(50);
+
+    const UsbUartInjectPacing pacing = {.byte_rate = cfg->inject_rate};
+    const uint64_t wall_start = bench_now_ns(CLOCK_MONOTONIC);
+    furi_check(usb_uart_inject_file(bridge, cfg->inject, &pacing));
+    uint32_t sent = 0;
+    uint32_t total = 0;
+    while(usb_uart_inject_progress(bridge, &sent, &total)) {
+        furi_delay_ms(5);
+    }
+    const double seconds = (double)(bench_now_ns(CLOCK_MONOTONIC) - wall_start) / 1e9;
+    usb_uart_disable(bridge);
+    host_serial_set_tx_hook(NULL, NULL);
+
+    printf(
+        "inject %s: %lu/%lu bytes in %.2fs (%.0f B/s) | on uart %lu mismatched %lu\n",
+        cfg->inject,
+        (unsigned long)sent,
+        (unsigned long)total,
+        seconds,
+        (double)sent / seconds,
+        (unsigned long)inject.seen,
+        (unsigned long)inject.mismatched);
+}
+
+static uint8_t* bench_load(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if(!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = NULL;
+    if(len > 0) {
+        data = malloc((size_t)len);
+        *size = fread(data, 1, (size_t)len, file);
+    }
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg = {.duration_ms = 2000, .usb_packet_us = 60, .chunk = 0};
+    char default_rates[] = "115200,921600,3000000";
+    char* rates = default_rates;
+    int opt;
+    while((opt = getopt(argc, argv, "b:d:u:c:f:i:r:ah")) != -1) {
+        switch(opt) {
+        case 'b':
+            rates = optarg;
+            break;
+        case 'd':
+            cfg.duration_ms = (uint32_t)(atof(optarg) * 1000);
+            break;
+        case 'u':
+            cfg.usb_packet_us = (uint32_t)atoi(optarg);
+            break;
+        case 'c':
+            cfg.chunk = (size_t)atoi(optarg);
+            break;
+        case 'f':
+            cfg.replay = bench_load(optarg, &cfg.replay_size);
+            if(!cfg.replay) {
+                fprintf(stderr, "cannot read %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'a':
+            cfg.dual = true;
+            break;
+        case 'i':
+            cfg.inject = optarg;
+            cfg.replay = bench_load(optarg, &cfg.replay_size);
+            if(!cfg.replay) {
+                fprintf(stderr, "cannot read %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'r':
+            cfg.inject_rate = (uint32_t)atol(optarg);
+            break;
+        default:
+            fprintf(
+                stderr,
+                "usage: %s [-b baud[,baud...]] [-d seconds] [-u usb_packet_us] [-c dma_chunk] "
+                "[-f replay_file] [-a] [-i inject_file [-r bytes_per_s]]\n",
+                argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(cfg.chunk > FURI_HAL_SERIAL_DMA_BUFFER_SIZE) cfg.chunk = FURI_HAL_SERIAL_DMA_BUFFER_SIZE;
+
+    if(cfg.inject) {
+        cfg.baudrate = (uint32_t)atol(rates);
+        bench_inject(&cfg);
+        return 0;
+    }
+
+    for(char* rate = strtok(rates, ","); rate; rate = strtok(NULL, ",")) {
+        BenchConfig run = cfg;
+        run.baudrate = (uint32_t)atol(rate);
+        if(run.chunk == 0) {
+            // Idle-line interrupts at low rates, half-buffer DMA interrupts at high rates
+            run.chunk = run.baudrate / 10 / 1000;
+            if(run.chunk < 16) run.chunk = 16;
+            if(run.chunk > FURI_HAL_SERIAL_DMA_BUFFER_SIZE / 2) {
+                run.chunk = FURI_HAL_SERIAL_DMA_BUFFER_SIZE / 2;
+            }
+        }
+        bench_run(&run);
+    }
+    return 0;
+}
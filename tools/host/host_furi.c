@@ -0,0 +1,963 @@
+/* Furi stand-in for running YuriCable libraries on a Linux host. Threads, flags, stream
+ * buffers and locks map onto pthreads; the serial, CDC and GPIO peripherals are driven by the
+ * tool through host_sim.h. */
+#define _GNU_SOURCE
+#include <furi.h>
+#include <furi_hal.h>
+#include <furi_hal_usb_cdc.h>
+#include <cli/cli_vcp.h>
+#include <host_sim.h>
+#include <storage/storage.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+static uint64_t host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void host_deadline(struct timespec* ts, uint32_t timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if(ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void host_cond_init(pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/* Returns false on timeout */
+static bool host_cond_wait(pthread_cond_t* cond, pthread_mutex_t* lock, uint32_t timeout) {
+    if(timeout == FuriWaitForever) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    if(timeout == 0) return false;
+    struct timespec ts;
+    host_deadline(&ts, timeout);
+    return pthread_cond_timedwait(cond, lock, &ts) != ETIMEDOUT;
+}
+
+void host_crash(const char* expr, const char* file, int line) {
+    fprintf(stderr, "furi_check failed: %s (%s:%d)\n", expr, file, line);
+    abort();
+}
+
+void host_log(char level, const char* tag, const char* format, ...) {
+    if(!getenv("HOST_LOG")) return;
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "[%c][%s] ", level, tag);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+static pthread_mutex_t host_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void host_critical_enter(void) {
+    pthread_mutex_lock(&host_critical);
+}
+
+void host_critical_exit(void) {
+    pthread_mutex_unlock(&host_critical);
+}
+
+/* Kernel */
+
+static uint64_t host_start_ns;
+
+uint32_t furi_get_tick(void) {
+    if(!host_start_ns) host_start_ns = host_now_ns();
+    return (uint32_t)((host_now_ns() - host_start_ns) / 1000000ULL);
+}
+
+void furi_delay_ms(uint32_t ms) {
+    furi_delay_us(ms * 1000);
+}
+
+void furi_delay_tick(uint32_t ticks) {
+    furi_delay_ms(ticks);
+}
+
+/* Threads */
+
+struct FuriThread {
+    pthread_t pthread;
+    const char* name;
+    FuriThreadCallback callback;
+    void* context;
+    int32_t ret;
+    bool running;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t flags;
+};
+
+static __thread FuriThread* host_current_thread;
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context) {
+    UNUSED(stack_size);
+    FuriThread* thread = calloc(1, sizeof(FuriThread));
+    thread->name = name;
+    thread->callback = callback;
+    thread->context = context;
+    pthread_mutex_init(&thread->lock, NULL);
+    host_cond_init(&thread->cond);
+    return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+    furi_check(!thread->running);
+    pthread_mutex_destroy(&thread->lock);
+    pthread_cond_destroy(&thread->cond);
+    free(thread);
+}
+
+static void* host_thread_body(void* arg) {
+    FuriThread* thread = arg;
+    host_current_thread = thread;
+    thread->ret = thread->callback(thread->context);
+    return NULL;
+}
+
+void furi_thread_start(FuriThread* thread) {
+    furi_check(!thread->running);
+    thread->running = true;
+    furi_check(pthread_create(&thread->pthread, NULL, host_thread_body, thread) == 0);
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    if(!thread->running) return true;
+    pthread_join(thread->pthread, NULL);
+    thread->running = false;
+    return true;
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+    return thread;
+}
+
+FuriThreadId furi_thread_get_current_id(void) {
+    return host_current_thread;
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+    furi_check(thread_id);
+    pthread_mutex_lock(&thread_id->lock);
+    thread_id->flags |= flags;
+    uint32_t result = thread_id->flags;
+    pthread_cond_broadcast(&thread_id->cond);
+    pthread_mutex_unlock(&thread_id->lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_clear(uint32_t flags) {
+    FuriThread* thread = host_current_thread;
+    pthread_mutex_lock(&thread->lock);
+    uint32_t result = thread->flags;
+    thread->flags &= ~flags;
+    pthread_mutex_unlock(&thread->lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_get(void) {
+    FuriThread* thread = host_current_thread;
+    pthread_mutex_lock(&thread->lock);
+    uint32_t result = thread->flags;
+    pthread_mutex_unlock(&thread->lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    FuriThread* thread = host_current_thread;
+    uint32_t result = (uint32_t)FuriFlagErrorTimeout;
+    pthread_mutex_lock(&thread->lock);
+    while(1) {
+        uint32_t matched = thread->flags & flags;
+        bool done = (options & FuriFlagWaitAll) ? (matched == flags) : (matched != 0);
+        if(done) {
+            result = matched;
+            if(!(options & FuriFlagNoClear)) thread->flags &= ~matched;
+            break;
+        }
+        if(!host_cond_wait(&thread->cond, &thread->lock, timeout)) break;
+    }
+    pthread_mutex_unlock(&thread->lock);
+    return result;
+}
+
+/* Synchronisation */
+
+struct FuriMutex {
+    pthread_mutex_t mutex;
+};
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    FuriMutex* mutex = malloc(sizeof(FuriMutex));
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if(type == FuriMutexTypeRecursive) {
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    }
+    pthread_mutex_init(&mutex->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return mutex;
+}
+
+void furi_mutex_free(FuriMutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+    if(timeout == FuriWaitForever) {
+        return pthread_mutex_lock(&mutex->mutex) ? FuriStatusError : FuriStatusOk;
+    }
+    if(timeout == 0) {
+        return pthread_mutex_trylock(&mutex->mutex) ? FuriStatusErrorResource : FuriStatusOk;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / 1000;
+    ts.tv_nsec += (long)(timeout % 1000) * 1000000L;
+    if(ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return pthread_mutex_timedlock(&mutex->mutex, &ts) ? FuriStatusErrorTimeout : FuriStatusOk;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* mutex) {
+    return pthread_mutex_unlock(&mutex->mutex) ? FuriStatusError : FuriStatusOk;
+}
+
+struct FuriSemaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+    uint32_t max_count;
+};
+
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count) {
+    FuriSemaphore* sem = malloc(sizeof(FuriSemaphore));
+    pthread_mutex_init(&sem->lock, NULL);
+    host_cond_init(&sem->cond);
+    sem->count = initial_count;
+    sem->max_count = max_count;
+    return sem;
+}
+
+void furi_semaphore_free(FuriSemaphore* instance) {
+    pthread_mutex_destroy(&instance->lock);
+    pthread_cond_destroy(&instance->cond);
+    free(instance);
+}
+
+FuriStatus furi_semaphore_acquire(FuriSemaphore* instance, uint32_t timeout) {
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&instance->lock);
+    while(instance->count == 0) {
+        if(!host_cond_wait(&instance->cond, &instance->lock, timeout)) {
+            status = timeout ? FuriStatusErrorTimeout : FuriStatusErrorResource;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) instance->count--;
+    pthread_mutex_unlock(&instance->lock);
+    return status;
+}
+
+FuriStatus furi_semaphore_release(FuriSemaphore* instance) {
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&instance->lock);
+    if(instance->count < instance->max_count) {
+        instance->count++;
+        pthread_cond_broadcast(&instance->cond);
+    } else {
+        status = FuriStatusErrorResource;
+    }
+    pthread_mutex_unlock(&instance->lock);
+    return status;
+}
+
+/* Byte ring shared by the stream buffer and message queue */
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t* data;
+    size_t size;
+    size_t head;
+    size_t count;
+} HostRing;
+
+static void host_ring_init(HostRing* ring, size_t size) {
+    pthread_mutex_init(&ring->lock, NULL);
+    host_cond_init(&ring->cond);
+    ring->data = malloc(size);
+    ring->size = size;
+    ring->head = 0;
+    ring->count = 0;
+}
+
+static void host_ring_deinit(HostRing* ring) {
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->cond);
+    free(ring->data);
+}
+
+static void host_ring_put(HostRing* ring, const uint8_t* data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        ring->data[(ring->head + ring->count + i) % ring->size] = data[i];
+    }
+    ring->count += length;
+}
+
+static void host_ring_get(HostRing* ring, uint8_t* data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        data[i] = ring->data[(ring->head + i) % ring->size];
+    }
+    ring->head = (ring->head + length) % ring->size;
+    ring->count -= length;
+}
+
+struct FuriStreamBuffer {
+    HostRing ring;
+};
+
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level) {
+    UNUSED(trigger_level);
+    FuriStreamBuffer* stream = malloc(sizeof(FuriStreamBuffer));
+    host_ring_init(&stream->ring, size);
+    return stream;
+}
+
+void furi_stream_buffer_free(FuriStreamBuffer* stream_buffer) {
+    host_ring_deinit(&stream_buffer->ring);
+    free(stream_buffer);
+}
+
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* stream_buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout) {
+    HostRing* ring = &stream_buffer->ring;
+    pthread_mutex_lock(&ring->lock);
+    while(ring->count == ring->size) {
+        if(!host_cond_wait(&ring->cond, &ring->lock, timeout)) break;
+    }
+    size_t space = ring->size - ring->count;
+    if(length > space) length = space;
+    host_ring_put(ring, data, length);
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+    return length;
+}
+
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* stream_buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout) {
+    HostRing* ring = &stream_buffer->ring;
+    pthread_mutex_lock(&ring->lock);
+    while(ring->count == 0) {
+        if(!host_cond_wait(&ring->cond, &ring->lock, timeout)) break;
+    }
+    if(length > ring->count) length = ring->count;
+    host_ring_get(ring, data, length);
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+    return length;
+}
+
+size_t furi_stream_buffer_bytes_available(FuriStreamBuffer* stream_buffer) {
+    pthread_mutex_lock(&stream_buffer->ring.lock);
+    size_t count = stream_buffer->ring.count;
+    pthread_mutex_unlock(&stream_buffer->ring.lock);
+    return count;
+}
+
+size_t furi_stream_buffer_spaces_available(FuriStreamBuffer* stream_buffer) {
+    pthread_mutex_lock(&stream_buffer->ring.lock);
+    size_t space = stream_buffer->ring.size - stream_buffer->ring.count;
+    pthread_mutex_unlock(&stream_buffer->ring.lock);
+    return space;
+}
+
+FuriStatus furi_stream_buffer_reset(FuriStreamBuffer* stream_buffer) {
+    pthread_mutex_lock(&stream_buffer->ring.lock);
+    stream_buffer->ring.head = 0;
+    stream_buffer->ring.count = 0;
+    pthread_cond_broadcast(&stream_buffer->ring.cond);
+    pthread_mutex_unlock(&stream_buffer->ring.lock);
+    return FuriStatusOk;
+}
+
+struct FuriMessageQueue {
+    HostRing ring;
+    uint32_t msg_size;
+};
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size) {
+    FuriMessageQueue* queue = malloc(sizeof(FuriMessageQueue));
+    host_ring_init(&queue->ring, (size_t)msg_count * msg_size);
+    queue->msg_size = msg_size;
+    return queue;
+}
+
+void furi_message_queue_free(FuriMessageQueue* instance) {
+    host_ring_deinit(&instance->ring);
+    free(instance);
+}
+
+FuriStatus furi_message_queue_put(FuriMessageQueue* instance, const void* msg, uint32_t timeout) {
+    HostRing* ring = &instance->ring;
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&ring->lock);
+    while(ring->size - ring->count < instance->msg_size) {
+        if(!host_cond_wait(&ring->cond, &ring->lock, timeout)) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        host_ring_put(ring, msg, instance->msg_size);
+        pthread_cond_broadcast(&ring->cond);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return status;
+}
+
+FuriStatus furi_message_queue_get(FuriMessageQueue* instance, void* msg, uint32_t timeout) {
+    HostRing* ring = &instance->ring;
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&ring->lock);
+    while(ring->count < instance->msg_size) {
+        if(!host_cond_wait(&ring->cond, &ring->lock, timeout)) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        host_ring_get(ring, msg, instance->msg_size);
+        pthread_cond_broadcast(&ring->cond);
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return status;
+}
+
+/* Records */
+
+static uint8_t host_record_dummy;
+
+void* furi_record_open(const char* name) {
+    UNUSED(name);
+    return &host_record_dummy;
+}
+
+void furi_record_close(const char* name) {
+    UNUSED(name);
+}
+
+/* Storage, files map onto stdio with SD paths taken as host paths */
+
+struct File {
+    FILE* fp;
+};
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    return calloc(1, sizeof(File));
+}
+
+void storage_file_free(File* file) {
+    if(file->fp) fclose(file->fp);
+    free(file);
+}
+
+bool storage_file_open(File* file, const char* path, FS_AccessMode access, FS_OpenMode mode) {
+    const char* how = "rb";
+    if(access & FSAM_WRITE) {
+        how = (mode & FSOM_CREATE_ALWAYS) ? "wb" : (mode & FSOM_OPEN_APPEND) ? "ab" : "r+b";
+    }
+    file->fp = fopen(path, how);
+    return file->fp != NULL;
+}
+
+bool storage_file_close(File* file) {
+    if(!file->fp) return false;
+    fclose(file->fp);
+    file->fp = NULL;
+    return true;
+}
+
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read) {
+    return file->fp ? fread(buff, 1, bytes_to_read, file->fp) : 0;
+}
+
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write) {
+    return file->fp ? fwrite(buff, 1, bytes_to_write, file->fp) : 0;
+}
+
+uint64_t storage_file_size(File* file) {
+    if(!file->fp) return 0;
+    const long pos = ftell(file->fp);
+    fseek(file->fp, 0, SEEK_END);
+    const long size = ftell(file->fp);
+    fseek(file->fp, pos, SEEK_SET);
+    return size;
+}
+
+/* Strings */
+
+struct FuriString {
+    char* data;
+    size_t size;
+};
+
+FuriString* furi_string_alloc(void) {
+    FuriString* string = malloc(sizeof(FuriString));
+    string->data = strdup("");
+    string->size = 0;
+    return string;
+}
+
+FuriString* furi_string_alloc_set(const char* cstr) {
+    FuriString* string = furi_string_alloc();
+    furi_string_set_str(string, cstr);
+    return string;
+}
+
+FuriString* furi_string_alloc_set_str(const char* cstr) {
+    return furi_string_alloc_set(cstr);
+}
+
+FuriString* furi_string_alloc_vprintf(const char* format, va_list args) {
+    FuriString* string = malloc(sizeof(FuriString));
+    int len = vasprintf(&string->data, format, args);
+    furi_check(len >= 0);
+    string->size = (size_t)len;
+    return string;
+}
+
+FuriString* furi_string_alloc_printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    FuriString* string = furi_string_alloc_vprintf(format, args);
+    va_end(args);
+    return string;
+}
+
+void furi_string_free(FuriString* string) {
+    free(string->data);
+    free(string);
+}
+
+void furi_string_reset(FuriString* string) {
+    furi_string_set_str(string, "");
+}
+
+void furi_string_set_str(FuriString* string, const char* cstr) {
+    free(string->data);
+    string->data = strdup(cstr);
+    string->size = strlen(cstr);
+}
+
+void furi_string_cat_str(FuriString* string, const char* cstr) {
+    size_t len = strlen(cstr);
+    string->data = realloc(string->data, string->size + len + 1);
+    memcpy(string->data + string->size, cstr, len + 1);
+    string->size += len;
+}
+
+void furi_string_cat(FuriString* string, FuriString* other) {
+    furi_string_cat_str(string, other->data);
+}
+
+int furi_string_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    free(string->data);
+    int len = vasprintf(&string->data, format, args);
+    va_end(args);
+    furi_check(len >= 0);
+    string->size = (size_t)len;
+    return len;
+}
+
+int furi_string_cat_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    char* tail;
+    int len = vasprintf(&tail, format, args);
+    va_end(args);
+    furi_check(len >= 0);
+    furi_string_cat_str(string, tail);
+    free(tail);
+    return len;
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+    return string->data;
+}
+
+size_t furi_string_size(const FuriString* string) {
+    return string->size;
+}
+
+/* Cortex */
+
+static HostDwt host_dwt_regs;
+static HostCyclesHook host_cycles_hook;
+static void* host_cycles_ctx;
+
+void host_dwt_set_hook(HostCyclesHook hook, void* ctx) {
+    host_cycles_hook = hook;
+    host_cycles_ctx = ctx;
+}
+
+HostDwt* host_dwt(void) {
+    if(host_cycles_hook) {
+        host_dwt_regs.CYCCNT = host_cycles_hook(host_cycles_ctx);
+    } else {
+        host_dwt_regs.CYCCNT =
+            (uint32_t)(host_now_ns() * furi_hal_cortex_instructions_per_microsecond() / 1000);
+    }
+    return &host_dwt_regs;
+}
+
+uint32_t furi_hal_cortex_instructions_per_microsecond(void) {
+    return 64;
+}
+
+void furi_delay_us(uint32_t us) {
+    // Simulated time only moves while it is read, so spin on DWT like the firmware does
+    if(host_cycles_hook) {
+        const uint32_t start = DWT->CYCCNT;
+        const uint32_t cycles = us * furi_hal_cortex_instructions_per_microsecond();
+        while(DWT->CYCCNT - start < cycles) {
+        }
+        return;
+    }
+    struct timespec ts = {.tv_sec = us / 1000000, .tv_nsec = (long)(us % 1000000) * 1000L};
+    while(nanosleep(&ts, &ts) && errno == EINTR) {
+    }
+}
+
+/* GPIO */
+
+const GpioPin gpio_ext_pa7 = {0, 7};
+const GpioPin gpio_ext_pa6 = {0, 6};
+const GpioPin gpio_ext_pa4 = {0, 4};
+const GpioPin gpio_ext_pb2 = {1, 2};
+const GpioPin gpio_ext_pb3 = {1, 3};
+const GpioPin gpio_ext_pc0 = {2, 0};
+const GpioPin gpio_ext_pc1 = {2, 1};
+const GpioPin gpio_ext_pc3 = {2, 3};
+
+#define HOST_GPIO_COUNT 48
+
+static struct {
+    bool level;
+    GpioExtiCallback cb;
+    void* ctx;
+} host_gpio[HOST_GPIO_COUNT];
+static HostGpioReadHook host_gpio_read_hook;
+static HostGpioWriteHook host_gpio_write_hook;
+static void* host_gpio_ctx;
+
+static size_t host_gpio_index(const GpioPin* gpio) {
+    size_t index = (size_t)gpio->port * 16 + gpio->pin;
+    furi_check(index < HOST_GPIO_COUNT);
+    return index;
+}
+
+void host_gpio_set_hooks(HostGpioReadHook read, HostGpioWriteHook write, void* ctx) {
+    host_gpio_read_hook = read;
+    host_gpio_write_hook = write;
+    host_gpio_ctx = ctx;
+}
+
+void furi_hal_gpio_init(const GpioPin* gpio, GpioMode mode, GpioPull pull, GpioSpeed speed) {
+    UNUSED(gpio);
+    UNUSED(mode);
+    UNUSED(pull);
+    UNUSED(speed);
+}
+
+void furi_hal_gpio_init_simple(const GpioPin* gpio, GpioMode mode) {
+    furi_hal_gpio_init(gpio, mode, GpioPullNo, GpioSpeedLow);
+}
+
+void furi_hal_gpio_write(const GpioPin* gpio, bool state) {
+    host_gpio[host_gpio_index(gpio)].level = state;
+    if(host_gpio_write_hook) host_gpio_write_hook(gpio, state, host_gpio_ctx);
+}
+
+bool furi_hal_gpio_read(const GpioPin* gpio) {
+    if(host_gpio_read_hook) return host_gpio_read_hook(gpio, host_gpio_ctx);
+    return host_gpio[host_gpio_index(gpio)].level;
+}
+
+void furi_hal_gpio_add_int_callback(const GpioPin* gpio, GpioExtiCallback cb, void* ctx) {
+    size_t index = host_gpio_index(gpio);
+    host_gpio[index].cb = cb;
+    host_gpio[index].ctx = ctx;
+}
+
+void furi_hal_gpio_remove_int_callback(const GpioPin* gpio) {
+    size_t index = host_gpio_index(gpio);
+    host_gpio[index].cb = NULL;
+    host_gpio[index].ctx = NULL;
+}
+
+void host_gpio_trigger_int(const GpioPin* gpio) {
+    size_t index = host_gpio_index(gpio);
+    if(host_gpio[index].cb) host_gpio[index].cb(host_gpio[index].ctx);
+}
+
+/* Serial */
+
+struct FuriHalSerialHandle {
+    FuriHalSerialId id;
+    uint32_t baudrate;
+    FuriHalSerialDmaRxCallback rx_callback;
+    void* rx_context;
+    const uint8_t* dma_data;
+    size_t dma_size;
+};
+
+static FuriHalSerialHandle host_serial[FuriHalSerialIdMax] = {
+    {.id = FuriHalSerialIdUsart},
+    {.id = FuriHalSerialIdLpuart},
+};
+static HostSerialTxHook host_serial_tx_hook;
+static void* host_serial_tx_ctx;
+
+FuriHalSerialHandle* furi_hal_serial_control_acquire(FuriHalSerialId serial_id) {
+    furi_check(serial_id < FuriHalSerialIdMax);
+    return &host_serial[serial_id];
+}
+
+void furi_hal_serial_control_release(FuriHalSerialHandle* handle) {
+    handle->rx_callback = NULL;
+}
+
+void furi_hal_serial_init(FuriHalSerialHandle* handle, uint32_t baud) {
+    handle->baudrate = baud;
+}
+
+void furi_hal_serial_deinit(FuriHalSerialHandle* handle) {
+    handle->rx_callback = NULL;
+}
+
+void furi_hal_serial_set_br(FuriHalSerialHandle* handle, uint32_t baud) {
+    handle->baudrate = baud;
+}
+
+void furi_hal_serial_tx(FuriHalSerialHandle* handle, const uint8_t* buffer, size_t buffer_size) {
+    if(host_serial_tx_hook) {
+        host_serial_tx_hook(handle->id, buffer, buffer_size, host_serial_tx_ctx);
+    }
+}
+
+void furi_hal_serial_tx_wait_complete(FuriHalSerialHandle* handle) {
+    UNUSED(handle);
+}
+
+void furi_hal_serial_dma_rx_start(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialDmaRxCallback callback,
+    void* context,
+    bool report_errors) {
+    UNUSED(report_errors);
+    handle->rx_context = context;
+    handle->rx_callback = callback;
+}
+
+void furi_hal_serial_dma_rx_stop(FuriHalSerialHandle* handle) {
+    handle->rx_callback = NULL;
+}
+
+size_t furi_hal_serial_dma_rx(FuriHalSerialHandle* handle, uint8_t* data, size_t len) {
+    if(len > handle->dma_size) len = handle->dma_size;
+    memcpy(data, handle->dma_data, len);
+    handle->dma_data += len;
+    handle->dma_size -= len;
+    return len;
+}
+
+size_t host_serial_inject(FuriHalSerialId id, const uint8_t* data, size_t size) {
+    FuriHalSerialHandle* handle = &host_serial[id];
+    host_critical_enter();
+    if(!handle->rx_callback) {
+        host_critical_exit();
+        return 0;
+    }
+    handle->dma_data = data;
+    handle->dma_size = size;
+    handle->rx_callback(handle, FuriHalSerialRxEventData, size, handle->rx_context);
+    size_t consumed = size - handle->dma_size;
+    handle->dma_size = 0;
+    host_critical_exit();
+    return consumed;
+}
+
+void host_serial_set_tx_hook(HostSerialTxHook hook, void* ctx) {
+    host_serial_tx_hook = hook;
+    host_serial_tx_ctx = ctx;
+}
+
+uint32_t host_serial_get_baudrate(FuriHalSerialId id) {
+    return host_serial[id].baudrate;
+}
+
+/* USB */
+
+FuriHalUsbInterface usb_cdc_single;
+FuriHalUsbInterface usb_cdc_dual;
+
+void furi_hal_usb_unlock(void) {
+}
+
+bool furi_hal_usb_set_config(FuriHalUsbInterface* new_if, void* ctx) {
+    UNUSED(new_if);
+    UNUSED(ctx);
+    return true;
+}
+
+/* Power */
+
+static volatile uint8_t host_insomnia;
+
+void furi_hal_power_insomnia_enter(void) {
+    FURI_CRITICAL_ENTER();
+    host_insomnia++;
+    FURI_CRITICAL_EXIT();
+}
+
+void furi_hal_power_insomnia_exit(void) {
+    FURI_CRITICAL_ENTER();
+    furi_check(host_insomnia > 0);
+    host_insomnia--;
+    FURI_CRITICAL_EXIT();
+}
+
+uint8_t host_power_insomnia(void) {
+    return host_insomnia;
+}
+
+void cli_vcp_enable(CliVcp* cli_vcp) {
+    UNUSED(cli_vcp);
+}
+
+void cli_vcp_disable(CliVcp* cli_vcp) {
+    UNUSED(cli_vcp);
+}
+
+#define HOST_CDC_COUNT  2
+#define HOST_CDC_RX_LEN 4096
+
+static struct {
+    CdcCallbacks* cb;
+    void* ctx;
+    struct usb_cdc_line_coding line;
+    uint8_t ctrl_line;
+    FuriStreamBuffer* rx;
+} host_cdc[HOST_CDC_COUNT];
+static pthread_mutex_t host_cdc_lock = PTHREAD_MUTEX_INITIALIZER;
+static HostCdcTxHook host_cdc_tx_hook;
+static void* host_cdc_tx_ctx;
+
+static FuriStreamBuffer* host_cdc_rx(uint8_t if_num) {
+    furi_check(if_num < HOST_CDC_COUNT);
+    pthread_mutex_lock(&host_cdc_lock);
+    if(!host_cdc[if_num].rx) host_cdc[if_num].rx = furi_stream_buffer_alloc(HOST_CDC_RX_LEN, 1);
+    pthread_mutex_unlock(&host_cdc_lock);
+    return host_cdc[if_num].rx;
+}
+
+void furi_hal_cdc_set_callbacks(uint8_t if_num, CdcCallbacks* cb, void* context) {
+    furi_check(if_num < HOST_CDC_COUNT);
+    pthread_mutex_lock(&host_cdc_lock);
+    host_cdc[if_num].cb = cb;
+    host_cdc[if_num].ctx = context;
+    pthread_mutex_unlock(&host_cdc_lock);
+}
+
+struct usb_cdc_line_coding* furi_hal_cdc_get_port_settings(uint8_t if_num) {
+    furi_check(if_num < HOST_CDC_COUNT);
+    return &host_cdc[if_num].line;
+}
+
+uint8_t furi_hal_cdc_get_ctrl_line_state(uint8_t if_num) {
+    furi_check(if_num < HOST_CDC_COUNT);
+    return host_cdc[if_num].ctrl_line;
+}
+
+void furi_hal_cdc_send(uint8_t if_num, uint8_t* buf, uint16_t len) {
+    furi_check(len <= CDC_DATA_SZ);
+    if(host_cdc_tx_hook) host_cdc_tx_hook(if_num, buf, len, host_cdc_tx_ctx);
+}
+
+int32_t furi_hal_cdc_receive(uint8_t if_num, uint8_t* buf, uint16_t max_len) {
+    return (int32_t)furi_stream_buffer_receive(host_cdc_rx(if_num), buf, max_len, 0);
+}
+
+void host_cdc_set_tx_hook(HostCdcTxHook hook, void* ctx) {
+    host_cdc_tx_hook = hook;
+    host_cdc_tx_ctx = ctx;
+}
+
+#define HOST_CDC_CALL(if_num, member, ...)                                   \
+    do {                                                                     \
+        pthread_mutex_lock(&host_cdc_lock);                                  \
+        CdcCallbacks* _cb = host_cdc[if_num].cb;                             \
+        void* _ctx = host_cdc[if_num].ctx;                                   \
+        pthread_mutex_unlock(&host_cdc_lock);                                \
+        if(_cb && _cb->member) _cb->member(_ctx __VA_OPT__(, ) __VA_ARGS__); \
+    } while(0)
+
+void host_cdc_tx_complete(uint8_t if_num) {
+    HOST_CDC_CALL(if_num, tx_ep_callback);
+}
+
+void host_cdc_write(uint8_t if_num, const uint8_t* data, size_t size) {
+    FuriStreamBuffer* rx = host_cdc_rx(if_num);
+    while(size) {
+        size_t chunk = size > CDC_DATA_SZ ? CDC_DATA_SZ : size;
+        furi_stream_buffer_send(rx, data, chunk, FuriWaitForever);
+        HOST_CDC_CALL(if_num, rx_ep_callback);
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void host_cdc_set_ctrl_line(uint8_t if_num, uint8_t state) {
+    furi_check(if_num < HOST_CDC_COUNT);
+    host_cdc[if_num].ctrl_line = state;
+    HOST_CDC_CALL(if_num, ctrl_line_callback, state);
+}
+
+void host_cdc_set_line_coding(uint8_t if_num, uint32_t baudrate) {
+    furi_check(if_num < HOST_CDC_COUNT);
+    host_cdc[if_num].line.dwDTERate = baudrate;
+    HOST_CDC_CALL(if_num, config_callback, &host_cdc[if_num].line);
+}
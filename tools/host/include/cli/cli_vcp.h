@@ -0,0 +1,8 @@
+#pragma once
+
+#define RECORD_CLI_VCP "cli_vcp"
+
+typedef struct CliVcp CliVcp;
+
+void cli_vcp_enable(CliVcp* cli_vcp);
+void cli_vcp_disable(CliVcp* cli_vcp);
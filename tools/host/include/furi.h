@@ -0,0 +1,155 @@
+#pragma once
+/* Host stand-in for the subset of the Furi API used by the YuriCable libraries.
+ * Only meant for the tools in tools/, never compiled into the FAP. */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Furi's allocator hands out zeroed memory and the libraries rely on it */
+#define malloc(size) calloc(1, size)
+
+#define UNUSED(x)   (void)(x)
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+void host_crash(const char* expr, const char* file, int line);
+
+#define furi_check(x)                                    \
+    do {                                                 \
+        if(!(x)) host_crash(#x, __FILE__, __LINE__);     \
+    } while(0)
+#define furi_assert(x) furi_check(x)
+#define furi_crash(msg) host_crash(msg, __FILE__, __LINE__)
+
+void host_log(char level, const char* tag, const char* format, ...);
+#define FURI_LOG_E(tag, ...) host_log('E', tag, __VA_ARGS__)
+#define FURI_LOG_W(tag, ...) host_log('W', tag, __VA_ARGS__)
+#define FURI_LOG_I(tag, ...) host_log('I', tag, __VA_ARGS__)
+#define FURI_LOG_D(tag, ...) host_log('D', tag, __VA_ARGS__)
+#define FURI_LOG_T(tag, ...) host_log('T', tag, __VA_ARGS__)
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+#define FURI_CRITICAL_ENTER() host_critical_enter();
+#define FURI_CRITICAL_EXIT()  host_critical_exit();
+
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusError = -1,
+    FuriStatusErrorTimeout = -2,
+    FuriStatusErrorResource = -3,
+    FuriStatusErrorParameter = -4,
+} FuriStatus;
+
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+    FuriFlagWaitAny = 0x00000000U,
+    FuriFlagWaitAll = 0x00000001U,
+    FuriFlagNoClear = 0x00000002U,
+    FuriFlagError = 0x80000000U,
+    FuriFlagErrorUnknown = 0xFFFFFFFFU,
+    FuriFlagErrorTimeout = 0xFFFFFFFEU,
+    FuriFlagErrorResource = 0xFFFFFFFDU,
+    FuriFlagErrorParameter = 0xFFFFFFFCU,
+} FuriFlag;
+
+/* Kernel */
+uint32_t furi_get_tick(void);
+#define furi_ms_to_ticks(ms) ((uint32_t)(ms))
+void furi_delay_ms(uint32_t ms);
+void furi_delay_us(uint32_t us);
+void furi_delay_tick(uint32_t ticks);
+
+/* Threads */
+typedef struct FuriThread FuriThread;
+typedef FuriThread* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context);
+void furi_thread_free(FuriThread* thread);
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+FuriThreadId furi_thread_get_current_id(void);
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+uint32_t furi_thread_flags_clear(uint32_t flags);
+uint32_t furi_thread_flags_get(void);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+/* Synchronisation */
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+
+typedef struct FuriMutex FuriMutex;
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* mutex);
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* mutex);
+
+typedef struct FuriSemaphore FuriSemaphore;
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count);
+void furi_semaphore_free(FuriSemaphore* instance);
+FuriStatus furi_semaphore_acquire(FuriSemaphore* instance, uint32_t timeout);
+FuriStatus furi_semaphore_release(FuriSemaphore* instance);
+
+typedef struct FuriMessageQueue FuriMessageQueue;
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size);
+void furi_message_queue_free(FuriMessageQueue* instance);
+FuriStatus furi_message_queue_put(FuriMessageQueue* instance, const void* msg, uint32_t timeout);
+FuriStatus furi_message_queue_get(FuriMessageQueue* instance, void* msg, uint32_t timeout);
+
+typedef struct FuriStreamBuffer FuriStreamBuffer;
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level);
+void furi_stream_buffer_free(FuriStreamBuffer* stream_buffer);
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* stream_buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* stream_buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_bytes_available(FuriStreamBuffer* stream_buffer);
+size_t furi_stream_buffer_spaces_available(FuriStreamBuffer* stream_buffer);
+FuriStatus furi_stream_buffer_reset(FuriStreamBuffer* stream_buffer);
+
+/* Records */
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
+
+/* Strings */
+typedef struct FuriString FuriString;
+FuriString* furi_string_alloc(void);
+FuriString* furi_string_alloc_set(const char* cstr);
+FuriString* furi_string_alloc_set_str(const char* cstr);
+FuriString* furi_string_alloc_printf(const char* format, ...);
+FuriString* furi_string_alloc_vprintf(const char* format, va_list args);
+void furi_string_free(FuriString* string);
+void furi_string_reset(FuriString* string);
+void furi_string_set_str(FuriString* string, const char* cstr);
+void furi_string_cat(FuriString* string, FuriString* other);
+void furi_string_cat_str(FuriString* string, const char* cstr);
+int furi_string_printf(FuriString* string, const char* format, ...);
+int furi_string_cat_printf(FuriString* string, const char* format, ...);
+const char* furi_string_get_cstr(const FuriString* string);
+size_t furi_string_size(const FuriString* string);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#include <furi.h>
+#include <furi_hal_gpio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cortex */
+typedef struct {
+    volatile uint32_t CYCCNT;
+} HostDwt;
+HostDwt* host_dwt(void);
+#define DWT (host_dwt())
+uint32_t furi_hal_cortex_instructions_per_microsecond(void);
+
+/* Serial */
+#define FURI_HAL_SERIAL_DMA_BUFFER_SIZE 256
+
+typedef enum {
+    FuriHalSerialIdUsart,
+    FuriHalSerialIdLpuart,
+    FuriHalSerialIdMax,
+} FuriHalSerialId;
+
+typedef enum {
+    FuriHalSerialRxEventData = (1 << 0),
+    FuriHalSerialRxEventIdle = (1 << 1),
+    FuriHalSerialRxEventFrameError = (1 << 2),
+    FuriHalSerialRxEventNoiseError = (1 << 3),
+    FuriHalSerialRxEventOverrunError = (1 << 4),
+} FuriHalSerialRxEvent;
+
+typedef struct FuriHalSerialHandle FuriHalSerialHandle;
+typedef void (*FuriHalSerialDmaRxCallback)(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialRxEvent event,
+    size_t data_len,
+    void* context);
+
+FuriHalSerialHandle* furi_hal_serial_control_acquire(FuriHalSerialId serial_id);
+void furi_hal_serial_control_release(FuriHalSerialHandle* handle);
+void furi_hal_serial_init(FuriHalSerialHandle* handle, uint32_t baud);
+void furi_hal_serial_deinit(FuriHalSerialHandle* handle);
+void furi_hal_serial_set_br(FuriHalSerialHandle* handle, uint32_t baud);
+void furi_hal_serial_tx(FuriHalSerialHandle* handle, const uint8_t* buffer, size_t buffer_size);
+void furi_hal_serial_tx_wait_complete(FuriHalSerialHandle* handle);
+void furi_hal_serial_dma_rx_start(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialDmaRxCallback callback,
+    void* context,
+    bool report_errors);
+void furi_hal_serial_dma_rx_stop(FuriHalSerialHandle* handle);
+size_t furi_hal_serial_dma_rx(FuriHalSerialHandle* handle, uint8_t* data, size_t len);
+
+/* USB */
+typedef struct {
+    int dummy;
+} FuriHalUsbInterface;
+extern FuriHalUsbInterface usb_cdc_single;
+extern FuriHalUsbInterface usb_cdc_dual;
+void furi_hal_usb_unlock(void);
+bool furi_hal_usb_set_config(FuriHalUsbInterface* new_if, void* ctx);
+
+/* Power, the host never sleeps, insomnia is only counted */
+void furi_hal_power_insomnia_enter(void);
+void furi_hal_power_insomnia_exit(void);
+uint8_t host_power_insomnia(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+/* Hooks the host tools use to play the hardware side of the Furi stand-in */
+#include <furi_hal.h>
+#include <furi_hal_usb_cdc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Feed bytes into the serial port as if the DMA had just received them. Runs the registered
+ * RX callback synchronously, the same way the DMA interrupt would. */
+size_t host_serial_inject(FuriHalSerialId id, const uint8_t* data, size_t size);
+
+typedef void (*HostSerialTxHook)(FuriHalSerialId id, const uint8_t* data, size_t size, void* ctx);
+void host_serial_set_tx_hook(HostSerialTxHook hook, void* ctx);
+uint32_t host_serial_get_baudrate(FuriHalSerialId id);
+
+/* Called for every packet the device hands to the USB stack. The host side acknowledges it
+ * later with host_cdc_tx_complete(). */
+typedef void (*HostCdcTxHook)(uint8_t if_num, const uint8_t* data, size_t size, void* ctx);
+void host_cdc_set_tx_hook(HostCdcTxHook hook, void* ctx);
+void host_cdc_tx_complete(uint8_t if_num);
+/* Queue bytes the PC writes to the CDC port and signal the device */
+void host_cdc_write(uint8_t if_num, const uint8_t* data, size_t size);
+void host_cdc_set_ctrl_line(uint8_t if_num, uint8_t state);
+void host_cdc_set_line_coding(uint8_t if_num, uint32_t baudrate);
+
+/* GPIO line model, the default keeps every pin at its written level */
+typedef bool (*HostGpioReadHook)(const GpioPin* gpio, void* ctx);
+typedef void (*HostGpioWriteHook)(const GpioPin* gpio, bool state, void* ctx);
+void host_gpio_set_hooks(HostGpioReadHook read, HostGpioWriteHook write, void* ctx);
+/* Fire the EXTI callback registered for the pin */
+void host_gpio_trigger_int(const GpioPin* gpio);
+
+/* Replace the wall clock behind DWT->CYCCNT with a simulated one, furi_delay_us then runs on
+ * it as well */
+typedef uint32_t (*HostCyclesHook)(void* ctx);
+void host_dwt_set_hook(HostCyclesHook hook, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
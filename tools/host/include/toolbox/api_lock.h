@@ -0,0 +1,14 @@
+#pragma once
+#include <furi.h>
+
+typedef FuriSemaphore* FuriApiLock;
+
+#define api_lock_alloc_locked() furi_semaphore_alloc(1, 0)
+#define api_lock_wait_unlock(_lock) furi_semaphore_acquire(_lock, FuriWaitForever)
+#define api_lock_free(_lock) furi_semaphore_free(_lock)
+#define api_lock_unlock(_lock) furi_semaphore_release(_lock)
+#define api_lock_wait_unlock_and_free(_lock) \
+    do {                                      \
+        api_lock_wait_unlock(_lock);          \
+        api_lock_free(_lock);                 \
+    } while(0)
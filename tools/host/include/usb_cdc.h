@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+
+struct usb_cdc_line_coding {
+    uint32_t dwDTERate;
+    uint8_t bCharFormat;
+    uint8_t bParityType;
+    uint8_t bDataBits;
+};
@@ -0,0 +1,283 @@
+/* Runs the SDQ host probe against a simulated Lightning accessory.
+ *
+ * lib/sdq/sdq_host.c runs unmodified on the host against the Furi stand-in in tools/host. Time
+ * is simulated: every DWT->CYCCNT read advances the clock by a few cycles, so results do not
+ * depend on the Linux scheduler. The accessory decodes the host's pulses with the SDQTimings
+ * windows, checks the request CRC and answers like a cable would, with optional jitter and
+ * clock skew on its reply edges.
+ *
+ * Build:
+ *   gcc -O2 -pthread -Itools/host/include -I. tools/host/host_furi.c tools/sdq_sim/sdq_sim.c \
+ *       -o sdq_sim
+ * Run:
+ *   ./sdq_sim [-n probes] [-a usb-uart | charging | dfu] [-j jitter_ns] [-s skew_percent]
+ *             [-d reply_delay_us]
+ */
+#include <furi.h>
+#include <host_sim.h>
+#include "../../lib/sdq/sdq_device.c"
+#include "../../lib/profile/sdq_profile.h"
+#include "../../lib/sdq/sdq_host.c"
+
+#include <getopt.h>
+
+#define SIM_PIN      gpio_ext_pa7
+#define SIM_STEP     4
+#define SIM_MAX_BITS (SDQ_HOST_FRAME_MAX * 8)
+
+typedef struct {
+    uint64_t now;
+    uint32_t cycles_per_us;
+    const SDQTimings* timings;
+
+    // Accessory identity and reply distortion
+    const uint8_t* id;
+    uint32_t reply_delay_us;
+    uint32_t jitter_ns;
+    int32_t skew_percent;
+
+    // Host side of the wire as the accessory decodes it
+    bool host_level;
+    uint64_t fall;
+    uint64_t rise;
+    uint8_t frame[SDQ_HOST_FRAME_MAX];
+    size_t bits;
+    bool in_frame;
+
+    // Reply waveform, even entries are falling edges
+    uint64_t edges[SIM_MAX_BITS * 2];
+    size_t edge_count;
+    size_t edge_pos;
+
+    uint32_t wakes;
+    uint32_t requests;
+    uint32_t rejected;
+} Sim;
+
+// The accessory side of the engine is linked for its tables only, profiles stay out
+const SDQProfile* sdq_profile_lookup(const SDQProfileTable* table, uint16_t key) {
+    UNUSED(table);
+    UNUSED(key);
+    return NULL;
+}
+
+struct LogSaver {
+    uint8_t unused;
+};
+
+LogSaver* log_saver_alloc(const char* prefix) {
+    UNUSED(prefix);
+    return malloc(sizeof(LogSaver));
+}
+
+void log_saver_free(LogSaver* saver) {
+    free(saver);
+}
+
+void log_saver_write(LogSaver* saver, const char* str, size_t len) {
+    UNUSED(saver);
+    UNUSED(str);
+    UNUSED(len);
+}
+
+size_t log_saver_read(LogSaver* saver, size_t offset, char* out, size_t len) {
+    UNUSED(saver);
+    UNUSED(offset);
+    UNUSED(out);
+    UNUSED(len);
+    return 0;
+}
+
+static uint32_t sim_cycles(void* ctx) {
+    Sim* sim = ctx;
+    sim->now += SIM_STEP;
+    return (uint32_t)sim->now;
+}
+
+static bool sim_within(const Sim* sim, uint64_t cycles, uint32_t min_us, uint32_t max_us) {
+    return cycles >= (uint64_t)min_us * sim->cycles_per_us &&
+           cycles <= (uint64_t)max_us * sim->cycles_per_us;
+}
+
+/* Stretches a duration by the skew and moves the edge by up to the jitter either way */
+static uint64_t sim_distort(const Sim* sim, uint64_t at, uint32_t us) {
+    int64_t cycles = (int64_t)us * sim->cycles_per_us * (100 + sim->skew_percent) / 100;
+    if(sim->jitter_ns) {
+        const int64_t jitter = (int64_t)sim->jitter_ns * sim->cycles_per_us / 1000;
+        cycles += (int64_t)(rand() % (2 * jitter + 1)) - jitter;
+    }
+    return at + (cycles > 0 ? (uint64_t)cycles : 1);
+}
+
+static void sim_reply(Sim* sim, const uint8_t* data, size_t size) {
+    uint8_t frame[SDQ_HOST_FRAME_MAX];
+    memcpy(frame, data, size);
+    frame[size] = crc_data(data, size);
+
+    const SDQTimings* t = sim->timings;
+    uint64_t at = sim->now + (uint64_t)sim->reply_delay_us * sim->cycles_per_us;
+    sim->edge_count = 0;
+    sim->edge_pos = 0;
+    for(size_t i = 0; i < size + 1; i++) {
+        for(uint8_t mask = 0x01; mask != 0; mask <<= 1) {
+            const bool one = frame[i] & mask;
+            uint32_t recovery = one ? t->ONE_recovery : t->ZERO_recovery;
+            if(mask == 0x80) recovery = one ? t->ONE_STOP_recovery : t->ZERO_STOP_recovery;
+            // Same pulse widths sdq_device_send uses
+            sim->edges[sim->edge_count++] = at;
+            at = sim_distort(sim, at, one ? t->ONE_meaningful_min : t->ZERO_meaningful_min);
+            sim->edges[sim->edge_count++] = at;
+            at = sim_distort(sim, at, recovery);
+        }
+    }
+}
+
+static void sim_request(Sim* sim) {
+    const uint8_t* request = sim->frame;
+    if(sim->bits != 32 || crc_data(request, 3) != request[3]) {
+        sim->rejected++;
+        return;
+    }
+    sim->requests++;
+    switch(request[0]) {
+    case TRISTAR_POLL:
+        sim_reply(sim, sim->id, sizeof(responses.USB_UART));
+        break;
+    case TRISTAR_UNKNOWN_76:
+        sim_reply(sim, responses.UNKNOWN_76_ANSWER, sizeof(responses.UNKNOWN_76_ANSWER));
+        break;
+    case TRISTAR_POWER:
+        sim_reply(sim, responses.POWER_ANSWER, 1);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Decodes the host's pulses on every edge it drives */
+static void sim_gpio_write(const GpioPin* gpio, bool state, void* ctx) {
+    Sim* sim = ctx;
+    if(gpio != &SIM_PIN || state == sim->host_level) return;
+    sim->host_level = state;
+    const SDQTimings* t = sim->timings;
+    if(!state) {
+        sim->fall = sim->now;
+        // A frame that stalls longer than a stop bit is abandoned
+        if(sim->in_frame && sim->bits &&
+           !sim_within(sim, sim->fall - sim->rise, 0, t->ONE_STOP_recovery + 1)) {
+            sim->in_frame = false;
+            sim->rejected++;
+        }
+        return;
+    }
+    sim->rise = sim->now;
+    const uint64_t low = sim->rise - sim->fall;
+    if(sim_within(sim, low, t->WAKE_meaningful_min, t->WAKE_meaningful_max)) {
+        sim->wakes++;
+        sim->in_frame = false;
+    } else if(sim_within(sim, low, t->BREAK_meaningful_min, t->BREAK_meaningful_max)) {
+        if(sim->in_frame) sim_request(sim);
+        // A BREAK after a request hands the line over, otherwise it opens a frame
+        sim->in_frame = !sim->in_frame;
+        sim->bits = 0;
+        memset(sim->frame, 0, sizeof(sim->frame));
+    } else if(sim->in_frame && sim->bits < SIM_MAX_BITS) {
+        if(sim_within(sim, low, 0, t->ONE_meaningful_max)) {
+            sim->frame[sim->bits / 8] |= 1 << (sim->bits % 8);
+        } else if(!sim_within(sim, low, t->ONE_meaningful_max, t->ZERO_meaningful_max)) {
+            sim->in_frame = false;
+            sim->rejected++;
+        }
+        sim->bits++;
+    }
+}
+
+static bool sim_gpio_read(const GpioPin* gpio, void* ctx) {
+    Sim* sim = ctx;
+    if(gpio != &SIM_PIN) return true;
+    while(sim->edge_pos < sim->edge_count && sim->edges[sim->edge_pos] <= sim->now) {
+        sim->edge_pos++;
+    }
+    const bool accessory = (sim->edge_pos % 2) == 0;
+    return sim->host_level && accessory;
+}
+
+int main(int argc, char** argv) {
+    uint32_t probes = 1000;
+    Sim sim = {
+        .cycles_per_us = furi_hal_cortex_instructions_per_microsecond(),
+        .timings = &sdq_timings,
+        .id = responses.USB_UART,
+        .reply_delay_us = 2,
+        .host_level = true,
+    };
+    int opt;
+    while((opt = getopt(argc, argv, "n:a:j:s:d:h")) != -1) {
+        switch(opt) {
+        case 'n':
+            probes = (uint32_t)atol(optarg);
+            break;
+        case 'a':
+            if(strcmp(optarg, "charging") == 0) {
+                sim.id = responses.USB_A_CHARGING_CABLE;
+                sim.reply_delay_us = SDQ_CHARGING_DELAY_US;
+            } else if(strcmp(optarg, "dfu") == 0) {
+                sim.id = responses.DFU;
+            } else if(strcmp(optarg, "usb-uart") != 0) {
+                fprintf(stderr, "unknown accessory %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'j':
+            sim.jitter_ns = (uint32_t)atol(optarg);
+            break;
+        case 's':
+            sim.skew_percent = atoi(optarg);
+            break;
+        case 'd':
+            sim.reply_delay_us = (uint32_t)atol(optarg);
+            break;
+        default:
+            fprintf(
+                stderr,
+                "usage: %s [-n probes] [-a usb-uart | charging | dfu] [-j jitter_ns] "
+                "[-s skew_percent] [-d reply_delay_us]\n",
+                argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    srand(1);
+    host_dwt_set_hook(sim_cycles, &sim);
+    host_gpio_set_hooks(sim_gpio_read, sim_gpio_write, &sim);
+    SDQHost* host = sdq_host_alloc(&SIM_PIN);
+
+    uint32_t ok = 0;
+    uint32_t errors[SDQHostErrorInvalidCRC + 1] = {0};
+    const char* kind = NULL;
+    for(uint32_t i = 0; i < probes; i++) {
+        SDQHostProbe probe;
+        if(sdq_host_probe(host, &probe)) {
+            ok++;
+            kind = sdq_host_probe_kind(&probe);
+        } else {
+            errors[probe.error]++;
+        }
+    }
+
+    printf(
+        "%lu/%lu probes ok, accessory %s | no reply %lu, bit timing %lu, crc %lu | "
+        "accessory saw %lu wakes, %lu requests, %lu rejected | edge late max %luns\n",
+        (unsigned long)ok,
+        (unsigned long)probes,
+        kind ? kind : "unknown",
+        (unsigned long)errors[SDQHostErrorNoReply],
+        (unsigned long)errors[SDQHostErrorBitReadTiming],
+        (unsigned long)errors[SDQHostErrorInvalidCRC],
+        (unsigned long)sim.wakes,
+        (unsigned long)sim.requests,
+        (unsigned long)sim.rejected,
+        (unsigned long)(host->edge_late_max * 1000 / sim.cycles_per_us));
+    sdq_host_free(host);
+    return ok == probes ? 0 : 1;
+}
@@ -0,0 +1,533 @@
+/* Sweeps the SDQTimings windows of the SDQ engine against a simulated Tristar.
+ *
+ * lib/sdq/sdq_device.c runs unmodified on the host against the Furi stand-in in tools/host, on
+ * the same simulated clock as sdq_sim. The Tristar sends the requests it opens a charging
+ * session with, POLL, 0x76 and POWER, with nominal pulses distorted by edge jitter, clock drift
+ * and pulse skew, and decodes the answer the way lib/sdq/sdq_host.c does. A transaction only
+ * passes when the answer is the expected one and arrived in time.
+ *
+ * First the current windows are run against growing distortion to find what they tolerate.
+ * Then every SDQTimings field is swept on its own with the others left at their defaults,
+ * which gives the values that field passes with and a proposed value in the middle of them.
+ * The exit status is 1 when a default fails or has less than the required margin, so a change
+ * to the decoder that eats into the windows shows up here first.
+ *
+ * The engine's state callback is installed and takes callback_ns each time, like the app's does
+ * waking its threads. Should it ever run again between the BREAK and the first data bit, the
+ * defaults fail here.
+ *
+ * Build:
+ *   gcc -O2 -pthread -Itools/host/include -I. tools/host/host_furi.c \
+ *       tools/sdq_sweep/sdq_sweep.c -o sdq_sweep
+ * Run:
+ *   ./sdq_sweep [-n transactions] [-j jitter_ns] [-d drift_percent] [-k skew_ns]
+ *               [-l latency_ns] [-c callback_ns] [-f field] [-m margin_us]
+ */
+#include <furi.h>
+#include <host_sim.h>
+#include "../../lib/sdq/sdq_device.c"
+#include "../../lib/sdq/sdq_host.h"
+
+#include <getopt.h>
+
+#define SWEEP_PIN         gpio_ext_pa7
+#define SWEEP_STEP        4
+#define SWEEP_FRAME_MAX   16
+#define SWEEP_PULSES_MAX  (SWEEP_FRAME_MAX * 8)
+#define SWEEP_EDGES_MAX   ((SWEEP_FRAME_MAX + 2) * 8 * 2)
+// Most values tried per field, spread over 0 to twice the default and lined up with it
+#define SWEEP_POINTS      64
+// Shorter lows do not make it through the RC of the line
+#define SWEEP_GLITCH_NS   250
+// Kept above the lowest passing value when a field has no upper limit
+#define SWEEP_MARGIN_US   2
+#define SWEEP_JITTER_MAX  5000
+#define SWEEP_DRIFT_MAX   50
+#define SWEEP_SKEW_MAX    5000
+#define SWEEP_LATENCY_MAX 16000
+
+typedef enum {
+    SweepResultOk,
+    SweepResultNoReply,
+    SweepResultLate,
+    SweepResultBitTiming,
+    SweepResultWrongReply,
+    SweepResultCount,
+} SweepResult;
+
+typedef struct {
+    uint8_t request[3];
+    const uint8_t* reply;
+    size_t reply_size;
+} SweepRequest;
+
+typedef struct {
+    uint64_t fall;
+    uint64_t rise;
+} SweepPulse;
+
+typedef struct {
+    uint64_t now;
+    uint32_t cycles_per_us;
+    SDQDevice* device;
+
+    // Distortion of the Tristar's edges
+    int32_t jitter_ns;
+    int32_t drift_percent;
+    int32_t skew_ns;
+    int32_t latency_ns;
+    int32_t callback_ns;
+    uint32_t notifications;
+
+    // Request waveform, even entries are falling edges, the line is released after the last
+    uint64_t edges[SWEEP_EDGES_MAX];
+    size_t edge_count;
+    size_t edge_pos;
+
+    // Answer as the engine drove it
+    bool device_level;
+    SweepPulse pulses[SWEEP_PULSES_MAX];
+    size_t pulse_count;
+
+    uint32_t results[SweepResultCount];
+} Sweep;
+
+typedef struct {
+    const char* name;
+    size_t offset;
+} SweepField;
+
+#define SWEEP_FIELD(name) {#name, offsetof(SDQTimings, name)}
+
+static const SweepField sweep_fields[] = {
+    SWEEP_FIELD(BREAK_meaningful_min),
+    SWEEP_FIELD(BREAK_meaningful_max),
+    SWEEP_FIELD(BREAK_meaningful),
+    SWEEP_FIELD(BREAK_recovery),
+    SWEEP_FIELD(WAKE_meaningful_min),
+    SWEEP_FIELD(WAKE_meaningful_max),
+    SWEEP_FIELD(WAKE_meaningful),
+    SWEEP_FIELD(WAKE_recovery),
+    SWEEP_FIELD(ZERO_meaningful_min),
+    SWEEP_FIELD(ZERO_meaningful_max),
+    SWEEP_FIELD(ZERO_meaningful),
+    SWEEP_FIELD(ZERO_recovery),
+    SWEEP_FIELD(ONE_meaningful_min),
+    SWEEP_FIELD(ONE_meaningful_max),
+    SWEEP_FIELD(ONE_meaningful),
+    SWEEP_FIELD(ONE_recovery),
+    SWEEP_FIELD(ZERO_STOP_recovery),
+    SWEEP_FIELD(ONE_STOP_recovery),
+};
+
+// What a Tristar asks a charging cable, the engine answers as SDQChargeIdentityCable
+static const SweepRequest sweep_requests[] = {
+    {{TRISTAR_POLL, 0x00, 0x02},
+     responses.USB_A_CHARGING_CABLE,
+     sizeof(responses.USB_A_CHARGING_CABLE)},
+    {{TRISTAR_UNKNOWN_76, 0x01, 0x02},
+     responses.UNKNOWN_76_ANSWER,
+     sizeof(responses.UNKNOWN_76_ANSWER)},
+    {{TRISTAR_POWER, 0x00, 0x00}, responses.POWER_ANSWER, sizeof(responses.POWER_ANSWER)},
+};
+
+static const char* const sweep_result_names[] = {
+    "ok",
+    "no reply",
+    "late",
+    "bit timing",
+    "wrong reply",
+};
+
+// Profiles stay out, the sweep is about the default windows
+const SDQProfile* sdq_profile_lookup(const SDQProfileTable* table, uint16_t key) {
+    UNUSED(table);
+    UNUSED(key);
+    return NULL;
+}
+
+struct LogSaver {
+    uint8_t unused;
+};
+
+LogSaver* log_saver_alloc(const char* prefix) {
+    UNUSED(prefix);
+    return malloc(sizeof(LogSaver));
+}
+
+void log_saver_free(LogSaver* saver) {
+    free(saver);
+}
+
+void log_saver_write(LogSaver* saver, const char* str, size_t len) {
+    UNUSED(saver);
+    UNUSED(str);
+    UNUSED(len);
+}
+
+size_t log_saver_read(LogSaver* saver, size_t offset, char* out, size_t len) {
+    UNUSED(saver);
+    UNUSED(offset);
+    UNUSED(out);
+    UNUSED(len);
+    return 0;
+}
+
+static uint32_t sweep_cycles(void* ctx) {
+    Sweep* sweep = ctx;
+    sweep->now += SWEEP_STEP;
+    return (uint32_t)sweep->now;
+}
+
+static int64_t sweep_ns(const Sweep* sweep, int64_t ns) {
+    return ns * sweep->cycles_per_us / 1000;
+}
+
+// Stands in for the app's state callback, the time it takes passes on the line as well
+static void sweep_state_changed(void* ctx) {
+    Sweep* sweep = ctx;
+    sweep->now += sweep_ns(sweep, sweep->callback_ns);
+    sweep->notifications++;
+}
+
+/* Appends an edge us after the nominal one before it. The Tristar's clock drifts, lows are
+ * skewed longer at the cost of the high phase after them and every edge jitters on its own,
+ * so jitter does not add up over a frame. */
+static void sweep_edge(Sweep* sweep, uint64_t* nominal, uint32_t us, bool low) {
+    int64_t hold = (int64_t)us * sweep->cycles_per_us * (100 + sweep->drift_percent) / 100;
+    hold += sweep_ns(sweep, low ? sweep->skew_ns : -sweep->skew_ns);
+    *nominal += hold > 0 ? (uint64_t)hold : 1;
+    int64_t at = (int64_t)*nominal;
+    if(sweep->jitter_ns) {
+        const int64_t jitter = sweep_ns(sweep, sweep->jitter_ns);
+        at += (int64_t)(rand() % (2 * jitter + 1)) - jitter;
+    }
+    const int64_t last = sweep->edge_count ? (int64_t)sweep->edges[sweep->edge_count - 1] : 0;
+    sweep->edges[sweep->edge_count++] = at > last ? (uint64_t)at : (uint64_t)last + 1;
+}
+
+/* Same waveform sdq_host_transfer drives: BREAK, the frame with its CRC, the second BREAK */
+static void sweep_request(Sweep* sweep, const uint8_t request[3]) {
+    const SDQTimings* t = &sdq_timings;
+    uint8_t frame[4];
+    memcpy(frame, request, 3);
+    frame[3] = crc_data(request, 3);
+    sweep->edge_count = 0;
+    sweep->edge_pos = 0;
+    uint64_t at = sweep->now;
+    sweep->edges[sweep->edge_count++] = at;
+    sweep_edge(sweep, &at, t->BREAK_meaningful, true);
+    sweep_edge(sweep, &at, t->BREAK_recovery, false);
+    for(size_t i = 0; i < sizeof(frame); i++) {
+        for(uint8_t mask = 0x01; mask != 0; mask <<= 1) {
+            const bool one = frame[i] & mask;
+            uint32_t recovery = one ? t->ONE_recovery : t->ZERO_recovery;
+            if(mask == 0x80) recovery = one ? t->ONE_STOP_recovery : t->ZERO_STOP_recovery;
+            sweep_edge(sweep, &at, one ? t->ONE_meaningful : t->ZERO_meaningful, true);
+            sweep_edge(sweep, &at, recovery, false);
+        }
+    }
+    sweep_edge(sweep, &at, t->BREAK_meaningful, true);
+}
+
+static bool sweep_gpio_read(const GpioPin* gpio, void* ctx) {
+    Sweep* sweep = ctx;
+    if(gpio != &SWEEP_PIN) return true;
+    while(sweep->edge_pos < sweep->edge_count && sweep->edges[sweep->edge_pos] <= sweep->now) {
+        sweep->edge_pos++;
+    }
+    const bool tristar = (sweep->edge_pos % 2) == 0;
+    return tristar && sweep->device_level;
+}
+
+static void sweep_gpio_write(const GpioPin* gpio, bool state, void* ctx) {
+    Sweep* sweep = ctx;
+    if(gpio != &SWEEP_PIN || state == sweep->device_level) return;
+    sweep->device_level = state;
+    if(sweep->pulse_count == SWEEP_PULSES_MAX) return;
+    if(!state) {
+        sweep->pulses[sweep->pulse_count].fall = sweep->now;
+    } else {
+        sweep->pulses[sweep->pulse_count++].rise = sweep->now;
+    }
+}
+
+/* Decodes the answer with the windows and timeouts of sdq_host_receive */
+static SweepResult sweep_decode(const Sweep* sweep, const SweepRequest* request) {
+    const SDQTimings* t = &sdq_timings;
+    const uint64_t us = sweep->cycles_per_us;
+    const uint64_t gap = ((t->ONE_STOP_recovery > t->ZERO_STOP_recovery ? t->ONE_STOP_recovery :
+                                                                          t->ZERO_STOP_recovery) +
+                          t->ONE_meaningful_max) *
+                         us;
+    if(sweep->pulse_count == 0) return SweepResultNoReply;
+    const uint64_t released = sweep->edges[sweep->edge_count - 1];
+    if(sweep->pulses[0].fall - released > SDQ_HOST_REPLY_TIMEOUT_US * us) {
+        return SweepResultLate;
+    }
+    uint8_t frame[SWEEP_FRAME_MAX] = {0};
+    const size_t bits = (request->reply_size + 1) * 8;
+    if(sweep->pulse_count != bits) return SweepResultBitTiming;
+    for(size_t i = 0; i < bits; i++) {
+        const SweepPulse* pulse = &sweep->pulses[i];
+        const uint64_t low = pulse->rise - pulse->fall;
+        if(low < (uint64_t)sweep_ns(sweep, SWEEP_GLITCH_NS) || low > t->ZERO_meaningful_max * us ||
+           (i > 0 && pulse->fall - sweep->pulses[i - 1].rise > gap)) {
+            return SweepResultBitTiming;
+        }
+        if(low <= t->ONE_meaningful_max * us) frame[i / 8] |= 1 << (i % 8);
+    }
+    if(memcmp(frame, request->reply, request->reply_size) != 0 ||
+       crc_data(request->reply, request->reply_size) != frame[request->reply_size]) {
+        return SweepResultWrongReply;
+    }
+    return SweepResultOk;
+}
+
+/* One request and its answer. The engine handles it in the interrupt the BREAK raises, which
+ * only returns once the session is over. */
+static SweepResult sweep_transaction(Sweep* sweep, const SweepRequest* request) {
+    sweep->now += (uint64_t)SDQ_HOST_REQUEST_GAP_US * sweep->cycles_per_us;
+    sweep_request(sweep, request->request);
+    sweep->pulse_count = 0;
+    sweep->now = sweep->edges[0] + sweep_ns(sweep, sweep->latency_ns);
+    host_gpio_trigger_int(&SWEEP_PIN);
+    return sweep_decode(sweep, request);
+}
+
+/* Runs the transactions with the engine on the given windows, true if every one of them passed.
+ * The jitter sequence restarts each time so all values see the same edges. */
+static bool sweep_run(Sweep* sweep, const SDQTimings* timings, uint32_t transactions) {
+    srand(1);
+    sdq_device_set_timings(sweep->device, timings);
+    memset(sweep->results, 0, sizeof(sweep->results));
+    for(uint32_t i = 0; i < transactions; i++) {
+        sweep->results[sweep_transaction(sweep, &sweep_requests[i % COUNT_OF(sweep_requests)])]++;
+    }
+    return sweep->results[SweepResultOk] == transactions;
+}
+
+/* Moves one distortion away from its set value step by step in one direction and returns the
+ * last value the default windows still passed with */
+static int32_t sweep_tolerance(
+    Sweep* sweep,
+    int32_t* knob,
+    int32_t step,
+    int32_t limit,
+    uint32_t transactions) {
+    const int32_t set = *knob;
+    int32_t passed = set;
+    for(int32_t value = set + step; step > 0 ? value <= limit : value >= limit; value += step) {
+        *knob = value;
+        if(!sweep_run(sweep, &sdq_timings, transactions)) break;
+        passed = value;
+    }
+    *knob = set;
+    return passed;
+}
+
+/* Sweeps one field and prints a row: the passing values around the default, the margin the
+ * default has to either end and the value in the middle. Returns the default's margin in us,
+ * -1 when the default fails. */
+static int32_t sweep_field(Sweep* sweep, const SweepField* field, uint32_t transactions) {
+    const uint32_t current = *(const uint32_t*)((const uint8_t*)&sdq_timings + field->offset);
+    const uint32_t top = current * 2 + 4;
+    const uint32_t step = (top + SWEEP_POINTS - 1) / SWEEP_POINTS;
+    const uint32_t base = current % step;
+    bool pass[SWEEP_POINTS + 2];
+    uint32_t points = 0;
+    bool any = false;
+    bool all = true;
+    for(uint32_t value = base; value <= top; value += step) {
+        SDQTimings timings = sdq_timings;
+        *(uint32_t*)((uint8_t*)&timings + field->offset) = value;
+        pass[points] = sweep_run(sweep, &timings, transactions);
+        any |= pass[points];
+        all &= pass[points];
+        points++;
+    }
+
+    printf("%-21s %5lu  ", field->name, (unsigned long)current);
+    if(all) {
+        printf("%-13s %-9s %-8s %s\n", "any", "-", "-", "no effect");
+        return INT32_MAX;
+    }
+    if(!any) {
+        printf("%-13s %-9s %-8s %s\n", "none", "-", "-", "FAIL, never passes");
+        return -1;
+    }
+    // The passing run holding the default, or the nearest one when the default fails
+    uint32_t at = current / step;
+    const bool current_pass = pass[at];
+    if(!current_pass) {
+        uint32_t below = at;
+        uint32_t above = at;
+        while(below > 0 && !pass[below]) below--;
+        while(above < points - 1 && !pass[above]) above++;
+        at = !pass[below] || (pass[above] && above - at < at - below) ? above : below;
+    }
+    uint32_t first = at;
+    uint32_t last = at;
+    while(first > 0 && pass[first - 1]) first--;
+    while(last < points - 1 && pass[last + 1]) last++;
+    const uint32_t lo = base + first * step;
+    const uint32_t hi = base + last * step;
+    const bool open_top = last == points - 1;
+    uint32_t proposed = (lo + hi) / 2;
+    if(open_top) proposed = current > lo + SWEEP_MARGIN_US ? current : lo + SWEEP_MARGIN_US;
+
+    char range[24];
+    if(open_top) {
+        snprintf(range, sizeof(range), "%lu..", (unsigned long)lo);
+    } else {
+        snprintf(range, sizeof(range), "%lu..%lu", (unsigned long)lo, (unsigned long)hi);
+    }
+    int32_t margin = -1;
+    if(current_pass) {
+        margin = (int32_t)(current - lo);
+        if(!open_top && (int32_t)(hi - current) < margin) margin = (int32_t)(hi - current);
+    }
+    char margin_text[24] = "-";
+    if(margin >= 0) snprintf(margin_text, sizeof(margin_text), "%ld", (long)margin);
+    const char* note = "keep";
+    if(!current_pass) {
+        note = "FAIL";
+    } else if(proposed > current) {
+        note = "raise";
+    } else if(proposed < current) {
+        note = "lower";
+    }
+    printf("%-13s %-9s %-8lu %s\n", range, margin_text, (unsigned long)proposed, note);
+    return margin;
+}
+
+int main(int argc, char** argv) {
+    uint32_t transactions = 30;
+    int32_t required_margin = 0;
+    const char* only = NULL;
+    Sweep sweep = {
+        .cycles_per_us = furi_hal_cortex_instructions_per_microsecond(),
+        .latency_ns = 3000,
+        .callback_ns = 10000,
+        .device_level = true,
+    };
+    int opt;
+    while((opt = getopt(argc, argv, "n:j:d:k:l:c:f:m:h")) != -1) {
+        switch(opt) {
+        case 'n':
+            transactions = (uint32_t)atol(optarg);
+            break;
+        case 'j':
+            sweep.jitter_ns = atoi(optarg);
+            break;
+        case 'd':
+            sweep.drift_percent = atoi(optarg);
+            break;
+        case 'k':
+            sweep.skew_ns = atoi(optarg);
+            break;
+        case 'l':
+            sweep.latency_ns = atoi(optarg);
+            break;
+        case 'c':
+            sweep.callback_ns = atoi(optarg);
+            break;
+        case 'f':
+            only = optarg;
+            break;
+        case 'm':
+            required_margin = atoi(optarg);
+            break;
+        default:
+            fprintf(
+                stderr,
+                "usage: %s [-n transactions] [-j jitter_ns] [-d drift_percent] [-k skew_ns] "
+                "[-l latency_ns] [-c callback_ns] [-f field] [-m margin_us]\n",
+                argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(transactions == 0 || sweep.jitter_ns < 0 || sweep.latency_ns < 0 ||
+       sweep.callback_ns < 0) {
+        fprintf(
+            stderr, "transactions must be positive, jitter, latency and callback not negative\n");
+        return 1;
+    }
+
+    host_dwt_set_hook(sweep_cycles, &sweep);
+    host_gpio_set_hooks(sweep_gpio_read, sweep_gpio_write, &sweep);
+    sweep.device = sdq_device_alloc(&SWEEP_PIN, NULL);
+    sdq_device_set_state_callback(sweep.device, sweep_state_changed, &sweep);
+    sdq_device_post_command(sweep.device, SDQDeviceCommand_CHARGING);
+    sdq_device_start(sweep.device);
+
+    printf(
+        "%lu transactions per point, jitter %ldns, drift %ld%%, skew %ldns, latency %ldns, "
+        "callback %ldns\n",
+        (unsigned long)transactions,
+        (long)sweep.jitter_ns,
+        (long)sweep.drift_percent,
+        (long)sweep.skew_ns,
+        (long)sweep.latency_ns,
+        (long)sweep.callback_ns);
+    sweep.notifications = 0;
+    const bool defaults_pass = sweep_run(&sweep, &sdq_timings, transactions);
+    printf(
+        "defaults: %s, %lu notifications",
+        defaults_pass ? "pass" : "FAIL",
+        (unsigned long)sweep.notifications);
+    for(size_t i = 0; i < SweepResultCount; i++) {
+        printf(
+            "%s %s %lu",
+            i ? "," : " |",
+            sweep_result_names[i],
+            (unsigned long)sweep.results[i]);
+    }
+    printf("\n");
+    if(defaults_pass) {
+        printf(
+            "tolerance: jitter ..%ldns, drift %ld..%ld%%, skew %ld..%ldns, latency %ld..%ldns\n",
+            (long)sweep_tolerance(&sweep, &sweep.jitter_ns, 50, SWEEP_JITTER_MAX, transactions),
+            (long)sweep_tolerance(&sweep, &sweep.drift_percent, -1, -SWEEP_DRIFT_MAX, transactions),
+            (long)sweep_tolerance(&sweep, &sweep.drift_percent, 1, SWEEP_DRIFT_MAX, transactions),
+            (long)sweep_tolerance(&sweep, &sweep.skew_ns, -50, -SWEEP_SKEW_MAX, transactions),
+            (long)sweep_tolerance(&sweep, &sweep.skew_ns, 50, SWEEP_SKEW_MAX, transactions),
+            (long)sweep_tolerance(&sweep, &sweep.latency_ns, -250, 0, transactions),
+            (long)sweep_tolerance(&sweep, &sweep.latency_ns, 250, SWEEP_LATENCY_MAX, transactions));
+    }
+
+    printf(
+        "\n%-21s %5s  %-13s %-9s %-8s %s\n",
+        "field",
+        "us",
+        "passes",
+        "margin",
+        "proposed",
+        "note");
+    uint32_t failed = 0;
+    uint32_t tight = 0;
+    bool found = false;
+    for(size_t i = 0; i < COUNT_OF(sweep_fields); i++) {
+        if(only && strcmp(only, sweep_fields[i].name) != 0) continue;
+        found = true;
+        const int32_t margin = sweep_field(&sweep, &sweep_fields[i], transactions);
+        if(margin < 0) {
+            failed++;
+        } else if(margin < required_margin) {
+            tight++;
+        }
+    }
+    if(!found) {
+        fprintf(stderr, "unknown field %s\n", only);
+        return 1;
+    }
+    printf(
+        "\n%lu failing, %lu under %ldus of margin\n",
+        (unsigned long)failed,
+        (unsigned long)tight,
+        (long)required_margin);
+
+    sdq_device_stop(sweep.device);
+    sdq_device_free(sweep.device);
+    return defaults_pass && failed == 0 && tight == 0 ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+/* Linux client for the YuriCable binary RPC mode.
+ *
+ * Switches the bridge CDC port into RPC mode with `/rpc`, sends all requests given on the
+ * command line as one batch and prints one line per response:
+ *   <seq> <command> <status> [key=value ...]
+ *
+ * Build:
+ *   gcc -O2 -I. lib/crc/crc.c lib/rpc/yuri_rpc.c tools/yuricable_rpc/yuricable_rpc.c \
+ *       -o yuricable_rpc
+ * Example:
+ *   ./yuricable_rpc /dev/ttyACM1 "mode dfu" start status stats
+ *   ./yuricable_rpc -o iboot.log /dev/ttyACM1 log
+ */
+#include <lib/rpc/yuri_rpc.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RPC_MAX_REQUESTS 64
+
+static const char* const command_names[] = {
+    [YuriRpcCommandHello] = "hello",
+    [YuriRpcCommandPing] = "ping",
+    [YuriRpcCommandStart] = "start",
+    [YuriRpcCommandStop] = "stop",
+    [YuriRpcCommandMode] = "mode",
+    [YuriRpcCommandStatus] = "status",
+    [YuriRpcCommandStats] = "stats",
+    [YuriRpcCommandLog] = "log",
+    [YuriRpcCommandExit] = "exit",
+};
+
+static const char* const status_names[] = {
+    [YuriRpcStatusOk] = "ok",
+    [YuriRpcStatusUnknownCommand] = "unknown-command",
+    [YuriRpcStatusInvalidArgument] = "invalid-argument",
+    [YuriRpcStatusBusy] = "busy",
+    [YuriRpcStatusError] = "error",
+};
+
+static const char* const mode_names[] = {"none", "dcsd", "reset", "dfu", "charging", "sn", "jtag", "recovery"};
+
+typedef struct {
+    uint8_t cmd;
+    uint8_t payload[4];
+    size_t len;
+    int done;
+} Request;
+
+static const char* name_of(const char* const* names, size_t count, unsigned value) {
+    return (value < count && names[value]) ? names[value] : "?";
+}
+
+static long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static int open_port(const char* path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if(fd < 0) return -1;
+    struct termios tio;
+    if(tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int write_all(int fd, const uint8_t* data, size_t len) {
+    while(len) {
+        ssize_t ret = write(fd, data, len);
+        if(ret < 0) {
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        data += ret;
+        len -= (size_t)ret;
+    }
+    return 0;
+}
+
+/* Read until parser yields a frame or the deadline passes */
+static int read_frame(int fd, YuriRpcParser* parser, long deadline) {
+    static uint8_t buf[512];
+    static size_t buf_len, buf_pos;
+    while(1) {
+        while(buf_pos < buf_len) {
+            if(yuri_rpc_parser_feed(parser, buf[buf_pos++])) return 1;
+        }
+        long left = deadline - now_ms();
+        if(left <= 0) return 0;
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        if(poll(&pfd, 1, (int)left) <= 0) continue;
+        ssize_t ret = read(fd, buf, sizeof(buf));
+        if(ret < 0 && errno != EINTR && errno != EAGAIN) return -1;
+        buf_len = ret > 0 ? (size_t)ret : 0;
+        buf_pos = 0;
+    }
+}
+
+static int parse_request(int argc, char** argv, int* index, Request* request) {
+    const char* word = argv[*index];
+    memset(request, 0, sizeof(*request));
+    if(strcmp(word, "mode") == 0 && *index + 1 < argc) {
+        const char* mode = argv[++(*index)];
+        request->cmd = YuriRpcCommandMode;
+        request->len = 1;
+        for(size_t i = 0; i < sizeof(mode_names) / sizeof(mode_names[0]); i++) {
+            if(strcmp(mode, mode_names[i]) == 0) {
+                request->payload[0] = (uint8_t)i;
+                return 0;
+            }
+        }
+        return -1;
+    }
+    if(strncmp(word, "mode ", 5) == 0) {
+        char* args[] = {"mode", (char*)word + 5};
+        int i = 0;
+        return parse_request(2, args, &i, request);
+    }
+    for(size_t i = YuriRpcCommandPing; i < sizeof(command_names) / sizeof(command_names[0]); i++) {
+        if(i != YuriRpcCommandMode && strcmp(word, command_names[i]) == 0) {
+            request->cmd = (uint8_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void print_response(const YuriRpcFrame* frame, FILE* log_out) {
+    if(frame->cmd == YuriRpcCommandLog && frame->status == YuriRpcStatusOk) {
+        fwrite(frame->payload, 1, frame->len, log_out);
+        if(frame->flags & YuriRpcFlagMore) return;
+        fflush(log_out);
+    }
+    printf(
+        "%u %s %s",
+        frame->seq,
+        name_of(command_names, sizeof(command_names) / sizeof(command_names[0]), frame->cmd),
+        name_of(status_names, sizeof(status_names) / sizeof(status_names[0]), frame->status));
+    if(frame->status == YuriRpcStatusOk) {
+        const uint8_t* p = frame->payload;
+        if(frame->cmd == YuriRpcCommandStatus && frame->len >= 6) {
+            printf(
+                " listening=%u connected=%u reset_in_progress=%u executed=%u error=%u mode=%s",
+                p[0],
+                p[1],
+                p[2],
+                p[3],
+                p[4],
+                name_of(mode_names, sizeof(mode_names) / sizeof(mode_names[0]), p[5]));
+        } else if(frame->cmd == YuriRpcCommandStats && frame->len >= 32) {
+            printf(
+                " rx=%u tx=%u baudrate=%u dropped=%u packets=%u p50_us=%u p99_us=%u "
+                "cycles_per_byte=%u",
+                yuri_rpc_get_u32(p),
+                yuri_rpc_get_u32(p + 4),
+                yuri_rpc_get_u32(p + 8),
+                yuri_rpc_get_u32(p + 12),
+                yuri_rpc_get_u32(p + 16),
+                yuri_rpc_get_u32(p + 20),
+                yuri_rpc_get_u32(p + 24),
+                yuri_rpc_get_u32(p + 28));
+        } else if(frame->cmd == YuriRpcCommandPing) {
+            printf(" payload=%u", frame->len);
+        }
+    }
+    printf("\n");
+}
+
+static void usage(const char* name) {
+    fprintf(
+        stderr,
+        "usage: %s [-t timeout_ms] [-o log_file] <tty> <request>...\n"
+        "requests: ping start stop \"mode <dcsd|reset|dfu>\" status stats log exit\n",
+        name);
+}
+
+int main(int argc, char** argv) {
+    long timeout_ms = 2000;
+    FILE* log_out = stdout;
+    int opt;
+    while((opt = getopt(argc, argv, "t:o:h")) != -1) {
+        switch(opt) {
+        case 't':
+            timeout_ms = atol(optarg);
+            break;
+        case 'o':
+            log_out = fopen(optarg, "wb");
+            if(!log_out) {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(optind + 1 >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Request requests[RPC_MAX_REQUESTS];
+    size_t count = 0;
+    for(int i = optind + 1; i < argc; i++) {
+        if(count == RPC_MAX_REQUESTS || parse_request(argc, argv, &i, &requests[count]) < 0) {
+            fprintf(stderr, "invalid request: %s\n", argv[i]);
+            return 1;
+        }
+        count++;
+    }
+
+    int fd = open_port(argv[optind]);
+    if(fd < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    YuriRpcParser parser = {0};
+    uint8_t frame[YURI_RPC_FRAME_MAX];
+
+    // Enter RPC mode, the hello request also syncs a port that is already in RPC mode
+    static const uint8_t enter[] = "/rpc\r";
+    size_t size = yuri_rpc_encode(frame, sizeof(frame), 0, YuriRpcCommandHello, 0, 0, NULL, 0);
+    if(write_all(fd, enter, sizeof(enter) - 1) < 0 || write_all(fd, frame, size) < 0) {
+        perror("write");
+        return 1;
+    }
+    long deadline = now_ms() + timeout_ms;
+    int synced = 0;
+    while(!synced && read_frame(fd, &parser, deadline) > 0) {
+        synced = parser.frame.cmd == YuriRpcCommandHello &&
+                 (parser.frame.flags & YuriRpcFlagResponse);
+    }
+    if(!synced) {
+        fprintf(stderr, "no RPC hello from %s\n", argv[optind]);
+        return 2;
+    }
+    // A port that was in text mode answers hello twice, skip the second one
+    tcflush(fd, TCIFLUSH);
+    yuri_rpc_parser_reset(&parser);
+
+    // Send the whole batch in one write
+    static uint8_t batch[RPC_MAX_REQUESTS * (YURI_RPC_HEADER_SIZE + 5)];
+    size_t batch_len = 0;
+    for(size_t i = 0; i < count; i++) {
+        batch_len += yuri_rpc_encode(
+            batch + batch_len,
+            sizeof(batch) - batch_len,
+            (uint8_t)(i + 1),
+            requests[i].cmd,
+            0,
+            0,
+            requests[i].payload,
+            requests[i].len);
+    }
+    if(write_all(fd, batch, batch_len) < 0) {
+        perror("write");
+        return 1;
+    }
+
+    size_t pending = count;
+    int failed = 0;
+    deadline = now_ms() + timeout_ms;
+    while(pending) {
+        int ret = read_frame(fd, &parser, deadline);
+        if(ret <= 0) break;
+        const YuriRpcFrame* response = &parser.frame;
+        if(!(response->flags & YuriRpcFlagResponse) || response->seq == 0 ||
+           response->seq > count) {
+            continue;
+        }
+        Request* request = &requests[response->seq - 1];
+        if(request->done) continue;
+        print_response(response, log_out);
+        if(!(response->flags & YuriRpcFlagMore)) {
+            request->done = 1;
+            pending--;
+            if(response->status != YuriRpcStatusOk) failed = 1;
+        }
+        deadline = now_ms() + timeout_ms;
+    }
+    for(size_t i = 0; i < count; i++) {
+        if(!requests[i].done) {
+            printf(
+                "%zu %s timeout\n",
+                i + 1,
+                name_of(
+                    command_names,
+                    sizeof(command_names) / sizeof(command_names[0]),
+                    requests[i].cmd));
+            failed = 1;
+        }
+    }
+    if(parser.crc_errors) fprintf(stderr, "%u frames with bad CRC\n", parser.crc_errors);
+    close(fd);
+    return failed ? 3 : 0;
+}
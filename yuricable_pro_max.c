@@ -4,6 +4,15 @@
 #define BACKLIGHT_ON 1
 #define TAG "YURICABLE_PRO_MAX"
 #define SDQ_PIN gpio_ext_pa7 // GPIO 2
+// How often the session worker looks at the pin while a phone is attached
+#define SESSION_POLL_MS 100
+// A bulk /probe reports its progress on the bridge console every this many probes
+#define PROBE_PROGRESS_EVERY 1000
+
+// Indexed by SDQChargeIdentity
+static const char* const yuricable_charge_identity_names[] = {"Cable", "USB UART"};
+static const uint16_t yuricable_charge_limits[] = {500, 1000, CHARGE_SESSION_LIMIT_MAX_MA};
+static const char* const yuricable_charge_limit_names[] = {"500 mA", "1000 mA", "1400 mA"};
 
 const char* yuricable_get_submenu_title_string(YuriCableProMaxSubmenuTitles title) {
     if(title < YuriCableProMaxSubmenuTitlesCount) {
@@ -19,101 +28,1168 @@ static void yuricable_battery_info_update_model(void* ctx) {
     power_get_info(app->power, &app->info);
 }
 
-static void yuricable_draw_battery_consumption(Widget* widget, double cons) {
-    FuriString* string = furi_string_alloc_set("------------------------");
-    if(cons >= 0) {
-        furi_string_printf(string, "-- Battery Utilization");
-    } else if(cons < -1) {
-        furi_string_printf(string, "%1.1fk Battery Utilization", -cons);
-    } else {
-        furi_string_printf(string, "%3.f%% Battery Utilization", -(cons * 1000));
+/* Derive the LED state from the SDQ engine and the app. A connected bus without errors keeps
+ * whatever is currently shown, that is reported as YuriCableLedStateNone. */
+static YuriCableLedState yuricable_led_state(App* app) {
+    if(!app->config.led_enabled) {
+        return YuriCableLedStateOff;
+    }
+    SDQDeviceState sdq;
+    sdq_device_get_state(app->data->sdq, &sdq);
+    if(sdq.listening) {
+        if(sdq.resetInProgress) {
+            return YuriCableLedStateResetting;
+        } else if(!sdq.connected) {
+            return YuriCableLedStateWaiting;
+        } else if(sdq.error != SDQDeviceErrorNone) {
+            return YuriCableLedStateError;
+        }
+        return YuriCableLedStateNone;
+    } else if(app->data->ledMainMenu) {
+        return YuriCableLedStateIdle;
+    } else if(sdq.commandExecuted) {
+        return YuriCableLedStateExecuted;
+    }
+    return YuriCableLedStateIdle;
+}
+
+// Wakes the LED worker, safe to call from the SDQ interrupt
+static void yuricable_led_update(void* ctx) {
+    App* app = ctx;
+    furi_thread_flags_set(furi_thread_get_id(app->led_thread), LedEvtUpdate);
+}
+
+// SDQ state callback, wakes everything that follows the engine
+static void yuricable_state_changed(void* ctx) {
+    App* app = ctx;
+    yuricable_led_update(app);
+    furi_thread_flags_set(furi_thread_get_id(app->session_thread), SessionEvtUpdate);
+    furi_thread_flags_set(furi_thread_get_id(app->script_thread), ScriptEvtUpdate);
+}
+
+/* Hands the engine the operator just started to the production worker, which then rearms it
+ * for every following phone. Only the commands that finish on their own take part. */
+static void yuricable_production_arm(App* app) {
+    SDQDevice* sdq = app->data->sdq;
+    const SDQDeviceCommand command = sdq_device_get_command(sdq);
+    if(!app->config.auto_rearm || command < SDQDeviceCommand_DCSD ||
+       command > SDQDeviceCommand_DFU) {
+        return;
     }
-    widget_add_string_element(
-        widget, 20, 45, AlignLeft, AlignCenter, FontSecondary, furi_string_get_cstr(string));
-    furi_string_free(string);
+    furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+    production_begin(&app->production, app->config.unplug_quiet_ms);
+    production_arm(&app->production, sdq->sessions);
+    app->production_active = true;
+    furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+}
+
+/* Must come before the operator stops the engine, so the worker cannot start it again */
+static bool yuricable_production_disarm(App* app) {
+    furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+    const bool was_active = app->production_active;
+    app->production_active = false;
+    furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+    return was_active;
 }
 
 static int32_t yuricable_led_worker(void* ctx) {
     furi_assert(ctx);
     App* app = (App*)ctx;
+    YuriCableLedState applied = YuriCableLedStateNone;
     while(1) {
-        uint32_t events = furi_thread_flags_get();
-        if(events & WorkerEvtStop) {
+        uint32_t events =
+            furi_thread_flags_wait(LedEvtStop | LedEvtUpdate, FuriFlagWaitAny, FuriWaitForever);
+        if(events & FuriFlagError) {
+            continue;
+        }
+        if(events & LedEvtStop) {
             break;
         }
-        if(app->data->sdq->listening) {
-            if(app->data->sdq->resetInProgress) {
-                furi_hal_light_sequence("rgb G.g.G");
-            } else if(!app->data->sdq->connected) {
-                furi_hal_light_sequence("rgb B.b.B");
-            } else if(app->data->sdq->error != SDQDeviceErrorNone) {
-                furi_hal_light_sequence("rgb R.r.R");
-            }
-        } else if(app->data->ledMainMenu) {
-            furi_hal_light_set(LightRed, 255);
+        YuriCableLedState state = yuricable_led_state(app);
+        if(state == YuriCableLedStateNone || state == applied) {
+            continue;
+        }
+        applied = state;
+        switch(state) {
+        case YuriCableLedStateResetting:
+            furi_hal_light_sequence("rgb G.g.G");
+            break;
+        case YuriCableLedStateWaiting:
+            furi_hal_light_sequence("rgb B.b.B");
+            break;
+        case YuriCableLedStateError:
+            furi_hal_light_sequence("rgb R.r.R");
+            break;
+        case YuriCableLedStateOff:
+            furi_hal_light_set(LightRed, 0);
             furi_hal_light_set(LightGreen, 0);
-            furi_hal_light_set(LightBlue, 255);
-        } else if(app->data->sdq->commandExecuted) {
+            furi_hal_light_set(LightBlue, 0);
+            break;
+        case YuriCableLedStateExecuted:
             furi_hal_light_set(LightRed, 0);
             furi_hal_light_set(LightGreen, 255);
             furi_hal_light_set(LightBlue, 0);
-        } else {
+            break;
+        default:
             furi_hal_light_set(LightRed, 255);
             furi_hal_light_set(LightGreen, 0);
             furi_hal_light_set(LightBlue, 255);
+            break;
         }
     }
     return 0;
 }
 
+// Lock-free look at whether the SDQ engine is waiting for a phone
+static bool yuricable_listening(App* app) {
+    SDQDeviceState state;
+    sdq_device_get_state(app->data->sdq, &state);
+    return state.listening;
+}
+
+static bool yuricable_start(App* app) {
+    // The probe drives the same pin as the Tristar
+    if(yuricable_listening(app) || app->production_active || app->probe_running) {
+        return false;
+    }
+    sdq_device_start(app->data->sdq);
+    yuricable_production_arm(app);
+    // Its frame timer would wake the core every few ms
+    if(app->data->listeningAnimation && !app->data->sdq->low_power) {
+        icon_animation_start(app->data->listeningAnimation);
+    }
+    return true;
+}
+
+static bool yuricable_stop(App* app) {
+    // Between two phones the engine is stopped but production still watches the pin
+    const bool production = yuricable_production_disarm(app);
+    if(!yuricable_listening(app) && !production) {
+        return false;
+    }
+    sdq_device_stop(app->data->sdq);
+    if(app->data->listeningAnimation) {
+        icon_animation_stop(app->data->listeningAnimation);
+    }
+    return true;
+}
+
+static bool yuricable_set_mode(App* app, SDQDeviceCommand mode) {
+    switch(mode) {
+    case SDQDeviceCommand_DCSD:
+    case SDQDeviceCommand_RESET:
+    case SDQDeviceCommand_DFU:
+        sdq_device_post_command(app->data->sdq, mode);
+        yuricable_led_update(app);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Applies config.low_power to the engine, the figures start over when it changes
+static void yuricable_apply_low_power(App* app) {
+    SDQDevice* sdq = app->data->sdq;
+    furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+    if(sdq->low_power != (bool)app->config.low_power) {
+        sdq_device_set_low_power(sdq, app->config.low_power);
+        low_power_begin(&app->low_power, furi_get_tick(), sdq->wakes);
+    }
+    furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+}
+
+// Drains the SDQ trace one CSV record at a time, for /trace dump and save
+static size_t yuricable_trace_next(char* out, size_t size, void* ctx) {
+    SDQTrace* trace = ctx;
+    SDQTraceEntry entry;
+    if(!sdq_trace_take(trace, &entry)) {
+        return 0;
+    }
+    return sdq_trace_format(
+        trace, &entry, furi_hal_cortex_instructions_per_microsecond(), out, size);
+}
+
+// Relative names are looked up next to the logs
+static void yuricable_data_path(char* out, size_t size, const char* name) {
+    snprintf(
+        out,
+        size,
+        "%s%s%s",
+        name[0] == '/' ? "" : STORAGE_APP_DATA_PATH_PREFIX,
+        name[0] == '/' ? "" : "/",
+        name);
+}
+
+// Bridge reconfiguration has to happen outside the bridge threads, see YuriCableProMaxBridgeEvent
+static void yuricable_send_bridge_event(App* app, YuriCableProMaxBridgeEvent event) {
+    if(app->view_dispatcher) {
+        view_dispatcher_send_custom_event(app->view_dispatcher, event);
+    } else {
+        Event headless_event = {.type = EventTypeBridge, .custom_event = event};
+        furi_message_queue_put(app->queue, &headless_event, FuriWaitForever);
+    }
+}
+
 FuriString* yuricable_command_callback(char* command, void* ctx) {
     furi_assert(ctx);
     App* yuricable_context = ctx;
-    UNUSED(yuricable_context);
     if(strcmp(command, "start") == 0) {
-        if(yuricable_context->data->sdq->listening) {
+        if(!yuricable_start(yuricable_context)) {
             return furi_string_alloc_printf("already listening");
         }
-        sdq_device_start(yuricable_context->data->sdq);
-        icon_animation_start(yuricable_context->data->listeningAnimation);
         return furi_string_alloc_printf("started");
     }
     if(strcmp(command, "stop") == 0) {
-        if(!yuricable_context->data->sdq->listening) {
+        if(!yuricable_stop(yuricable_context)) {
             return furi_string_alloc_printf("already stopped");
         }
-        sdq_device_stop(yuricable_context->data->sdq);
-        icon_animation_stop(yuricable_context->data->listeningAnimation);
         return furi_string_alloc_printf("stopped");
     }
     if(strncmp(command, "mode", 4) == 0) {
         if(command[4] == ' ') {
             char* mode = command + 5;
             if(strcmp(mode, "dfu") == 0) {
-                yuricable_context->data->sdq->runCommand = SDQDeviceCommand_DFU;
-                yuricable_context->data->sdq->commandExecuted = false;
+                yuricable_set_mode(yuricable_context, SDQDeviceCommand_DFU);
                 return furi_string_alloc_printf("set mode dfu");
             }
             if(strcmp(mode, "reset") == 0) {
-                yuricable_context->data->sdq->runCommand = SDQDeviceCommand_RESET;
-                yuricable_context->data->sdq->commandExecuted = false;
+                yuricable_set_mode(yuricable_context, SDQDeviceCommand_RESET);
                 return furi_string_alloc_printf("set mode reset");
             }
             if(strcmp(mode, "dcsd") == 0) {
-                yuricable_context->data->sdq->runCommand = SDQDeviceCommand_DCSD;
-                yuricable_context->data->sdq->commandExecuted = false;
+                yuricable_set_mode(yuricable_context, SDQDeviceCommand_DCSD);
                 return furi_string_alloc_printf("set mode dcsd");
             }
         }
         return furi_string_alloc_printf("use: /mode <dfu | reset | dcsd>");
     }
+    if(strncmp(command, "stats", 5) == 0) {
+        UsbUartBridge* bridge = yuricable_context->data->sdq->uart_bridge;
+        if(strcmp(command + 5, " reset") == 0) {
+            usb_uart_reset_state(bridge);
+            return furi_string_alloc_printf("stats reset");
+        }
+        UsbUartState st;
+        usb_uart_get_state(bridge, &st);
+        FuriString* stats = furi_string_alloc_printf(
+            "rx %lu tx %lu dropped %lu packets %lu\r\nlatency p50 %luus p99 %luus\r\ncpu %lu cycles/byte",
+            st.rx_cnt,
+            st.tx_cnt,
+            st.rx_dropped,
+            st.cdc_packets,
+            usb_uart_state_latency_percentile(&st, 50),
+            usb_uart_state_latency_percentile(&st, 99),
+            st.rx_cnt ? (uint32_t)(st.busy_cycles / st.rx_cnt) : 0UL);
+        if(st.aux_baudrate_cur) {
+            furi_string_cat_printf(
+                stats,
+                "\r\nuart2 %lu baud rx %lu dropped %lu",
+                st.aux_baudrate_cur,
+                st.aux_rx_cnt,
+                st.aux_rx_dropped);
+        }
+        SDQDevice* sdq = yuricable_context->data->sdq;
+        furi_string_cat_printf(
+            stats,
+            "\r\nsdq sessions %lu resyncs %lu recovered %lu",
+            sdq->sessions,
+            sdq->resyncs,
+            sdq->resyncs_recovered);
+        return stats;
+    }
+    if(strcmp(command, "timeline") == 0) {
+        char report[128];
+        if(!usb_uart_get_timeline(yuricable_context->data->sdq->uart_bridge, report, sizeof(report))) {
+            return furi_string_alloc_printf("no boot recorded yet");
+        }
+        return furi_string_alloc_printf("%s", report);
+    }
+    if(strncmp(command, "filter", 6) == 0) {
+        UsbUartBridge* bridge = yuricable_context->data->sdq->uart_bridge;
+        char* arg = command + 6;
+        if(arg[0] == 0) {
+            char description[256];
+            usb_uart_filter_describe(bridge, description, sizeof(description));
+            return furi_string_alloc_printf("%s", description);
+        }
+        if(strcmp(arg, " clear") == 0) {
+            usb_uart_filter_clear(bridge);
+            return furi_string_alloc_printf("filter cleared");
+        }
+        if(strncmp(arg, " rate ", 6) == 0) {
+            uint32_t rate = strtoul(arg + 6, NULL, 10);
+            if(rate > LINE_FILTER_RATE_MAX) {
+                return furi_string_alloc_printf("rate has to be 0 to %u lines/s", LINE_FILTER_RATE_MAX);
+            }
+            usb_uart_filter_set_rate(bridge, rate);
+            return furi_string_alloc_printf("rate limit %lu lines/s", rate);
+        }
+        if(arg[0] == ' ' && (arg[1] == '+' || arg[1] == '-')) {
+            if(!usb_uart_filter_add(bridge, arg + 2, arg[1] == '-')) {
+                return furi_string_alloc_printf("no room for another pattern");
+            }
+            return furi_string_alloc_printf("%s lines with '%s'", arg[1] == '-' ? "dropping" : "keeping", arg + 2);
+        }
+        return furi_string_alloc_printf("use: /filter [+text | -text | rate <lines/s> | clear]");
+    }
+    if(strncmp(command, "uart2", 5) == 0) {
+        if(strcmp(command + 5, " off") == 0) {
+            yuricable_context->data->auxBaudrate = 0;
+        } else if(command[5] == ' ' && strtoul(command + 6, NULL, 10) > 0) {
+            yuricable_context->data->auxBaudrate = strtoul(command + 6, NULL, 10);
+        } else {
+            return furi_string_alloc_printf("use: /uart2 <baudrate | off>");
+        }
+        yuricable_send_bridge_event(yuricable_context, YuriCableProMaxBridgeAuxEvent);
+        if(yuricable_context->data->auxBaudrate == 0) {
+            return furi_string_alloc_printf("second uart off");
+        }
+        return furi_string_alloc_printf(
+            "capturing second uart at %lu baud, output is tagged frames now",
+            yuricable_context->data->auxBaudrate);
+    }
+    if(strncmp(command, "split", 5) == 0) {
+        if(strcmp(command + 5, " on") == 0) {
+            // Split takes the first serial port away from the Flipper CLI driving headless mode
+            if(!yuricable_context->view_dispatcher) {
+                return furi_string_alloc_printf("split is not available headless");
+            }
+            yuricable_send_bridge_event(yuricable_context, YuriCableProMaxBridgeSplitOnEvent);
+            return furi_string_alloc_printf("commands move to the first serial port");
+        }
+        if(strcmp(command + 5, " off") == 0) {
+            yuricable_send_bridge_event(yuricable_context, YuriCableProMaxBridgeSplitOffEvent);
+            return furi_string_alloc_printf("commands move back to this port");
+        }
+        return furi_string_alloc_printf("use: /split <on | off>");
+    }
+    if(strncmp(command, "config", 6) == 0) {
+        YuriCableConfig* config = &yuricable_context->config;
+        char* arg = command + 6;
+        if(strcmp(arg, " save") == 0) {
+            // The bridge may have been reconfigured by /split or /uart2 since startup
+            if(yuricable_context->data->sdq->uart_bridge) {
+                usb_uart_get_config(yuricable_context->data->sdq->uart_bridge, &config->bridge);
+            }
+            if(!yuricable_config_save(config)) {
+                return furi_string_alloc_printf("saving config failed");
+            }
+            return furi_string_alloc_printf("config saved");
+        }
+        if(strcmp(arg, " reset") == 0) {
+            yuricable_config_defaults(config);
+            sdq_device_set_timings(yuricable_context->data->sdq, &config->timings);
+            yuricable_apply_low_power(yuricable_context);
+            if(!yuricable_config_save(config)) {
+                return furi_string_alloc_printf("saving config failed");
+            }
+            return furi_string_alloc_printf("defaults saved, bridge settings apply on next start");
+        }
+        if(strcmp(arg, " led on") == 0 || strcmp(arg, " led off") == 0) {
+            config->led_enabled = strcmp(arg, " led on") == 0;
+            yuricable_led_update(yuricable_context);
+            return furi_string_alloc_printf("led %s", config->led_enabled ? "on" : "off");
+        }
+        if(strncmp(arg, " mode ", 6) == 0) {
+            const char* modes[] = {"none", "dcsd", "reset", "dfu"};
+            for(uint8_t i = 0; i < COUNT_OF(modes); i++) {
+                if(strcmp(arg + 6, modes[i]) == 0) {
+                    config->default_mode = i;
+                    return furi_string_alloc_printf("default mode %s", modes[i]);
+                }
+            }
+            return furi_string_alloc_printf("use: /config mode <none | dcsd | reset | dfu>");
+        }
+        if(strncmp(arg, " sdq ", 5) == 0) {
+            char* name = arg + 5;
+            char* value = strchr(name, ' ');
+            if(value) {
+                *value++ = 0;
+                // The configured windows, a profile only overrides them inside its session
+                if(yuricable_config_set_timing(
+                       &config->timings, name, strtoul(value, NULL, 10))) {
+                    sdq_device_set_timings(yuricable_context->data->sdq, &config->timings);
+                    return furi_string_alloc_printf("%s set, /config save keeps it", name);
+                }
+            }
+            return furi_string_alloc_printf("use: /config sdq <timing> <us>");
+        }
+        if(arg[0] == 0) {
+            UsbUartConfig bridge = config->bridge;
+            if(yuricable_context->data->sdq->uart_bridge) {
+                usb_uart_get_config(yuricable_context->data->sdq->uart_bridge, &bridge);
+            }
+            char timings[512];
+            yuricable_config_describe_timings(&config->timings, timings, sizeof(timings));
+            return furi_string_alloc_printf(
+                "baudrate %lu uart2 %lu split %u mode %u led %u\r\n%s",
+                bridge.baudrate,
+                bridge.aux_baudrate,
+                bridge.ctrl_split,
+                config->default_mode,
+                config->led_enabled,
+                timings);
+        }
+        return furi_string_alloc_printf(
+            "use: /config [save | reset | led <on | off> | mode <m> | sdq <timing> <us>]");
+    }
+    if(strncmp(command, "inject", 6) == 0) {
+        YuriCableData* data = yuricable_context->data;
+        char* arg = command + 6;
+        if(arg[0] == 0) {
+            uint32_t sent = 0;
+            uint32_t total = 0;
+            const bool running = usb_uart_inject_progress(data->sdq->uart_bridge, &sent, &total);
+            return furi_string_alloc_printf(
+                "%s %lu/%lu bytes", running ? "injecting" : "idle", sent, total);
+        }
+        if(strcmp(arg, " stop") == 0) {
+            yuricable_send_bridge_event(yuricable_context, YuriCableProMaxBridgeInjectStopEvent);
+            return furi_string_alloc_printf("injection stopped");
+        }
+        if(arg[0] == ' ' && arg[1] != 0) {
+            char* path = arg + 1;
+            char* pacing = strchr(path, ' ');
+            UsbUartInjectPacing inject = {0};
+            if(pacing) {
+                *pacing++ = 0;
+                if(strncmp(pacing, "rate ", 5) == 0) {
+                    inject.byte_rate = strtoul(pacing + 5, NULL, 10);
+                } else if(strncmp(pacing, "delay ", 6) == 0) {
+                    // Short bursts so consoles without flow control catch up in the gaps
+                    inject.delay_ms = strtoul(pacing + 6, NULL, 10);
+                    inject.chunk = 64;
+                } else {
+                    return furi_string_alloc_printf("use: /inject <file> [rate <bytes/s> | delay <ms>]");
+                }
+            }
+            yuricable_data_path(data->injectPath, sizeof(data->injectPath), path);
+            data->injectPacing = inject;
+            yuricable_send_bridge_event(yuricable_context, YuriCableProMaxBridgeInjectEvent);
+            return furi_string_alloc_printf("injecting %s", data->injectPath);
+        }
+        return furi_string_alloc_printf("use: /inject <file> [rate <bytes/s> | delay <ms>] | stop");
+    }
+    if(strncmp(command, "script", 6) == 0) {
+        App* app = yuricable_context;
+        const char* arg = command + 6;
+        if(strncmp(arg, " run ", 5) == 0 && arg[5] != 0) {
+            char path[128];
+            char error[64];
+            yuricable_data_path(path, sizeof(path), arg + 5);
+            YuriScript* script = yuri_script_load(path, error, sizeof(error));
+            if(!script) {
+                return furi_string_alloc_printf("%s", error);
+            }
+            furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+            const bool busy = app->script_running;
+            if(!busy) {
+                app->script_pending = script;
+                app->script_running = true;
+                strcpy(app->script_name, script->name);
+                app->script_line = 0;
+            }
+            furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+            if(busy) {
+                yuri_script_free(script);
+                return furi_string_alloc_printf("a script is running, /script stop first");
+            }
+            furi_thread_flags_set(furi_thread_get_id(app->script_thread), ScriptEvtRun);
+            return furi_string_alloc_printf(
+                "running %s, %u steps", script->name, script->count);
+        }
+        if(strcmp(arg, " stop") == 0) {
+            furi_thread_flags_set(furi_thread_get_id(app->script_thread), ScriptEvtStop);
+            return furi_string_alloc_printf("script stopped");
+        }
+        if(arg[0] == 0) {
+            furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+            FuriString* status =
+                app->script_running ?
+                    furi_string_alloc_printf(
+                        "%s running, line %u", app->script_name, app->script_line) :
+                    furi_string_alloc_printf(
+                        "no script running%s%s",
+                        app->script_result[0] ? ", last: " : "",
+                        app->script_result);
+            furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+            return status;
+        }
+        return furi_string_alloc_printf("use: /script [run <file> | stop]");
+    }
+    if(strncmp(command, "probe", 5) == 0) {
+        const char* arg = command + 5;
+        furi_check(
+            furi_mutex_acquire(yuricable_context->mutex, FuriWaitForever) == FuriStatusOk);
+        const bool running = yuricable_context->probe_running;
+        FuriString* reply = NULL;
+        if(strcmp(arg, " status") == 0) {
+            reply = running ? furi_string_alloc_printf(
+                                  "probing %lu/%lu, %lu ok",
+                                  yuricable_context->probe_done,
+                                  yuricable_context->probe_count,
+                                  yuricable_context->probe_ok) :
+                              furi_string_alloc_set_str(
+                                  furi_string_get_cstr(yuricable_context->probe_report));
+        } else if(strcmp(arg, " stop") == 0) {
+            yuricable_context->probe_stop = true;
+            reply = furi_string_alloc_printf(running ? "probe stopping" : "no probe running");
+        } else if(running) {
+            reply = furi_string_alloc_printf("probe running, /probe status or /probe stop");
+        }
+        furi_check(furi_mutex_release(yuricable_context->mutex) == FuriStatusOk);
+        if(reply) {
+            return reply;
+        }
+        if(yuricable_listening(yuricable_context)) {
+            return furi_string_alloc_printf("the pin is listening for a phone, /stop first");
+        }
+        const uint32_t count = arg[0] == ' ' ? strtoul(arg + 1, NULL, 10) : 1;
+        if(count == 0 || count > 10000) {
+            return furi_string_alloc_printf("use: /probe [count up to 10000 | status | stop]");
+        }
+        // A bulk run takes seconds, the command thread also carries the bridge traffic
+        furi_thread_join(yuricable_context->probe_thread);
+        furi_check(
+            furi_mutex_acquire(yuricable_context->mutex, FuriWaitForever) == FuriStatusOk);
+        yuricable_context->probe_running = true;
+        yuricable_context->probe_stop = false;
+        yuricable_context->probe_count = count;
+        yuricable_context->probe_done = 0;
+        yuricable_context->probe_ok = 0;
+        furi_check(furi_mutex_release(yuricable_context->mutex) == FuriStatusOk);
+        furi_thread_start(yuricable_context->probe_thread);
+        return furi_string_alloc_printf(
+            "probing %lu time%s, the report follows here and in /probe status",
+            count,
+            count == 1 ? "" : "s");
+    }
+    if(strncmp(command, "production", 10) == 0) {
+        YuriCableConfig* config = &yuricable_context->config;
+        char* arg = command + 10;
+        if(strcmp(arg, " on") == 0 || strcmp(arg, " off") == 0) {
+            config->auto_rearm = strcmp(arg, " on") == 0;
+            return furi_string_alloc_printf(
+                "auto rearm %s from the next /start, /config save keeps it",
+                config->auto_rearm ? "on" : "off");
+        }
+        if(strncmp(arg, " quiet ", 7) == 0) {
+            const uint32_t quiet_ms = strtoul(arg + 7, NULL, 10);
+            if(quiet_ms == 0 || quiet_ms > UINT16_MAX) {
+                return furi_string_alloc_printf("quiet has to be 1 to %u ms", UINT16_MAX);
+            }
+            config->unplug_quiet_ms = quiet_ms;
+            return furi_string_alloc_printf("unplugged after %u ms without SDQ traffic", config->unplug_quiet_ms);
+        }
+        if(arg[0] == 0) {
+            const ProductionRun* run = &yuricable_context->production;
+            return furi_string_alloc_printf(
+                "auto rearm %s%s, quiet %u ms\r\nphones %lu passed %lu avg %lu ms",
+                config->auto_rearm ? "on" : "off",
+                yuricable_context->production_active ? " and running" : "",
+                config->unplug_quiet_ms,
+                run->phones,
+                run->passed,
+                run->passed ? (uint32_t)(run->work_ms_sum / run->passed) : 0UL);
+        }
+        return furi_string_alloc_printf("use: /production [on | off | quiet <ms>]");
+    }
+    if(strncmp(command, "lowpower", 8) == 0) {
+        SDQDevice* sdq = yuricable_context->data->sdq;
+        char* arg = command + 8;
+        if(strcmp(arg, " on") == 0 || strcmp(arg, " off") == 0) {
+            yuricable_context->config.low_power = strcmp(arg, " on") == 0;
+            yuricable_apply_low_power(yuricable_context);
+            return furi_string_alloc_printf(
+                "low-power wait %s, /config save keeps it",
+                sdq->low_power ? "on" : "off");
+        }
+        if(arg[0] == 0) {
+            char stats[96];
+            furi_check(
+                furi_mutex_acquire(yuricable_context->mutex, FuriWaitForever) == FuriStatusOk);
+            low_power_format(&yuricable_context->low_power, stats, sizeof(stats));
+            furi_check(furi_mutex_release(yuricable_context->mutex) == FuriStatusOk);
+            return furi_string_alloc_printf(
+                "low-power wait %s%s\r\n%s",
+                sdq->low_power ? "on" : "off",
+                sdq->awake ? ", awake" : "",
+                stats);
+        }
+        return furi_string_alloc_printf("use: /lowpower [on | off]");
+    }
+    if(strncmp(command, "charge", 6) == 0) {
+        YuriCableConfig* config = &yuricable_context->config;
+        SDQDevice* sdq = yuricable_context->data->sdq;
+        char* arg = command + 6;
+        if(strcmp(arg, " cable") == 0 || strcmp(arg, " uart") == 0) {
+            config->charge_identity =
+                strcmp(arg, " cable") == 0 ? SDQChargeIdentityCable : SDQChargeIdentityUsbUart;
+            sdq->charge_identity = config->charge_identity;
+            return furi_string_alloc_printf(
+                "charging as %s from the next poll, /config save keeps it",
+                yuricable_charge_identity_names[sdq->charge_identity]);
+        }
+        if(strncmp(arg, " limit ", 7) == 0) {
+            const uint32_t limit_ma = strtoul(arg + 7, NULL, 10);
+            if(limit_ma < CHARGE_SESSION_IDLE_MA || limit_ma > CHARGE_SESSION_LIMIT_MAX_MA) {
+                return furi_string_alloc_printf(
+                    "limit has to be %u to %u mA", CHARGE_SESSION_IDLE_MA, CHARGE_SESSION_LIMIT_MAX_MA);
+            }
+            config->charge_limit_ma = limit_ma;
+            return furi_string_alloc_printf("limit %u mA from the next charging session", config->charge_limit_ma);
+        }
+        if(arg[0] == 0) {
+            FuriString* report = furi_string_alloc_printf(
+                "identity %s, limit %u mA\r\npower requests %lu, last %02X %02X",
+                yuricable_charge_identity_names[sdq->charge_identity],
+                config->charge_limit_ma,
+                sdq->power_requests,
+                sdq->power_request[0],
+                sdq->power_request[1]);
+            // The session belongs to the battery worker, a torn read only skews one figure
+            const ChargeSession* session = &yuricable_context->charge_session;
+            if(yuricable_context->charging_active) {
+                furi_string_cat_printf(
+                    report,
+                    "\r\npeak %u mA, best tail %u mA of %u: %s",
+                    session->peak_ma,
+                    session->best_tail_ma,
+                    session->limit_ma,
+                    session->cut ? "5V off" :
+                                   charge_session_draw_name(charge_session_draw(session)));
+            }
+            return report;
+        }
+        return furi_string_alloc_printf("use: /charge [cable | uart | limit <mA>]");
+    }
+    if(strncmp(command, "trace", 5) == 0) {
+        SDQDevice* sdq = yuricable_context->data->sdq;
+        SDQTrace* trace = &yuricable_context->trace;
+        char* arg = command + 5;
+        if(strcmp(arg, " on") == 0 || strcmp(arg, " off") == 0) {
+            sdq->trace = strcmp(arg, " on") == 0 ? trace : NULL;
+            return furi_string_alloc_printf("trace %s", sdq->trace ? "on" : "off");
+        }
+        // The ring has a single reader, the CLI and the bridge take turns
+        if(strcmp(arg, " clear") == 0) {
+            furi_check(
+                furi_mutex_acquire(yuricable_context->mutex, FuriWaitForever) == FuriStatusOk);
+            sdq_trace_reset(trace);
+            furi_check(furi_mutex_release(yuricable_context->mutex) == FuriStatusOk);
+            return furi_string_alloc_printf("trace cleared");
+        }
+        if(strcmp(arg, " save") == 0) {
+            furi_check(
+                furi_mutex_acquire(yuricable_context->mutex, FuriWaitForever) == FuriStatusOk);
+            const uint32_t lost = trace->lost;
+            const bool saved = log_saver_append_records(
+                SDQ_TRACE_LOG_NAME, SDQ_TRACE_LOG_HEADER, yuricable_trace_next, trace);
+            const uint32_t lost_now = trace->lost - lost;
+            furi_check(furi_mutex_release(yuricable_context->mutex) == FuriStatusOk);
+            if(!saved) {
+                return furi_string_alloc_printf("saving trace failed");
+            }
+            return furi_string_alloc_printf(
+                "trace appended to %s, %lu lost", SDQ_TRACE_LOG_NAME, lost_now);
+        }
+        if(strncmp(arg, " dump", 5) == 0) {
+            // A bounded batch per call keeps the reply small, repeat until it is empty
+            uint32_t count = arg[5] == ' ' ? strtoul(arg + 6, NULL, 10) : 32;
+            FuriString* dump = furi_string_alloc_printf("%s", SDQ_TRACE_LOG_HEADER + 5);
+            char line[64];
+            furi_check(
+                furi_mutex_acquire(yuricable_context->mutex, FuriWaitForever) == FuriStatusOk);
+            while(count-- && yuricable_trace_next(line, sizeof(line), trace)) {
+                furi_string_cat_printf(dump, "\r\n%s", line);
+            }
+            furi_check(furi_mutex_release(yuricable_context->mutex) == FuriStatusOk);
+            return dump;
+        }
+        if(arg[0] == 0) {
+            return furi_string_alloc_printf(
+                "trace %s, %lu pending, %lu lost",
+                sdq->trace ? "on" : "off",
+                trace->head - trace->tail > SDQ_TRACE_COUNT - 1 ? SDQ_TRACE_COUNT - 1 :
+                                                                 trace->head - trace->tail,
+                trace->lost);
+        }
+        return furi_string_alloc_printf("use: /trace [on | off | dump [n] | save | clear]");
+    }
+    if(strcmp(command, "profile") == 0) {
+        const SDQProfileTable* table = yuricable_context->profiles;
+        const SDQProfile* active = yuricable_context->data->sdq->profile;
+        if(!table) {
+            return furi_string_alloc_printf("no profiles loaded");
+        }
+        FuriString* list = furi_string_alloc_printf("active %s", active ? active->name : "none");
+        for(uint8_t i = 0; i < table->count; i++) {
+            furi_string_cat_printf(
+                list, "\r\n%s key %04X", table->profiles[i].name, table->profiles[i].key);
+        }
+        return list;
+    }
     if(strncmp(command, "help", 4) == 0) {
         return furi_string_alloc_printf(
-            "commands:\r\n/start\r\n/stop\r\n/mode <dfu | reset | dcsd>");
+            "commands:\r\n/start\r\n/stop\r\n/mode <dfu | reset | dcsd>\r\n/stats [reset]\r\n/timeline\r\n/filter [+text | -text | rate <n> | clear]\r\n/uart2 <baudrate | off>\r\n/split <on | off>\r\n/config [save | reset | led <on | off> | mode <m> | sdq <timing> <us>]\r\n/profile\r\n/inject [<file> [rate <n> | delay <ms>] | stop]\r\n/probe [count | status | stop]\r\n/production [on | off | quiet <ms>]\r\n/lowpower [on | off]\r\n/charge [cable | uart | limit <mA>]\r\n/trace [on | off | dump [n] | save | clear]\r\n/script [run <file> | stop]\r\n/rpc");
     }
     return furi_string_alloc_printf("%s is no valid command", command);
 }
 
+static void yuricable_rpc_callback(UsbUartBridge* bridge, const YuriRpcFrame* request, void* ctx) {
+    furi_assert(ctx);
+    App* app = ctx;
+    SDQDevice* sdq = app->data->sdq;
+    uint8_t payload[YURI_RPC_MAX_PAYLOAD];
+    switch(request->cmd) {
+    case YuriRpcCommandStart:
+        usb_uart_rpc_reply(
+            bridge, request, 0, yuricable_start(app) ? YuriRpcStatusOk : YuriRpcStatusBusy, NULL, 0);
+        break;
+    case YuriRpcCommandStop:
+        usb_uart_rpc_reply(
+            bridge, request, 0, yuricable_stop(app) ? YuriRpcStatusOk : YuriRpcStatusBusy, NULL, 0);
+        break;
+    case YuriRpcCommandMode:
+        if(request->len == 1 && yuricable_set_mode(app, request->payload[0])) {
+            usb_uart_rpc_reply(bridge, request, 0, YuriRpcStatusOk, NULL, 0);
+        } else {
+            usb_uart_rpc_reply(bridge, request, 0, YuriRpcStatusInvalidArgument, NULL, 0);
+        }
+        break;
+    case YuriRpcCommandStatus: {
+        SDQDeviceState state;
+        sdq_device_get_state(sdq, &state);
+        payload[0] = state.listening;
+        payload[1] = state.connected;
+        payload[2] = state.resetInProgress;
+        payload[3] = state.commandExecuted;
+        payload[4] = state.error;
+        payload[5] = sdq_device_get_command(sdq);
+        usb_uart_rpc_reply(bridge, request, 0, YuriRpcStatusOk, payload, 6);
+        break;
+    }
+    case YuriRpcCommandStats: {
+        UsbUartState st;
+        usb_uart_get_state(bridge, &st);
+        yuri_rpc_put_u32(payload + 0, st.rx_cnt);
+        yuri_rpc_put_u32(payload + 4, st.tx_cnt);
+        yuri_rpc_put_u32(payload + 8, st.baudrate_cur);
+        yuri_rpc_put_u32(payload + 12, st.rx_dropped);
+        yuri_rpc_put_u32(payload + 16, st.cdc_packets);
+        yuri_rpc_put_u32(payload + 20, usb_uart_state_latency_percentile(&st, 50));
+        yuri_rpc_put_u32(payload + 24, usb_uart_state_latency_percentile(&st, 99));
+        yuri_rpc_put_u32(payload + 28, st.rx_cnt ? (uint32_t)(st.busy_cycles / st.rx_cnt) : 0);
+        usb_uart_rpc_reply(bridge, request, 0, YuriRpcStatusOk, payload, 32);
+        break;
+    }
+    case YuriRpcCommandLog: {
+        size_t offset = request->len >= 4 ? yuri_rpc_get_u32(request->payload) : 0;
+        uint8_t port = request->len >= 5 ? request->payload[4] : 0;
+        if(port > 1) {
+            usb_uart_rpc_reply(bridge, request, 0, YuriRpcStatusInvalidArgument, NULL, 0);
+            break;
+        }
+        size_t len;
+        bool queued = true;
+        while(queued &&
+              (len = usb_uart_log_read(bridge, port, offset, (char*)payload, sizeof(payload))) > 0) {
+            // A frame cut short already ended the request with an error
+            queued =
+                usb_uart_rpc_reply(bridge, request, YuriRpcFlagMore, YuriRpcStatusOk, payload, len);
+            offset += len;
+        }
+        if(queued) {
+            usb_uart_rpc_reply(bridge, request, 0, YuriRpcStatusOk, NULL, 0);
+        }
+        break;
+    }
+    default:
+        usb_uart_rpc_reply(bridge, request, 0, YuriRpcStatusUnknownCommand, NULL, 0);
+        break;
+    }
+}
+
+/* Bridge worker. Runs the main UART through the pattern of the expect step while one is armed,
+ * so the script worker sleeps until the pattern is complete. */
+static void yuricable_script_rx(const uint8_t* data, size_t len, void* ctx) {
+    App* app = ctx;
+    if(!app->script_armed) {
+        return;
+    }
+    furi_check(furi_mutex_acquire(app->script_mutex, FuriWaitForever) == FuriStatusOk);
+    for(size_t i = 0; app->script_armed && i < len; i++) {
+        if(stream_match_feed(&app->script_match, data[i])) {
+            app->script_armed = false;
+            furi_thread_flags_set(furi_thread_get_id(app->script_thread), ScriptEvtMatch);
+        }
+    }
+    furi_check(furi_mutex_release(app->script_mutex) == FuriStatusOk);
+}
+
+/* The bridge switches USB to the dual CDC config and runs two threads, so it is only brought up
+ * when something needs the UART: the DCSD scene, a script or the Always and Keep Warm policy.
+ * Each of them holds a reference until yuricable_bridge_release. Must not be called from the
+ * bridge threads. */
+static UsbUartBridge* yuricable_bridge_acquire(App* app) {
+    SDQDevice* sdq = app->data->sdq;
+    furi_check(furi_mutex_acquire(app->bridge_mutex, FuriWaitForever) == FuriStatusOk);
+    if(!sdq->uart_bridge) {
+        UsbUartConfig bridgeConfig = app->config.bridge;
+        UsbUartBridge* uartBridge = usb_uart_enable(&bridgeConfig);
+        usb_uart_set_command_callback(uartBridge, yuricable_command_callback, app);
+        usb_uart_set_rpc_callback(uartBridge, yuricable_rpc_callback, app);
+        usb_uart_set_rx_callback(uartBridge, yuricable_script_rx, app);
+        sdq->uart_bridge = uartBridge;
+    }
+    app->bridge_refs++;
+    // Keep Warm holds a reference of its own from the first start on
+    if(app->config.bridge_policy == YuriCableBridgeKeepWarm && !app->bridge_pinned) {
+        app->bridge_pinned = true;
+        app->bridge_refs++;
+    }
+    UsbUartBridge* uartBridge = sdq->uart_bridge;
+    furi_check(furi_mutex_release(app->bridge_mutex) == FuriStatusOk);
+    return uartBridge;
+}
+
+// A reference like acquire, but only if the bridge already runs, NULL leaves USB alone
+static UsbUartBridge* yuricable_bridge_hold(App* app) {
+    furi_check(furi_mutex_acquire(app->bridge_mutex, FuriWaitForever) == FuriStatusOk);
+    UsbUartBridge* uartBridge = app->data->sdq->uart_bridge;
+    if(uartBridge) {
+        app->bridge_refs++;
+    }
+    furi_check(furi_mutex_release(app->bridge_mutex) == FuriStatusOk);
+    return uartBridge;
+}
+
+/* Drops a reference, the last one stops the bridge, force is for app exit. The SDQ interrupt
+ * runs to completion, so once the pointer is cleared it no longer touches the bridge. */
+static void yuricable_bridge_release(App* app, bool force) {
+    SDQDevice* sdq = app->data->sdq;
+    furi_check(furi_mutex_acquire(app->bridge_mutex, FuriWaitForever) == FuriStatusOk);
+    if(app->bridge_refs) {
+        app->bridge_refs--;
+    }
+    if(sdq->uart_bridge && (force || !app->bridge_refs)) {
+        UsbUartBridge* uartBridge = sdq->uart_bridge;
+        sdq->uart_bridge = NULL;
+        app->bridge_refs = 0;
+        // Keep /split and /uart2 changes for the next start
+        usb_uart_get_config(uartBridge, &app->config.bridge);
+        usb_uart_disable(uartBridge);
+    }
+    furi_check(furi_mutex_release(app->bridge_mutex) == FuriStatusOk);
+}
+
+// Takes or drops the one reference a long-lived user keeps in `held`
+static void yuricable_bridge_keep(App* app, bool* held, bool keep) {
+    furi_check(furi_mutex_acquire(app->bridge_mutex, FuriWaitForever) == FuriStatusOk);
+    if(keep && !*held) {
+        yuricable_bridge_acquire(app);
+    } else if(!keep && *held) {
+        yuricable_bridge_release(app, false);
+    }
+    *held = keep;
+    furi_check(furi_mutex_release(app->bridge_mutex) == FuriStatusOk);
+}
+
+static void yuricable_script_arm(App* app, const char* pattern) {
+    furi_check(furi_mutex_acquire(app->script_mutex, FuriWaitForever) == FuriStatusOk);
+    if(pattern) {
+        stream_match_init(&app->script_match, pattern);
+    }
+    app->script_armed = pattern != NULL;
+    furi_thread_flags_clear(ScriptEvtMatch);
+    furi_check(furi_mutex_release(app->script_mutex) == FuriStatusOk);
+}
+
+/* Sleeps on the worker flags until one of `flags` or the deadline, 0 once that passed. Stop and
+ * exit always wake it. */
+static uint32_t yuricable_script_wait(uint32_t flags, uint32_t deadline) {
+    const int32_t left = (int32_t)(deadline - furi_get_tick());
+    if(left <= 0) {
+        return 0;
+    }
+    const uint32_t events = furi_thread_flags_wait(
+        flags | ScriptEvtStop | ScriptEvtExit, FuriFlagWaitAny, furi_ms_to_ticks(left));
+    return (events & FuriFlagError) ? 0 : events;
+}
+
+static bool yuricable_script_executed(App* app) {
+    SDQDeviceState state;
+    sdq_device_get_state(app->data->sdq, &state);
+    return state.commandExecuted;
+}
+
+static void yuricable_script_log(App* app, uint32_t start, const char* event, const char* detail) {
+    char record[128];
+    snprintf(
+        record,
+        sizeof(record),
+        "%s,%lu,%s,%s",
+        app->script_name,
+        furi_get_tick() - start,
+        event,
+        detail);
+    log_saver_append_record(YURI_SCRIPT_LOG_NAME, YURI_SCRIPT_LOG_HEADER, record);
+}
+
+/* Steps through a compiled script until it passes, fails or is stopped. The pattern of an
+ * expect is armed while the step before it runs, so the answer to a send cannot slip past.
+ * False when the app is exiting. */
+static bool yuricable_script_run(App* app, const YuriScript* script) {
+    SDQDevice* sdq = app->data->sdq;
+    const uint32_t start = furi_get_tick();
+    uint16_t pc = 0;
+    uint16_t armed = YURI_SCRIPT_NO_JUMP;
+    const char* event = NULL;
+    char detail[64] = "";
+    bool exit = false;
+    // Held until the script is over, the scene may let go of the bridge meanwhile
+    UsbUartBridge* bridge = NULL;
+    furi_thread_flags_clear(ScriptEvtStop | ScriptEvtMatch | ScriptEvtUpdate);
+    while(!event) {
+        if(pc >= script->count) {
+            event = "pass";
+            break;
+        }
+        const YuriScriptInsn* insn = &script->code[pc];
+        furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+        app->script_line = insn->line;
+        furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+        uint16_t expect = YURI_SCRIPT_NO_JUMP;
+        if(insn->op == YuriScriptOpExpect) {
+            expect = pc;
+        } else if(pc + 1 < script->count && script->code[pc + 1].op == YuriScriptOpExpect) {
+            expect = pc + 1;
+        }
+        if(expect != YURI_SCRIPT_NO_JUMP && expect != armed) {
+            yuricable_script_arm(app, yuri_script_string(script, &script->code[expect]));
+            armed = expect;
+        }
+        pc++;
+        // Steps that do not wait still notice /script stop
+        uint32_t events = furi_thread_flags_get() & (ScriptEvtStop | ScriptEvtExit);
+        switch(events ? YuriScriptOpCount : insn->op) {
+        case YuriScriptOpMode:
+            sdq_device_post_command(sdq, insn->arg);
+            yuricable_led_update(app);
+            break;
+        case YuriScriptOpStart:
+            // Like /start, DCSD hands the bridge to the engine
+            // Headless the script may run from the CLI, which a new USB config would cut off
+            if(!bridge && sdq_device_get_command(sdq) == SDQDeviceCommand_DCSD) {
+                bridge = app->view_dispatcher ? yuricable_bridge_acquire(app) :
+                                                yuricable_bridge_hold(app);
+            }
+            yuricable_start(app);
+            break;
+        case YuriScriptOpStop:
+            yuricable_stop(app);
+            break;
+        case YuriScriptOpAwait: {
+            // Every engine state change wakes the worker, the snapshot tells if it was this one
+            const uint32_t deadline = furi_get_tick() + insn->value;
+            while(!yuricable_script_executed(app)) {
+                events = yuricable_script_wait(ScriptEvtUpdate, deadline);
+                if(!events || (events & (ScriptEvtStop | ScriptEvtExit))) break;
+            }
+            break;
+        }
+        case YuriScriptOpExpect:
+            events = yuricable_script_wait(ScriptEvtMatch, furi_get_tick() + insn->value);
+            armed = YURI_SCRIPT_NO_JUMP;
+            break;
+        case YuriScriptOpSend:
+        case YuriScriptOpInject:
+            if(!bridge) {
+                bridge = yuricable_bridge_hold(app);
+            }
+            if(!bridge) {
+                event = "fail";
+                snprintf(detail, sizeof(detail), "line %u: UART bridge is off", insn->line);
+            } else if(insn->op == YuriScriptOpSend) {
+                // The TX thread owns the UART, writing it from here would interleave with it
+                const char* text = yuri_script_string(script, insn);
+                if(usb_uart_queue_data(bridge, (const uint8_t*)text, insn->arg) < insn->arg) {
+                    event = "fail";
+                    snprintf(detail, sizeof(detail), "line %u: UART busy", insn->line);
+                }
+            } else {
+                char path[128];
+                const UsbUartInjectPacing pacing = {0};
+                yuricable_data_path(path, sizeof(path), yuri_script_string(script, insn));
+                if(!usb_uart_inject_file(bridge, path, &pacing)) {
+                    event = "fail";
+                    snprintf(detail, sizeof(detail), "line %u: cannot open %s", insn->line, path);
+                }
+            }
+            break;
+        case YuriScriptOpWait:
+            events = yuricable_script_wait(0, furi_get_tick() + insn->value);
+            break;
+        case YuriScriptOpLog:
+            yuricable_script_log(app, start, "log", yuri_script_string(script, insn));
+            break;
+        case YuriScriptOpGoto:
+            pc = insn->jump;
+            break;
+        case YuriScriptOpPass:
+            event = "pass";
+            break;
+        case YuriScriptOpFail:
+            event = "fail";
+            snprintf(detail, sizeof(detail), "%s", yuri_script_string(script, insn));
+            break;
+        default:
+            break;
+        }
+        if(events & (ScriptEvtStop | ScriptEvtExit)) {
+            exit = events & ScriptEvtExit;
+            event = "stopped";
+            snprintf(detail, sizeof(detail), "line %u", insn->line);
+        } else if(
+            (insn->op == YuriScriptOpAwait && !yuricable_script_executed(app)) ||
+            (insn->op == YuriScriptOpExpect && !(events & ScriptEvtMatch))) {
+            if(insn->jump != YURI_SCRIPT_NO_JUMP) {
+                pc = insn->jump;
+            } else {
+                event = "fail";
+                snprintf(detail, sizeof(detail), "line %u: timeout", insn->line);
+            }
+        }
+    }
+    yuricable_script_arm(app, NULL);
+    if(bridge) {
+        yuricable_bridge_release(app, false);
+    }
+    yuricable_script_log(app, start, event, detail);
+    furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+    snprintf(
+        app->script_result,
+        sizeof(app->script_result),
+        "%s %s%s%s",
+        app->script_name,
+        event,
+        detail[0] ? " " : "",
+        detail);
+    app->script_running = false;
+    furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+    return !exit;
+}
+
+static int32_t yuricable_script_worker(void* ctx) {
+    furi_assert(ctx);
+    App* app = ctx;
+    while(1) {
+        uint32_t events =
+            furi_thread_flags_wait(ScriptEvtExit | ScriptEvtRun, FuriFlagWaitAny, FuriWaitForever);
+        if(events & FuriFlagError) {
+            continue;
+        }
+        if(events & ScriptEvtExit) {
+            break;
+        }
+        furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+        YuriScript* script = app->script_pending;
+        app->script_pending = NULL;
+        furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+        if(script) {
+            const bool keep_running = yuricable_script_run(app, script);
+            yuri_script_free(script);
+            if(!keep_running) {
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Prints to the bridge console if it runs, the CLI reads the same text from /probe status */
+static void yuricable_probe_print(App* app, FuriString* text) {
+    UsbUartBridge* bridge = yuricable_bridge_hold(app);
+    if(bridge) {
+        furi_string_cat_str(text, "\r\n");
+        usb_uart_print(bridge, (const uint8_t*)furi_string_get_cstr(text), furi_string_size(text));
+        yuricable_bridge_release(app, false);
+    }
+}
+
+/* Runs one /probe request. Plays the Tristar on the same pin, the accessory answers instead of
+ * a phone. */
+static int32_t yuricable_probe_worker(void* ctx) {
+    furi_assert(ctx);
+    App* app = ctx;
+    SDQDevice* sdq = app->data->sdq;
+    SDQHost* host = sdq_host_alloc(sdq->gpio_pin);
+    host->timings = app->config.timings;
+    SDQHostProbe probe;
+    SDQHostProbe last_ok = {0};
+    SDQHostProbe last_failed = {0};
+    const uint32_t count = app->probe_count;
+    uint32_t done = 0;
+    uint32_t ok = 0;
+    uint32_t errors[SDQHostErrorInvalidCRC + 1] = {0};
+    FuriString* report = furi_string_alloc();
+    while(done < count && !app->probe_stop) {
+        if(sdq_host_probe(host, &probe)) {
+            last_ok = probe;
+            ok++;
+        } else {
+            last_failed = probe;
+            errors[probe.error]++;
+        }
+        done++;
+        furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+        app->probe_done = done;
+        app->probe_ok = ok;
+        furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+        if(done % PROBE_PROGRESS_EVERY == 0 && done < count) {
+            furi_string_printf(report, "probe %lu/%lu, %lu ok", done, count, ok);
+            yuricable_probe_print(app, report);
+        }
+    }
+    const uint32_t late_ns = host->edge_late_max * 1000 / host->cycles_per_us;
+    sdq_host_free(host);
+
+    furi_string_printf(report, "%lu/%lu ok", ok, done);
+    if(done < count) {
+        furi_string_cat_printf(report, ", stopped");
+    }
+    if(ok) {
+        const char* kind = sdq_host_probe_kind(&last_ok);
+        furi_string_cat_printf(report, ", %s\r\nid", kind ? kind : "unknown accessory");
+        for(size_t i = 0; i < sizeof(last_ok.id); i++) {
+            furi_string_cat_printf(report, " %02X", last_ok.id[i]);
+        }
+        furi_string_cat_printf(report, "\r\n76");
+        for(size_t i = 0; i < sizeof(last_ok.info); i++) {
+            furi_string_cat_printf(report, " %02X", last_ok.info[i]);
+        }
+        furi_string_cat_printf(report, "\r\npower %02X", last_ok.power[0]);
+    }
+    if(ok < done) {
+        furi_string_cat_printf(
+            report,
+            "\r\nlast failure at %02X: %s",
+            last_failed.failed_request,
+            sdq_host_error_name(last_failed.error));
+        for(uint8_t i = SDQHostErrorNoReply; i < COUNT_OF(errors); i++) {
+            furi_string_cat_printf(report, ", %s %lu", sdq_host_error_name(i), errors[i]);
+        }
+    }
+    furi_string_cat_printf(report, "\r\nedge late max %luns", late_ns);
+    furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+    furi_string_set_str(app->probe_report, furi_string_get_cstr(report));
+    app->probe_running = false;
+    furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+    yuricable_probe_print(app, report);
+    furi_string_free(report);
+    return 0;
+}
+
 void yuricable_menu_callback(void* ctx, uint32_t index) {
     furi_assert(ctx);
     App* app = ctx;
@@ -130,6 +1206,9 @@ void yuricable_menu_callback(void* ctx, uint32_t index) {
     case YuriCableProMaxMainMenuSceneCharging:
         scene_manager_handle_custom_event(app->scene_manager, YuriCableProMaxMainMenuSceneChargingModeEvent);
         break;
+    case YuriCableProMaxMainMenuSceneSettings:
+        scene_manager_handle_custom_event(app->scene_manager, YuriCableProMaxMainMenuSceneSettingsEvent);
+        break;
     }
 }
 
@@ -142,6 +1221,7 @@ void yuricable_main_menu_scene_on_enter(void* ctx) {
     submenu_add_item(app->submenu, yuricable_get_submenu_title_string(YuriCableProMaxResetSubmenuTitle), YuriCableProMaxMainMenuSceneReset, yuricable_menu_callback, app);
     submenu_add_item(app->submenu, yuricable_get_submenu_title_string(YuriCableProMaxDFUSubmenuTitle), YuriCableProMaxMainMenuSceneDFU, yuricable_menu_callback, app);
     submenu_add_item(app->submenu, yuricable_get_submenu_title_string(YuriCableProMaxChargingSubmenuTitle), YuriCableProMaxMainMenuSceneCharging, yuricable_menu_callback, app);
+    submenu_add_item(app->submenu, yuricable_get_submenu_title_string(YuriCableProMaxSettingsSubmenuTitle), YuriCableProMaxMainMenuSceneSettings, yuricable_menu_callback, app);
     view_dispatcher_switch_to_view(app->view_dispatcher, YuriCableProMaxSubmenuView);
 }
 
@@ -153,35 +1233,41 @@ bool yuricable_main_menu_scene_on_event(void* ctx, SceneManagerEvent event) {
     case SceneManagerEventTypeCustom:
         switch(event.event) {
         case YuriCableProMaxMainMenuSceneDCSDModeEvent:
-            app->data->sdq->runCommand = SDQDeviceCommand_DCSD;
+            sdq_device_post_command(app->data->sdq, SDQDeviceCommand_DCSD);
             app->data->selectedSubmenu = YuriCableProMaxDCSDSubmenuTitle;
             scene_manager_next_scene(app->scene_manager, YuriCableProMaxDCSDScene);
             consumed = true;
             break;
         case YuriCableProMaxMainMenuSceneResetModeEvent:
-            app->data->sdq->runCommand = SDQDeviceCommand_RESET;
+            sdq_device_post_command(app->data->sdq, SDQDeviceCommand_RESET);
             app->data->selectedSubmenu = YuriCableProMaxResetSubmenuTitle;
             scene_manager_next_scene(app->scene_manager, YuriCableProMaxResetScene);
             consumed = true;
             break;
         case YuriCableProMaxMainMenuSceneDFUModeEvent:
-            app->data->sdq->runCommand = SDQDeviceCommand_DFU;
+            sdq_device_post_command(app->data->sdq, SDQDeviceCommand_DFU);
             app->data->selectedSubmenu = YuriCableProMaxDFUSubmenuTitle;
             scene_manager_next_scene(app->scene_manager, YuriCableProMaxDFUScene);
             consumed = true;
             break;
         case YuriCableProMaxMainMenuSceneChargingModeEvent:
-            app->data->sdq->runCommand = SDQDeviceCommand_CHARGING;
+            sdq_device_post_command(app->data->sdq, SDQDeviceCommand_CHARGING);
             app->data->selectedSubmenu = YuriCableProMaxChargingSubmenuTitle;
             scene_manager_next_scene(app->scene_manager, YuriCableProMaxCharginScene);
             consumed = true;
             break;
+        case YuriCableProMaxMainMenuSceneSettingsEvent:
+            app->data->selectedSubmenu = YuriCableProMaxSettingsSubmenuTitle;
+            scene_manager_next_scene(app->scene_manager, YuriCableProMaxSettingsScene);
+            consumed = true;
+            break;
         }
         break;
     default:
         break;
     }
     app->data->ledMainMenu = false;
+    yuricable_led_update(app);
     return consumed;
 }
 
@@ -189,18 +1275,28 @@ static int32_t yuricable_update_battery_consumption_worker(void* ctx) {
     furi_assert(ctx);
     App* app = ctx;
     while(1) {
-        uint32_t events = furi_thread_flags_get();
-        if(events & WorkerEvtStop) {
+        uint32_t events = furi_thread_flags_wait(WorkerEvtStop, FuriFlagWaitAny, 500);
+        if(!(events & FuriFlagError) && (events & WorkerEvtStop)) {
             break;
         }
-        float consumption = app->info.current_gauge;
-        widget_reset(app->widget);
-        widget_add_string_element(app->widget, 25, 15, AlignLeft, AlignCenter, FontPrimary, yuricable_get_submenu_title_string(app->data->selectedSubmenu));
-        widget_add_string_element(app->widget, 15, 30, AlignLeft, AlignCenter, FontSecondary, "Connect an iPhone now!");
-        yuricable_draw_battery_consumption(app->widget, (double)consumption);
-        widget_add_string_element(app->widget, 15, 45, AlignLeft, AlignCenter, FontSecondary, "+");
         yuricable_battery_info_update_model(app);
-        furi_delay_ms(500);
+        power_view_add_sample(app->power_view, app->info.current_gauge, app->info.voltage_gauge);
+        charge_session_add(
+            &app->charge_session,
+            furi_get_tick(),
+            app->info.current_gauge,
+            app->info.voltage_gauge,
+            app->info.charge);
+        const ChargeDraw draw = charge_session_draw(&app->charge_session);
+        if(draw == ChargeDrawOver && !app->charge_session.cut) {
+            // The phone took more than the limit allows, protect the Flipper battery and boost
+            furi_hal_power_disable_otg();
+            app->charge_session.cut = true;
+            FURI_LOG_W(TAG, "Load above %u mA, 5V off", app->charge_session.limit_ma);
+        }
+        power_view_set_status(
+            app->power_view,
+            app->charge_session.cut ? "5V off" : charge_session_draw_name(draw));
     }
     return 0;
 }
@@ -208,18 +1304,40 @@ static int32_t yuricable_update_battery_consumption_worker(void* ctx) {
 void yuricable_sdq_scene_on_enter(void* ctx) {
     furi_assert(ctx);
     App* app = ctx;
-    widget_reset(app->widget);
+    if(sdq_device_get_command(app->data->sdq) == SDQDeviceCommand_DCSD) {
+        yuricable_bridge_keep(app, &app->bridge_scene, true);
+    }
     sdq_device_start(app->data->sdq);
-    widget_add_string_element(app->widget, 25, 15, AlignLeft, AlignCenter, FontPrimary, yuricable_get_submenu_title_string(app->data->selectedSubmenu));
-    widget_add_string_element(app->widget, 15, 30, AlignLeft, AlignCenter, FontSecondary, "Connect an iPhone now!");
-    if(app->data->sdq->runCommand == SDQDeviceCommand_CHARGING &&
+    yuricable_production_arm(app);
+    const char* title = yuricable_get_submenu_title_string(app->data->selectedSubmenu);
+    if(sdq_device_get_command(app->data->sdq) == SDQDeviceCommand_CHARGING &&
        !furi_hal_power_check_otg_fault()) {
+        // What the Flipper draws on its own, the session takes it off every reading
+        yuricable_battery_info_update_model(app);
+        const float idle_current = app->info.current_gauge;
         furi_hal_power_enable_otg();
-        furi_hal_power_insomnia_enter();
-        float consumption = app->info.current_gauge;
-        yuricable_draw_battery_consumption(app->widget, (double)consumption);
-        widget_add_string_element(app->widget, 15, 45, AlignLeft, AlignCenter, FontSecondary, "+");
+        app->charging_active = true;
+        app->charging_insomnia = !app->data->sdq->low_power;
+        if(app->charging_insomnia) {
+            furi_hal_power_insomnia_enter();
+        }
+        power_view_reset(app->power_view, title);
+        yuricable_battery_info_update_model(app);
+        charge_session_begin(
+            &app->charge_session,
+            furi_get_tick(),
+            app->info.charge,
+            app->config.charge_limit_ma,
+            idle_current);
         furi_thread_start(app->battery_info_update_thread);
+        view_dispatcher_switch_to_view(app->view_dispatcher, YuriCableProMaxPowerView);
+        return;
+    }
+    widget_reset(app->widget);
+    widget_add_string_element(app->widget, 25, 15, AlignLeft, AlignCenter, FontPrimary, title);
+    widget_add_string_element(app->widget, 15, 30, AlignLeft, AlignCenter, FontSecondary, "Connect an iPhone now!");
+    if(app->production_active) {
+        widget_add_string_element(app->widget, 15, 45, AlignLeft, AlignCenter, FontSecondary, "Auto rearm, phone after phone");
     }
     view_dispatcher_switch_to_view(app->view_dispatcher, YuriCableProMaxWidgetView);
 }
@@ -233,18 +1351,37 @@ bool yuricable_sdq_scene_on_event(void* ctx, SceneManagerEvent event) {
 void yuricable_sdq_scene_on_exit(void* ctx) {
     furi_assert(ctx);
     App* app = ctx;
-    if(app->data->sdq->listening) {
+    if(yuricable_production_disarm(app) || yuricable_listening(app)) {
         sdq_device_stop(app->data->sdq);
     }
-    if(app->data->sdq->runCommand == SDQDeviceCommand_CHARGING &&
-       furi_hal_power_is_otg_enabled()) {
-        furi_hal_power_insomnia_exit();
-        furi_hal_power_disable_otg();
+    // The battery worker may have turned 5V off already, the session still needs closing
+    if(app->charging_active) {
         furi_thread_flags_set(furi_thread_get_id(app->battery_info_update_thread), WorkerEvtStop);
+        furi_thread_join(app->battery_info_update_thread);
+        if(furi_hal_power_is_otg_enabled()) {
+            furi_hal_power_disable_otg();
+        }
+        if(app->charging_insomnia) {
+            furi_hal_power_insomnia_exit();
+            app->charging_insomnia = false;
+        }
+        app->charging_active = false;
+        char record[128];
+        if(app->charge_session.samples &&
+           charge_session_format(
+               &app->charge_session,
+               yuricable_charge_identity_names[app->data->sdq->charge_identity],
+               record,
+               sizeof(record))) {
+            log_saver_append_record(CHARGE_SESSION_LOG_NAME, CHARGE_SESSION_LOG_HEADER, record);
+        }
     }
+    yuricable_bridge_keep(app, &app->bridge_scene, false);
     app->data->selectedSubmenu = YuriCableProMaxMainMenuTitle;
-    app->data->sdq->commandExecuted = false;
+    // Posting the same command again clears its executed flag
+    sdq_device_post_command(app->data->sdq, sdq_device_get_command(app->data->sdq));
     app->data->ledMainMenu = true;
+    yuricable_led_update(app);
     UNUSED(ctx);
 }
 
@@ -254,26 +1391,281 @@ void yuricable_main_menu_scene_on_exit(void* ctx) {
     submenu_reset(app->submenu);
 }
 
+static const uint32_t yuricable_baudrates[] =
+    {0, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1500000, 3000000};
+static const char* const yuricable_baudrate_names[] = {
+    "Host", "9600", "19200", "38400", "57600", "115200", "230400", "460800", "921600", "1.5M", "3M"};
+// Index 0 doubles as "Off" for the second UART
+static const char* const yuricable_aux_baudrate_names[] = {
+    "Off", "9600", "19200", "38400", "57600", "115200", "230400", "460800", "921600", "1.5M", "3M"};
+static const char* const yuricable_mode_names[] = {"None", "DCSD", "Reset", "DFU"};
+static const char* const yuricable_on_off_names[] = {"Off", "On"};
+static const char* const yuricable_bridge_policy_names[] = {"On Demand", "Keep Warm", "Always"};
+
+static uint8_t yuricable_baudrate_index(uint32_t baudrate) {
+    for(uint8_t i = 0; i < COUNT_OF(yuricable_baudrates); i++) {
+        if(yuricable_baudrates[i] == baudrate) return i;
+    }
+    return 0;
+}
+
+static void yuricable_settings_baudrate_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.bridge.baudrate = yuricable_baudrates[index];
+    variable_item_set_current_value_text(item, yuricable_baudrate_names[index]);
+}
+
+static void yuricable_settings_aux_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.bridge.aux_baudrate = yuricable_baudrates[index];
+    variable_item_set_current_value_text(item, yuricable_aux_baudrate_names[index]);
+}
+
+static void yuricable_settings_split_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.bridge.ctrl_split = index;
+    variable_item_set_current_value_text(item, yuricable_on_off_names[index]);
+}
+
+static void yuricable_settings_mode_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.default_mode = index;
+    variable_item_set_current_value_text(item, yuricable_mode_names[index]);
+}
+
+static void yuricable_settings_led_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.led_enabled = index;
+    variable_item_set_current_value_text(item, yuricable_on_off_names[index]);
+}
+
+static void yuricable_settings_bridge_policy_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.bridge_policy = index;
+    variable_item_set_current_value_text(item, yuricable_bridge_policy_names[index]);
+}
+
+static void yuricable_settings_auto_rearm_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.auto_rearm = index;
+    variable_item_set_current_value_text(item, yuricable_on_off_names[index]);
+}
+
+static void yuricable_settings_low_power_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.low_power = index;
+    variable_item_set_current_value_text(item, yuricable_on_off_names[index]);
+}
+
+static void yuricable_settings_charge_identity_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.charge_identity = index;
+    app->data->sdq->charge_identity = index;
+    variable_item_set_current_value_text(item, yuricable_charge_identity_names[index]);
+}
+
+static void yuricable_settings_charge_limit_changed(VariableItem* item) {
+    App* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    app->config.charge_limit_ma = yuricable_charge_limits[index];
+    variable_item_set_current_value_text(item, yuricable_charge_limit_names[index]);
+}
+
+static uint8_t yuricable_charge_limit_index(uint16_t limit_ma) {
+    for(uint8_t i = 0; i < COUNT_OF(yuricable_charge_limits); i++) {
+        if(yuricable_charge_limits[i] >= limit_ma) return i;
+    }
+    return COUNT_OF(yuricable_charge_limits) - 1;
+}
+
+static void yuricable_settings_add(
+    App* app,
+    const char* label,
+    uint8_t count,
+    VariableItemChangeCallback callback,
+    uint8_t index,
+    const char* const* names) {
+    VariableItem* item = variable_item_list_add(app->settings, label, count, callback, app);
+    variable_item_set_current_value_index(item, index);
+    variable_item_set_current_value_text(item, names[index]);
+}
+
+void yuricable_settings_scene_on_enter(void* ctx) {
+    furi_assert(ctx);
+    App* app = ctx;
+    YuriCableConfig* config = &app->config;
+    // Start from what the bridge runs now, /split and /uart2 may have changed it
+    UsbUartBridge* bridge = yuricable_bridge_hold(app);
+    if(bridge) {
+        usb_uart_get_config(bridge, &config->bridge);
+        yuricable_bridge_release(app, false);
+    }
+    variable_item_list_reset(app->settings);
+    yuricable_settings_add(app, "UART Baud", COUNT_OF(yuricable_baudrates), yuricable_settings_baudrate_changed, yuricable_baudrate_index(config->bridge.baudrate), yuricable_baudrate_names);
+    yuricable_settings_add(app, "Second UART", COUNT_OF(yuricable_baudrates), yuricable_settings_aux_changed, yuricable_baudrate_index(config->bridge.aux_baudrate), yuricable_aux_baudrate_names);
+    yuricable_settings_add(app, "Split Ctrl Port", 2, yuricable_settings_split_changed, config->bridge.ctrl_split ? 1 : 0, yuricable_on_off_names);
+    yuricable_settings_add(app, "Default Mode", COUNT_OF(yuricable_mode_names), yuricable_settings_mode_changed, config->default_mode < COUNT_OF(yuricable_mode_names) ? config->default_mode : 0, yuricable_mode_names);
+    yuricable_settings_add(app, "Status LED", 2, yuricable_settings_led_changed, config->led_enabled ? 1 : 0, yuricable_on_off_names);
+    yuricable_settings_add(app, "UART Bridge", COUNT_OF(yuricable_bridge_policy_names), yuricable_settings_bridge_policy_changed, config->bridge_policy < COUNT_OF(yuricable_bridge_policy_names) ? config->bridge_policy : 0, yuricable_bridge_policy_names);
+    yuricable_settings_add(app, "Auto Rearm", 2, yuricable_settings_auto_rearm_changed, config->auto_rearm ? 1 : 0, yuricable_on_off_names);
+    yuricable_settings_add(app, "Low Power Wait", 2, yuricable_settings_low_power_changed, config->low_power ? 1 : 0, yuricable_on_off_names);
+    yuricable_settings_add(app, "Charge ID", SDQChargeIdentityCount, yuricable_settings_charge_identity_changed, app->data->sdq->charge_identity, yuricable_charge_identity_names);
+    yuricable_settings_add(app, "Charge Limit", COUNT_OF(yuricable_charge_limits), yuricable_settings_charge_limit_changed, yuricable_charge_limit_index(config->charge_limit_ma), yuricable_charge_limit_names);
+    view_dispatcher_switch_to_view(app->view_dispatcher, YuriCableProMaxSettingsView);
+}
+
+bool yuricable_settings_scene_on_event(void* ctx, SceneManagerEvent event) {
+    UNUSED(ctx);
+    UNUSED(event);
+    return false; // event not handled.
+}
+
+void yuricable_settings_scene_on_exit(void* ctx) {
+    furi_assert(ctx);
+    App* app = ctx;
+    // GUI thread, so the bridge can be reconfigured, started or stopped right here
+    UsbUartBridge* bridge = yuricable_bridge_hold(app);
+    if(bridge) {
+        usb_uart_set_config(bridge, &app->config.bridge);
+        yuricable_bridge_release(app, false);
+    }
+    const uint8_t policy = app->config.bridge_policy;
+    yuricable_bridge_keep(
+        app,
+        &app->bridge_pinned,
+        policy == YuriCableBridgeAlways ||
+            (policy == YuriCableBridgeKeepWarm && app->bridge_pinned));
+    app->data->auxBaudrate = app->config.bridge.aux_baudrate;
+    yuricable_apply_low_power(app);
+    yuricable_config_save(&app->config);
+    variable_item_list_reset(app->settings);
+    app->data->selectedSubmenu = YuriCableProMaxMainMenuTitle;
+    app->data->ledMainMenu = true;
+    yuricable_led_update(app);
+}
+
+/* Low-power wait: records each wake with the idle current the gauge averaged up to it, and
+ * lets the core stop again once the pin went quiet. Called with the mutex held. */
+static void yuricable_low_power_update(App* app) {
+    SDQDevice* sdq = app->data->sdq;
+    SDQDeviceState state;
+    sdq_device_get_state(sdq, &state);
+    const LowPowerInput input = {
+        .now = furi_get_tick(),
+        .awake = sdq->awake,
+        .connected = state.connected,
+        .wakes = sdq->wakes,
+        .wake_tick = sdq->wake_tick,
+        .wake_latency_us = sdq->wake_latency_us,
+        .wake_late = sdq->wake_late,
+        .last_edge_tick = sdq->last_edge_tick,
+    };
+    switch(low_power_update(&app->low_power, &input)) {
+    case LowPowerActionWoke:
+        low_power_set_idle_current(
+            &app->low_power,
+            (int32_t)(furi_hal_power_get_battery_current(FuriHalPowerICFuelGauge) * 1000));
+        break;
+    case LowPowerActionDoze:
+        sdq_device_doze(sdq);
+        break;
+    default:
+        break;
+    }
+    // The engine stopped itself once its command ran, the wake it held is released here
+    if(sdq->awake && !state.listening) {
+        sdq_device_doze(sdq);
+    }
+}
+
+/* Production mode logs each phone and arms the engine for the next one once it is unplugged,
+ * the low-power wait is measured and ended here too. Sleeps while the engine waits for a phone,
+ * the state callback wakes it on the first session or wake. From then on it checks every
+ * SESSION_POLL_MS whether the ID pin went quiet. */
+static int32_t yuricable_session_worker(void* ctx) {
+    furi_assert(ctx);
+    App* app = ctx;
+    SDQDevice* sdq = app->data->sdq;
+    while(1) {
+        const bool polling =
+            sdq->awake ||
+            (app->production_active && app->production.phase != ProductionPhaseArmed);
+        uint32_t events = furi_thread_flags_wait(
+            SessionEvtStop | SessionEvtUpdate,
+            FuriFlagWaitAny,
+            polling ? furi_ms_to_ticks(SESSION_POLL_MS) : FuriWaitForever);
+        if(!(events & FuriFlagError) && (events & SessionEvtStop)) {
+            break;
+        }
+        furi_check(furi_mutex_acquire(app->mutex, FuriWaitForever) == FuriStatusOk);
+        if(app->production_active) {
+            SDQDeviceState state;
+            sdq_device_get_state(sdq, &state);
+            const ProductionInput input = {
+                .now = furi_get_tick(),
+                .sessions = sdq->sessions,
+                .last_edge_tick = sdq->last_edge_tick,
+                .executed = !state.listening && state.commandExecuted,
+            };
+            char record[64];
+            switch(production_update(&app->production, &input)) {
+            case ProductionActionWatch:
+                if(state.listening) sdq_device_stop(sdq);
+                sdq_device_watch(sdq);
+                break;
+            case ProductionActionRearm:
+                if(production_format(
+                       &app->production,
+                       yuricable_mode_names[state.command],
+                       record,
+                       sizeof(record))) {
+                    log_saver_append_record(PRODUCTION_LOG_NAME, PRODUCTION_LOG_HEADER, record);
+                }
+                sdq_device_post_command(sdq, state.command);
+                sdq_device_start(sdq);
+                production_arm(&app->production, sdq->sessions);
+                break;
+            default:
+                break;
+            }
+        }
+        if(sdq->low_power) {
+            yuricable_low_power_update(app);
+        }
+        furi_check(furi_mutex_release(app->mutex) == FuriStatusOk);
+    }
+    return 0;
+}
+
 void (*const yuricable_scene_on_enter_handlers[])(void*) = {
     yuricable_main_menu_scene_on_enter,
     yuricable_sdq_scene_on_enter,
     yuricable_sdq_scene_on_enter,
     yuricable_sdq_scene_on_enter,
-    yuricable_sdq_scene_on_enter};
+    yuricable_settings_scene_on_enter};
 
 bool (*const yuricable_scene_on_event_handlers[])(void*, SceneManagerEvent) = {
     yuricable_main_menu_scene_on_event,
     yuricable_sdq_scene_on_event,
     yuricable_sdq_scene_on_event,
     yuricable_sdq_scene_on_event,
-    yuricable_sdq_scene_on_event};
+    yuricable_settings_scene_on_event};
 
 void (*const yuricable_scene_on_exit_handlers[])(void*) = {
     yuricable_main_menu_scene_on_exit,
     yuricable_sdq_scene_on_exit,
     yuricable_sdq_scene_on_exit,
     yuricable_sdq_scene_on_exit,
-    yuricable_sdq_scene_on_exit};
+    yuricable_settings_scene_on_exit};
 
 static const SceneManagerHandlers yuricable_scene_manager_handlers = {
     .on_enter_handlers = yuricable_scene_on_enter_handlers,
@@ -282,9 +1674,47 @@ static const SceneManagerHandlers yuricable_scene_manager_handlers = {
     .scene_num = YuriCableProMaxSceneCount,
 };
 
+static bool yuricable_handle_bridge_event(App* app, uint32_t custom_event) {
+    if(custom_event < YuriCableProMaxBridgeSplitOnEvent) {
+        return false;
+    }
+    UsbUartBridge* bridge = yuricable_bridge_hold(app);
+    if(!bridge) {
+        // Stopped by policy before the event got here, the next start uses app->config
+        return true;
+    }
+    if(custom_event == YuriCableProMaxBridgeSplitOnEvent ||
+       custom_event == YuriCableProMaxBridgeSplitOffEvent) {
+        UsbUartConfig config;
+        usb_uart_get_config(bridge, &config);
+        config.ctrl_split = custom_event == YuriCableProMaxBridgeSplitOnEvent;
+        usb_uart_set_config(bridge, &config);
+    } else if(custom_event == YuriCableProMaxBridgeAuxEvent) {
+        UsbUartConfig config;
+        usb_uart_get_config(bridge, &config);
+        config.aux_baudrate = app->data->auxBaudrate;
+        usb_uart_set_config(bridge, &config);
+    } else if(custom_event == YuriCableProMaxBridgeInjectEvent) {
+        if(!usb_uart_inject_file(bridge, app->data->injectPath, &app->data->injectPacing)) {
+            FuriString* error =
+                furi_string_alloc_printf("cannot open %s\r\n", app->data->injectPath);
+            usb_uart_print(
+                bridge, (const uint8_t*)furi_string_get_cstr(error), furi_string_size(error));
+            furi_string_free(error);
+        }
+    } else if(custom_event == YuriCableProMaxBridgeInjectStopEvent) {
+        usb_uart_inject_stop(bridge);
+    }
+    yuricable_bridge_release(app, false);
+    return true;
+}
+
 static bool yuricable_custom_callback(void* ctx, uint32_t custom_event) {
     furi_assert(ctx);
     App* app = ctx;
+    if(yuricable_handle_bridge_event(app, custom_event)) {
+        return true;
+    }
     return scene_manager_handle_custom_event(app->scene_manager, custom_event);
 }
 
@@ -294,27 +1724,72 @@ bool yuricable_back_event_callback(void* ctx) {
     return scene_manager_handle_back_event(app->scene_manager);
 }
 
-App* app_alloc() {
+App* app_alloc(bool headless) {
     App* app = malloc(sizeof(App));
     // Initialize LED Worker Thread
     app->led_thread = furi_thread_alloc_ex("LEDWorker", 1024, yuricable_led_worker, app);
-    app->battery_info_update_thread = furi_thread_alloc_ex("UpdateBatteryConsumptionWorker", 1024, yuricable_update_battery_consumption_worker, app);
+    app->session_thread =
+        furi_thread_alloc_ex("SessionWorker", 1024, yuricable_session_worker, app);
+    app->script_thread = furi_thread_alloc_ex("ScriptWorker", 1024, yuricable_script_worker, app);
+    app->script_pending = NULL;
+    app->script_running = false;
+    app->script_result[0] = 0;
+    app->script_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    app->script_armed = false;
+    app->probe_thread = furi_thread_alloc_ex("ProbeWorker", 1024, yuricable_probe_worker, app);
+    app->probe_running = false;
+    app->probe_stop = false;
+    app->probe_report = furi_string_alloc_set_str("no probe run yet");
+    // Recursive so a kept reference can take and drop its count under the same lock
+    app->bridge_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
+    app->bridge_refs = 0;
+    app->bridge_scene = false;
+    app->bridge_pinned = false;
+    app->production_active = false;
+    app->charging_active = false;
+    app->charging_insomnia = false;
     // Initialize YuriCableContext
     app->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
     app->data = malloc(sizeof(YuriCableData));
-    app->data->listeningAnimation = icon_animation_alloc(&A_Round_loader_8x8);
+    app->data->listeningAnimation = NULL;
     app->data->ledMainMenu = true;
     app->data->ledSequenceCommandExecutedPlayed = false;
     app->queue = furi_message_queue_alloc(8, sizeof(Event));
-    // Initialize USB UART bridge
-    UsbUartConfig bridgeConfig = {
-        .vcp_ch = 1, .uart_ch = 0, .baudrate_mode = 0, .baudrate = 115200};
-    UsbUartBridge* uartBridge = usb_uart_enable(&bridgeConfig);
-    usb_uart_set_command_callback(uartBridge, yuricable_command_callback, app);
-    // Initialize SDQ
-    app->data->sdq = sdq_device_alloc(&SDQ_PIN, uartBridge);
-    app->data->sdq->runCommand = SDQDeviceCommand_NONE;
+    // Load the bench config, one small read, defaults when there is none yet
+    if(!yuricable_config_load(&app->config)) {
+        FURI_LOG_I(TAG, "No valid config, using defaults");
+    }
+    app->data->auxBaudrate = app->config.bridge.aux_baudrate;
+    // Initialize SDQ, the USB UART bridge is attached once something needs it
+    app->data->sdq = sdq_device_alloc(&SDQ_PIN, NULL);
+    sdq_device_set_timings(app->data->sdq, &app->config.timings);
+    sdq_device_post_command(app->data->sdq, app->config.default_mode);
+    sdq_device_set_low_power(app->data->sdq, app->config.low_power);
+    app->trace.head = 0;
+    sdq_trace_reset(&app->trace);
+    app->data->sdq->trace = &app->trace;
+    app->data->sdq->charge_identity = app->config.charge_identity < SDQChargeIdentityCount ?
+                                          app->config.charge_identity :
+                                          SDQChargeIdentityCable;
+    low_power_begin(&app->low_power, furi_get_tick(), app->data->sdq->wakes);
+    app->profiles = sdq_profile_table_load(SDQ_PROFILE_PATH);
+    app->data->sdq->profiles = app->profiles;
     app->data->selectedSubmenu = YuriCableProMaxMainMenuTitle;
+    if(headless) {
+        // Driven from the Flipper CLI, nothing below is needed
+        app->battery_info_update_thread = NULL;
+        app->scene_manager = NULL;
+        app->view_dispatcher = NULL;
+        app->submenu = NULL;
+        app->widget = NULL;
+        app->power_view = NULL;
+        app->settings = NULL;
+        app->gui = NULL;
+        app->power = NULL;
+        return app;
+    }
+    app->battery_info_update_thread = furi_thread_alloc_ex("UpdateBatteryConsumptionWorker", 1024, yuricable_update_battery_consumption_worker, app);
+    app->data->listeningAnimation = icon_animation_alloc(&A_Round_loader_8x8);
     // Initialize SceneManager and Gui
     app->scene_manager = scene_manager_alloc(&yuricable_scene_manager_handlers, app);
     app->view_dispatcher = view_dispatcher_alloc();
@@ -325,6 +1800,10 @@ App* app_alloc() {
     view_dispatcher_add_view(app->view_dispatcher, YuriCableProMaxSubmenuView, submenu_get_view(app->submenu));
     app->widget = widget_alloc();
     view_dispatcher_add_view(app->view_dispatcher, YuriCableProMaxWidgetView, widget_get_view(app->widget));
+    app->power_view = power_view_alloc();
+    view_dispatcher_add_view(app->view_dispatcher, YuriCableProMaxPowerView, power_view_get_view(app->power_view));
+    app->settings = variable_item_list_alloc();
+    view_dispatcher_add_view(app->view_dispatcher, YuriCableProMaxSettingsView, variable_item_list_get_view(app->settings));
     app->gui = furi_record_open(RECORD_GUI);
     app->power = furi_record_open(RECORD_POWER);
     return app;
@@ -332,42 +1811,156 @@ App* app_alloc() {
 
 void app_free(App* app) {
     furi_assert(app);
+    // Free LED and Batter Info Update Thread
+    sdq_device_set_state_callback(app->data->sdq, NULL, NULL);
+    furi_thread_flags_set(furi_thread_get_id(app->led_thread), LedEvtStop);
+    furi_thread_join(app->led_thread);
     furi_hal_light_set(LightRed, 0);
     furi_hal_light_set(LightBlue, 0);
     furi_hal_light_set(LightGreen, 0);
-    // Free LED and Batter Info Update Thread
-    furi_thread_flags_set(furi_thread_get_id(app->led_thread), WorkerEvtStop);
-    furi_thread_join(app->led_thread);
-    furi_thread_join(app->battery_info_update_thread);
     furi_thread_free(app->led_thread);
-    furi_thread_free(app->battery_info_update_thread);
-    // Free Power Util
-    furi_record_close(RECORD_POWER);
-    // Free Gui
-    furi_record_close(RECORD_GUI);
-    view_dispatcher_remove_view(app->view_dispatcher, YuriCableProMaxSubmenuView);
-    view_dispatcher_remove_view(app->view_dispatcher, YuriCableProMaxWidgetView);
-    scene_manager_free(app->scene_manager);
-    view_dispatcher_free(app->view_dispatcher);
-    submenu_free(app->submenu);
-    widget_free(app->widget);
-    // Free SDQ
+    yuricable_production_disarm(app);
+    furi_thread_flags_set(furi_thread_get_id(app->session_thread), SessionEvtStop);
+    furi_thread_join(app->session_thread);
+    furi_thread_free(app->session_thread);
+    furi_thread_flags_set(furi_thread_get_id(app->script_thread), ScriptEvtExit);
+    furi_thread_join(app->script_thread);
+    furi_thread_free(app->script_thread);
+    yuri_script_free(app->script_pending);
+    app->probe_stop = true;
+    furi_thread_join(app->probe_thread);
+    furi_thread_free(app->probe_thread);
+    furi_string_free(app->probe_report);
+    if(app->view_dispatcher) {
+        furi_thread_join(app->battery_info_update_thread);
+        furi_thread_free(app->battery_info_update_thread);
+        // Free Power Util
+        furi_record_close(RECORD_POWER);
+        // Free Gui
+        furi_record_close(RECORD_GUI);
+        view_dispatcher_remove_view(app->view_dispatcher, YuriCableProMaxSubmenuView);
+        view_dispatcher_remove_view(app->view_dispatcher, YuriCableProMaxWidgetView);
+        view_dispatcher_remove_view(app->view_dispatcher, YuriCableProMaxPowerView);
+        view_dispatcher_remove_view(app->view_dispatcher, YuriCableProMaxSettingsView);
+        scene_manager_free(app->scene_manager);
+        view_dispatcher_free(app->view_dispatcher);
+        submenu_free(app->submenu);
+        widget_free(app->widget);
+        power_view_free(app->power_view);
+        variable_item_list_free(app->settings);
+        icon_animation_free(app->data->listeningAnimation);
+    }
+    // Free SDQ and the bridge if it is still up
+    sdq_device_stop(app->data->sdq);
+    yuricable_bridge_release(app, true);
     sdq_device_free(app->data->sdq);
-    icon_animation_free(app->data->listeningAnimation);
+    sdq_profile_table_free(app->profiles);
     free(app->data);
     // Free App
     furi_mutex_free(app->mutex);
+    furi_mutex_free(app->script_mutex);
+    furi_mutex_free(app->bridge_mutex);
     furi_message_queue_free(app->queue);
     free(app);
 }
 
+static void yuricable_cli_dump(UsbUartBridge* bridge, uint8_t port) {
+    char chunk[64];
+    size_t offset = 0;
+    size_t len;
+    while((len = usb_uart_log_read(bridge, port, offset, chunk, sizeof(chunk))) > 0) {
+        printf("%.*s", (int)len, chunk);
+        offset += len;
+    }
+    printf("\r\n");
+}
+
+/* Runs in the CLI session thread. Everything the bridge command port understands works here
+ * too, plus dump to print the buffered log and exit to quit the app. The bridge is never
+ * brought up from here, that would switch USB config under this very session, so the commands
+ * that need it only work while the Always policy runs it. */
+static void yuricable_cli_command(Cli* cli, FuriString* args, void* ctx) {
+    UNUSED(cli);
+    furi_assert(ctx);
+    App* app = ctx;
+    furi_string_trim(args);
+    if(furi_string_equal_str(args, "exit")) {
+        Event event = {.type = EventTypeExit};
+        furi_message_queue_put(app->queue, &event, FuriWaitForever);
+        return;
+    }
+    if(furi_string_empty(args)) {
+        furi_string_set_str(args, "help");
+    }
+    const bool dump = furi_string_start_with_str(args, "dump");
+    const bool needs_bridge =
+        dump || furi_string_start_with_str(args, "stats") ||
+        furi_string_start_with_str(args, "timeline") ||
+        furi_string_start_with_str(args, "filter") ||
+        furi_string_start_with_str(args, "inject") ||
+        (furi_string_equal_str(args, "start") &&
+         sdq_device_get_command(app->data->sdq) == SDQDeviceCommand_DCSD);
+    // Held for the command so the bridge cannot go away under it
+    UsbUartBridge* bridge = yuricable_bridge_hold(app);
+    if(needs_bridge && !bridge) {
+        printf("UART bridge is off, set UART Bridge to Always for this\r\n");
+        return;
+    }
+    if(dump) {
+        yuricable_cli_dump(bridge, furi_string_equal_str(args, "dump 2") ? 1 : 0);
+    } else {
+        FuriString* reply = yuricable_command_callback((char*)furi_string_get_cstr(args), app);
+        printf("%s\r\n", furi_string_get_cstr(reply));
+        if(furi_string_start_with_str(args, "help")) {
+            printf("/dump [2]\r\n/exit\r\n");
+        }
+        furi_string_free(reply);
+    }
+    if(bridge) {
+        yuricable_bridge_release(app, false);
+    }
+}
+
+/* No GUI at all: the LED worker, the SDQ engine and the bridge run, the app thread only applies
+ * bridge reconfiguration until the CLI asks it to exit. */
+static void yuricable_run_headless(App* app) {
+    if(app->config.bridge_policy == YuriCableBridgeAlways) {
+        yuricable_bridge_keep(app, &app->bridge_pinned, true);
+    }
+    Cli* cli = furi_record_open(RECORD_CLI);
+    cli_add_command(cli, "yuricable", CliCommandFlagParallelSafe, yuricable_cli_command, app);
+    Event event;
+    while(furi_message_queue_get(app->queue, &event, FuriWaitForever) == FuriStatusOk) {
+        if(event.type == EventTypeExit) {
+            break;
+        }
+        if(event.type == EventTypeBridge) {
+            yuricable_handle_bridge_event(app, event.custom_event);
+        }
+    }
+    cli_delete_command(cli, "yuricable");
+    furi_record_close(RECORD_CLI);
+}
+
 int32_t yuricable_pro_max_app(void* p) {
-    UNUSED(p);
-    FURI_LOG_I(TAG, "Starting YuriCable Pro Max");
+    const bool headless = p && strcmp((const char*)p, "headless") == 0;
+    FURI_LOG_I(TAG, "Starting YuriCable Pro Max%s", headless ? " headless" : "");
     // Alloc App Struct
-    App* app = app_alloc();
-    // Start LED Worker
+    App* app = app_alloc(headless);
+    // Start LED Worker, it only wakes up on state changes
     furi_thread_start(app->led_thread);
+    furi_thread_start(app->session_thread);
+    furi_thread_start(app->script_thread);
+    sdq_device_set_state_callback(app->data->sdq, yuricable_state_changed, app);
+    yuricable_led_update(app);
+    if(headless) {
+        yuricable_run_headless(app);
+        app_free(app);
+        return 0;
+    }
+    if(app->config.bridge_policy == YuriCableBridgeAlways) {
+        yuricable_bridge_keep(app, &app->bridge_pinned, true);
+    }
     // Start Gui
     view_dispatcher_attach_to_gui(app->view_dispatcher, app->gui, ViewDispatcherTypeFullscreen);
     scene_manager_next_scene(app->scene_manager, YuriCableProMaxMainMenuScene);
@@ -6,10 +6,28 @@
 #include <gui/scene_manager.h>
 #include <gui/modules/widget.h>
 #include <gui/modules/submenu.h>
+#include <gui/modules/variable_item_list.h>
 #include <power/power_service/power.h>
+#include <cli/cli.h>
 #include "lib/sdq/sdq_device.c"
+#include "lib/sdq/sdq_host.c"
+#include "lib/trace/sdq_trace.c"
+#include "lib/production/production.c"
+#include "lib/low_power/low_power.c"
+#include "lib/config/yuricable_config.c"
+#include "lib/text_file/text_file.c"
+#include "lib/profile/sdq_profile.c"
+#include "lib/power_view/power_view.c"
+#include "lib/charge_session/charge_session.c"
+#include "lib/script/yuri_script.c"
+#include "log_saver.h"
 
-typedef enum { EventTypeKey } EventType;
+typedef enum {
+    EventTypeKey,
+    // Headless mode only, the main thread stands in for the view dispatcher
+    EventTypeBridge,
+    EventTypeExit,
+} EventType;
 
 typedef enum {
     YuriCableProMaxMainMenuScene,
@@ -17,12 +35,15 @@ typedef enum {
     YuriCableProMaxResetScene,
     YuriCableProMaxDFUScene,
     YuriCableProMaxCharginScene,
+    YuriCableProMaxSettingsScene,
     YuriCableProMaxSceneCount
 } YuriCableProMaxScene;
 
 typedef enum {
     YuriCableProMaxSubmenuView,
     YuriCableProMaxWidgetView,
+    YuriCableProMaxPowerView,
+    YuriCableProMaxSettingsView,
 } YuriCableProMaxView;
 
 typedef enum {
@@ -30,6 +51,7 @@ typedef enum {
     YuriCableProMaxMainMenuSceneReset,
     YuriCableProMaxMainMenuSceneDFU,
     YuriCableProMaxMainMenuSceneCharging,
+    YuriCableProMaxMainMenuSceneSettings,
 } YuriCableProMaxMainMenuSceneIndex;
 
 typedef enum {
@@ -38,6 +60,7 @@ typedef enum {
     YuriCableProMaxResetSubmenuTitle,
     YuriCableProMaxDFUSubmenuTitle,
     YuriCableProMaxChargingSubmenuTitle,
+    YuriCableProMaxSettingsSubmenuTitle,
     YuriCableProMaxSubmenuTitlesCount
 } YuriCableProMaxSubmenuTitles;
 
@@ -47,6 +70,7 @@ const char* YuriCableProMaxSubmenuTitlesStrings[] = {
     "Force Reset",
     "Force DFU",
     "5V Charging",
+    "Settings",
 };
 typedef struct {
     SDQDevice* sdq;
@@ -54,6 +78,10 @@ typedef struct {
     YuriCableProMaxSubmenuTitles selectedSubmenu;
     bool ledMainMenu;
     bool ledSequenceCommandExecutedPlayed;
+    uint32_t auxBaudrate;
+    // Filled by /inject, the app thread starts the stream
+    char injectPath[128];
+    UsbUartInjectPacing injectPacing;
 } YuriCableData;
 
 typedef struct App {
@@ -62,6 +90,8 @@ typedef struct App {
     ViewDispatcher* view_dispatcher;
     Submenu* submenu;
     Widget* widget;
+    PowerView* power_view;
+    VariableItemList* settings;
     FuriMessageQueue* queue;
     FuriMutex* mutex;
     YuriCableData* data;
@@ -69,21 +99,102 @@ typedef struct App {
     FuriThread* battery_info_update_thread;
     Power* power;
     PowerInfo info;
+    // Loaded once at startup, written back by the settings scene and /config save
+    YuriCableConfig config;
+    // NULL without a profile file, the SDQ engine then answers every model the same
+    SDQProfileTable* profiles;
+    // Owned by the battery worker while it runs, read back on scene exit
+    ChargeSession charge_session;
+    // 5V Charging is up, the battery worker may still turn OTG off on its own
+    bool charging_active;
+    // Follows the engine for auto rearm and the low-power wait
+    FuriThread* session_thread;
+    // Auto rearm, guarded by mutex since the worker restarts the engine on its own
+    ProductionRun production;
+    bool production_active;
+    // Guarded by mutex as well, /lowpower reads it while the worker updates it
+    LowPowerStats low_power;
+    // Filled by the SDQ interrupt, drained by /trace from the command thread
+    SDQTrace trace;
+    // Charging keeps the core awake itself unless the low-power wait does that per phone
+    bool charging_insomnia;
+    // Runs /script files, it only ever sleeps on its thread flags
+    FuriThread* script_thread;
+    // Handed from /script run to the worker, guarded by mutex like the status below
+    YuriScript* script_pending;
+    bool script_running;
+    char script_name[YURI_SCRIPT_NAME_LEN];
+    uint16_t script_line;
+    char script_result[64];
+    // Pattern of the expect step, fed by the bridge worker while armed
+    FuriMutex* script_mutex;
+    StreamMatch script_match;
+    volatile bool script_armed;
+    // Runs /probe off the command thread, the progress and report are guarded by mutex
+    FuriThread* probe_thread;
+    bool probe_running;
+    volatile bool probe_stop;
+    uint32_t probe_count;
+    uint32_t probe_done;
+    uint32_t probe_ok;
+    FuriString* probe_report;
+    // Guards data->sdq->uart_bridge and its count, not mutex since the bridge threads take that
+    FuriMutex* bridge_mutex;
+    uint8_t bridge_refs;
+    // The references kept by the DCSD scene and the Always or Keep Warm policy
+    bool bridge_scene;
+    bool bridge_pinned;
 } App;
 
 typedef enum {
     YuriCableProMaxMainMenuSceneDCSDModeEvent,
     YuriCableProMaxMainMenuSceneResetModeEvent,
     YuriCableProMaxMainMenuSceneDFUModeEvent,
-    YuriCableProMaxMainMenuSceneChargingModeEvent
+    YuriCableProMaxMainMenuSceneChargingModeEvent,
+    YuriCableProMaxMainMenuSceneSettingsEvent
 } YuriCableProMaxMainMenuSceneEvent;
 
+// Handled by the dispatcher itself, the bridge must not be reconfigured from its own threads
+typedef enum {
+    YuriCableProMaxBridgeSplitOnEvent = 0x100,
+    YuriCableProMaxBridgeSplitOffEvent,
+    YuriCableProMaxBridgeAuxEvent,
+    YuriCableProMaxBridgeInjectEvent,
+    YuriCableProMaxBridgeInjectStopEvent,
+} YuriCableProMaxBridgeEvent;
+
 typedef struct {
     EventType type;
     InputEvent input;
+    uint32_t custom_event;
 } Event;
 
 typedef enum {
     LedEvtStop = (1 << 0),
     LedEvtStart = (1 << 1),
+    LedEvtUpdate = (1 << 2),
 } LedEvtFlags;
+
+typedef enum {
+    SessionEvtStop = (1 << 0),
+    SessionEvtUpdate = (1 << 1),
+} SessionEvtFlags;
+
+typedef enum {
+    ScriptEvtExit = (1 << 0),
+    ScriptEvtRun = (1 << 1),
+    // Ends the running script, the worker stays
+    ScriptEvtStop = (1 << 2),
+    ScriptEvtMatch = (1 << 3),
+    ScriptEvtUpdate = (1 << 4),
+} ScriptEvtFlags;
+
+typedef enum {
+    YuriCableLedStateNone,
+    YuriCableLedStateOff,
+    YuriCableLedStateIdle,
+    YuriCableLedStateWaiting,
+    YuriCableLedStateResetting,
+    YuriCableLedStateError,
+    YuriCableLedStateExecuted,
+} YuriCableLedState;